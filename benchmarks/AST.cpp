@@ -0,0 +1,230 @@
+#include "kaleidoscope/AST/ConstantFold.h"
+#include "kaleidoscope/AST/Dump/JSONDump.h"
+#include "kaleidoscope/AST/Dump/XMLDump.h"
+#include "kaleidoscope/AST/HashCons.h"
+#include "kaleidoscope/AST/Serialize/ASTReader.h"
+#include "kaleidoscope/AST/Serialize/ASTWriter.h"
+#include "kaleidoscope/CodeGen/CodeGen.h"
+#include "kaleidoscope/Lexer/Lexer.h"
+#include "kaleidoscope/Parser/Parser.h"
+#include "kaleidoscope/Sema/Resolver.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fmt/core.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// makePolyProgram - Defs definitions like generated code emits, each using
+/// the same polynomial several times, about 130 bytes each.
+auto makePolyProgram(int Defs) -> std::string {
+  std::string S;
+  for (int I = 0; I < Defs; ++I)
+    S += fmt::format(
+        "def p{0}(x y)\n"
+        "  (x*x*{0} + x*y + 1) * (x*x*{0} + x*y + 1)\n"
+        "  + (x*x*{0} + x*y + 1) / (y*y + 1);\n",
+        I
+    );
+  return S;
+}
+
+/// makeConstProgram - Defs definitions like a macro expander emits, with
+/// constant arithmetic, identities and a branch on a constant condition.
+auto makeConstProgram(int Defs) -> std::string {
+  std::string S;
+  for (int I = 0; I < Defs; ++I)
+    S += fmt::format(
+        "def c{0}(x)\n"
+        "  if 1 < 2 then x*(2*{0} + 1)*1 + (3*4 - {0}/2)\n"
+        "  else c{0}(x - 1) / ({0} + 1) + x*(0*(0-1) + 1);\n",
+        I
+    );
+  return S;
+}
+
+/// makeVarProgram - Defs definitions that mostly read and write variables,
+/// with locals shadowing each other in nested scopes.
+auto makeVarProgram(int Defs) -> std::string {
+  std::string S;
+  for (int I = 0; I < Defs; ++I)
+    S += fmt::format(
+        "def v{0}(x y)\n"
+        "  var a = x*y, b = x + {0} in\n"
+        "    for i = 0, i < y, 1 in\n"
+        "      var a = a*i + b, c = a - x in\n"
+        "        b = b + a*c - x/y : a = a + b*i;\n",
+        I
+    );
+  return S;
+}
+
+/// parseAll - Parses every item of Program into Ctx.
+auto parseAll(ASTContext& Ctx, const std::string& Program)
+    -> std::vector<const ASTNode*> {
+  Lexer                       Lex{SourceBuffer::getMemBuffer(Program)};
+  Parser                      Parse{Lex};
+  std::vector<const ASTNode*> Items;
+  for (const ASTNode* AST; !llvm::isa<EndOfFileAST>(AST = Parse.parse(Ctx));)
+    Items.push_back(AST);
+  return Items;
+}
+
+void setBytesProcessed(benchmark::State& State, const std::string& Program) {
+  State.SetBytesProcessed(
+      State.iterations() * static_cast<std::int64_t>(Program.size())
+  );
+}
+
+/// Lexing and parsing the source, as a baseline for BM_ReadAST.
+void BM_LexParse(benchmark::State& State) {
+  static const std::string Program = makePolyProgram(2000);
+  for (auto _ : State) {
+    ASTContext Ctx;
+    benchmark::DoNotOptimize(parseAll(Ctx, Program));
+  }
+  setBytesProcessed(State, Program);
+}
+BENCHMARK(BM_LexParse);
+
+/// Loading the same program from its binary form. Throughput is in bytes of
+/// source; FileBytes is the size of the binary form.
+void BM_ReadAST(benchmark::State& State) {
+  static const std::string Program = makePolyProgram(2000);
+  ASTContext               Ctx;
+  ast::ASTWriter           Writer;
+  for (const ASTNode* Item : parseAll(Ctx, Program)) Writer.add(*Item);
+  std::string              Data;
+  llvm::raw_string_ostream OS{Data};
+  Writer.write(OS);
+
+  for (auto _ : State) {
+    ASTContext Loaded;
+    benchmark::DoNotOptimize(
+        ast::ASTReader::read({Data, "<bench>"}, Loaded)->size()
+    );
+  }
+  setBytesProcessed(State, Program);
+  State.counters["FileBytes"] = static_cast<double>(Data.size());
+}
+BENCHMARK(BM_ReadAST);
+
+/// Copying parsed definitions with their repeated subtrees shared. ASTBytes
+/// and InternedBytes are the memory the nodes take up before and after.
+void BM_HashCons(benchmark::State& State) {
+  static const std::string Program = makePolyProgram(2000);
+  ASTContext                      Ctx;
+  std::vector<const FunctionAST*> Defs;
+  for (const ASTNode* Item : parseAll(Ctx, Program))
+    Defs.push_back(llvm::cast<FunctionAST>(Item));
+
+  std::size_t InternedBytes = 0;
+  for (auto _ : State) {
+    ASTContext    Out;
+    ast::HashCons C{Out};
+    for (const FunctionAST* F : Defs) benchmark::DoNotOptimize(C.intern(*F));
+    InternedBytes = Out.getBytesAllocated();
+  }
+  State.SetItemsProcessed(
+      State.iterations() * static_cast<std::int64_t>(Defs.size())
+  );
+  std::size_t ASTBytes             = Ctx.getBytesAllocated();
+  State.counters["ASTBytes"]      = static_cast<double>(ASTBytes);
+  State.counters["InternedBytes"] = static_cast<double>(InternedBytes);
+}
+BENCHMARK(BM_HashCons);
+
+/// Dumping the parsed program with Dump. Throughput is in bytes of output.
+template<typename Dump>
+void BM_Dump(benchmark::State& State) {
+  static const std::string Program = makePolyProgram(2000);
+  ASTContext               Ctx;
+  auto                     Items = parseAll(Ctx, Program);
+
+  std::size_t DumpBytes = 0;
+  for (auto _ : State) {
+    std::ostringstream SS;
+    Dump               D{SS};
+    for (const ASTNode* Item : Items) D.visit(*Item);
+    DumpBytes = SS.view().size();
+  }
+  State.SetBytesProcessed(
+      State.iterations() * static_cast<std::int64_t>(DumpBytes)
+  );
+}
+BENCHMARK_TEMPLATE(BM_Dump, ast::XMLDump);
+BENCHMARK_TEMPLATE(BM_Dump, ast::JSONDump);
+
+/// Emitting IR for definitions with constants in them, folding them first
+/// when Fold is set. Eliminated is how many nodes folding removed.
+template<bool Fold>
+void BM_CodeGen(benchmark::State& State) {
+  static const std::string Program = makeConstProgram(2000);
+  ASTContext                      Ctx;
+  std::vector<const FunctionAST*> Defs;
+  for (const ASTNode* Item : parseAll(Ctx, Program))
+    Defs.push_back(llvm::cast<FunctionAST>(Item));
+
+  std::size_t Eliminated = 0;
+  for (auto _ : State) {
+    CodeGen           CG;
+    ASTContext        FoldCtx;
+    ast::ConstantFold F{FoldCtx};
+    Resolver          Resolve;
+    SlotTable         Slots;
+    CG.takeSession();
+    CG.setSlots(&Slots);
+    Eliminated = 0;
+    for (const FunctionAST* Def : Defs) {
+      if constexpr (Fold) {
+        const FunctionAST* Folded = F.fold(*Def);
+        Eliminated += F.getNumEliminated();
+        Resolve.resolve(*Folded, Slots);
+        benchmark::DoNotOptimize(CG.visit(*Folded));
+      } else {
+        Resolve.resolve(*Def, Slots);
+        benchmark::DoNotOptimize(CG.visit(*Def));
+      }
+    }
+  }
+  State.SetItemsProcessed(
+      State.iterations() * static_cast<std::int64_t>(Defs.size())
+  );
+  State.counters["Eliminated"] = static_cast<double>(Eliminated);
+}
+BENCHMARK_TEMPLATE(BM_CodeGen, false);
+BENCHMARK_TEMPLATE(BM_CodeGen, true);
+
+/// Resolving and emitting IR for definitions that are mostly variable
+/// references.
+void BM_CodeGenVars(benchmark::State& State) {
+  static const std::string Program = makeVarProgram(2000);
+  ASTContext                      Ctx;
+  std::vector<const FunctionAST*> Defs;
+  for (const ASTNode* Item : parseAll(Ctx, Program))
+    Defs.push_back(llvm::cast<FunctionAST>(Item));
+
+  for (auto _ : State) {
+    CodeGen   CG;
+    Resolver  Resolve;
+    SlotTable Slots;
+    CG.takeSession();
+    CG.setSlots(&Slots);
+    for (const FunctionAST* Def : Defs) {
+      Resolve.resolve(*Def, Slots);
+      benchmark::DoNotOptimize(CG.visit(*Def));
+    }
+  }
+  State.SetItemsProcessed(
+      State.iterations() * static_cast<std::int64_t>(Defs.size())
+  );
+}
+BENCHMARK(BM_CodeGenVars);
+
+} // namespace
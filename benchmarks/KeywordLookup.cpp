@@ -0,0 +1,77 @@
+#include "kaleidoscope/Lexer/Lexer.h"
+
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/Compiler.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// Identifiers drawn from a typical generated module: about a third are
+/// keywords, the rest short variable and function names.
+auto makeIdentifierMix() -> std::vector<std::string_view> {
+  static constexpr std::string_view Program[] = {
+      "def", "poly3", "x", "a", "b", "c", "var", "t", "in", "a", "x", "x", "b",
+      "x", "c", "def", "fib", "n", "if", "n", "then", "n", "else", "fib", "n",
+      "fib", "n", "extern", "sin", "angle", "for", "i", "i", "n", "in",
+      "printd", "i", "def", "binary", "x", "y", "unary", "v", "v", "coeff",
+      "coeff0", "coeff1", "accum", "result", "else", "tmp", "then", "idx",
+      "value",
+  };
+  std::vector<std::string_view> Mix;
+  for (int I = 0; I < 64; ++I)
+    Mix.insert(Mix.end(), std::begin(Program), std::end(Program));
+  // Shuffle so the branch predictor cannot learn the sequence.
+  std::shuffle(Mix.begin(), Mix.end(), std::mt19937(42));
+  return Mix;
+}
+
+/// The keyword chain Lexer::handleIdentifier used before the perfect hash.
+/// Kept out of line like Lexer::classifyIdentifier so both pay for a call.
+LLVM_ATTRIBUTE_NOINLINE auto classifyStringSwitch(std::string_view S) -> int {
+  return llvm::StringSwitch<int>(llvm::StringRef(S.data(), S.size()))
+      .Case("def", Lexer::tok_def)
+      .Case("extern", Lexer::tok_extern)
+      .Case("if", Lexer::tok_if)
+      .Case("then", Lexer::tok_then)
+      .Case("else", Lexer::tok_else)
+      .Case("for", Lexer::tok_for)
+      .Case("in", Lexer::tok_in)
+      .Case("binary", Lexer::tok_binary)
+      .Case("unary", Lexer::tok_unary)
+      .Case("var", Lexer::tok_var)
+      .Default(Lexer::tok_identifier);
+}
+
+void BM_KeywordStringSwitch(benchmark::State& State) {
+  auto Mix = makeIdentifierMix();
+  for (auto _ : State)
+    for (std::string_view S : Mix)
+      benchmark::DoNotOptimize(classifyStringSwitch(S));
+  State.SetItemsProcessed(
+      State.iterations() * static_cast<std::int64_t>(Mix.size())
+  );
+}
+BENCHMARK(BM_KeywordStringSwitch);
+
+void BM_KeywordPerfectHash(benchmark::State& State) {
+  auto Mix = makeIdentifierMix();
+  for (auto _ : State)
+    for (std::string_view S : Mix)
+      benchmark::DoNotOptimize(Lexer::classifyIdentifier(S));
+  State.SetItemsProcessed(
+      State.iterations() * static_cast<std::int64_t>(Mix.size())
+  );
+}
+BENCHMARK(BM_KeywordPerfectHash);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,172 @@
+#include "kaleidoscope/Lexer/Lexer.h"
+#include "kaleidoscope/Parser/IncrementalParser.h"
+#include "kaleidoscope/Parser/Parser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fmt/core.h>
+
+#include <sys/resource.h>
+
+#include <string>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// makeProgram - Defs small function definitions, about 100 bytes each.
+auto makeProgram(int Defs) -> std::string {
+  std::string S;
+  for (int I = 0; I < Defs; ++I)
+    S += fmt::format(
+        "def f{0}(x y)\n"
+        "  if x < y then x * {0}.5 + y # scale\n"
+        "  else f{0}(y, x - 1);\n",
+        I
+    );
+  return S;
+}
+
+/// makeProgram - About 200KiB of source.
+auto makeProgram() -> const std::string& {
+  static const std::string Program = makeProgram(2000);
+  return Program;
+}
+
+/// makeCallProgram - Exprs top-level expressions made mostly of calls with
+/// zero to three arguments, about 70 bytes each.
+auto makeCallProgram(int Exprs) -> std::string {
+  std::string S;
+  for (int I = 0; I < Exprs; ++I)
+    S += fmt::format(
+        "f{0}(g(), h(x), k(x, y, {0})) + m(n(1, 2, 3), p(q()));\n", I
+    );
+  return S;
+}
+
+/// getPeakRSS - The peak resident set size of the whole process, in bytes.
+auto getPeakRSS() -> double {
+  rusage Usage{};
+  getrusage(RUSAGE_SELF, &Usage);
+  return static_cast<double>(Usage.ru_maxrss) * 1024;
+}
+
+void setBytesProcessed(benchmark::State& State, const std::string& Program) {
+  State.SetBytesProcessed(
+      State.iterations() * static_cast<std::int64_t>(Program.size())
+  );
+}
+
+/// Lexing alone, a token at a time as the REPL does.
+void BM_LexStreaming(benchmark::State& State) {
+  for (auto _ : State) {
+    Lexer Lex{SourceBuffer::getMemBuffer(makeProgram())};
+    while (Lex.gettok() != Lexer::tok_eof) {}
+  }
+  setBytesProcessed(State, makeProgram());
+}
+BENCHMARK(BM_LexStreaming);
+
+/// Lexing alone, into a TokenStream.
+void BM_Tokenize(benchmark::State& State) {
+  for (auto _ : State) {
+    Lexer Lex{SourceBuffer::getMemBuffer(makeProgram())};
+    benchmark::DoNotOptimize(Lex.tokenize());
+  }
+  setBytesProcessed(State, makeProgram());
+}
+BENCHMARK(BM_Tokenize);
+
+/// Lexing and parsing interleaved.
+void BM_ParseStreaming(benchmark::State& State) {
+  for (auto _ : State) {
+    Lexer  Lex{SourceBuffer::getMemBuffer(makeProgram())};
+    Parser Parse{Lex};
+    while (!llvm::isa<EndOfFileAST>(Parse.parse())) {}
+  }
+  setBytesProcessed(State, makeProgram());
+}
+BENCHMARK(BM_ParseStreaming);
+
+/// Parsing alone, from a stream tokenized once up front. ASTBytes is the
+/// memory the program's nodes take up.
+void BM_ParseTokenStream(benchmark::State& State) {
+  Lexer       Lex{SourceBuffer::getMemBuffer(makeProgram())};
+  TokenStream Tokens = Lex.tokenize();
+  std::size_t ASTBytes = 0;
+  for (auto _ : State) {
+    ASTContext Ctx;
+    Parser     Parse{Tokens};
+    while (!llvm::isa<EndOfFileAST>(Parse.parse(Ctx))) {}
+    ASTBytes = Ctx.getBytesAllocated();
+  }
+  setBytesProcessed(State, makeProgram());
+  State.counters["ASTBytes"] = static_cast<double>(ASTBytes);
+}
+BENCHMARK(BM_ParseTokenStream);
+
+/// Parsing call-heavy code, where most nodes carry short argument lists, into
+/// a single context holding the whole program. PeakRSS covers the process, so
+/// it is only meaningful when this benchmark runs on its own.
+void BM_ParseCalls(benchmark::State& State) {
+  static const std::string Program = makeCallProgram(20000);
+  Lexer       Lex{SourceBuffer::getMemBuffer(Program)};
+  TokenStream Tokens   = Lex.tokenize();
+  std::size_t ASTBytes = 0;
+  for (auto _ : State) {
+    ASTContext Ctx;
+    Parser     Parse{Tokens};
+    while (!llvm::isa<EndOfFileAST>(Parse.parse(Ctx))) {}
+    ASTBytes = Ctx.getBytesAllocated();
+  }
+  setBytesProcessed(State, Program);
+  State.counters["ASTBytes"] = static_cast<double>(ASTBytes);
+  State.counters["PeakRSS"]  = getPeakRSS();
+}
+BENCHMARK(BM_ParseCalls);
+
+/// Reparsing after an edit to one definition, alternating between two
+/// versions of the program that differ in it.
+void BM_ParseIncremental(benchmark::State& State) {
+  static const std::string A = makeProgram() + "def g(x) 1;\n";
+  static const std::string B = makeProgram() + "def g(x) x;\n";
+  Lexer             LexA{SourceBuffer::getMemBuffer(A)};
+  Lexer             LexB{SourceBuffer::getMemBuffer(B)};
+  TokenStream       Versions[] = {LexA.tokenize(), LexB.tokenize()};
+  IncrementalParser Parse;
+  std::size_t       Version = 0;
+  for (auto _ : State)
+    benchmark::DoNotOptimize(Parse.parse(Versions[Version++ % 2]));
+  setBytesProcessed(State, makeProgram());
+  State.counters["Parsed"] = static_cast<double>(Parse.getNumParsed());
+  for (const TokenStream& Tokens : Versions)
+    SourceManager::get().releaseBuffer(Tokens.getLoc(0));
+}
+BENCHMARK(BM_ParseIncremental);
+
+/// Lexing alone, split across State.range(0) threads, on 20MiB of source.
+void BM_TokenizeParallel(benchmark::State& State) {
+  static const std::string Program = makeProgram(200000);
+  for (auto _ : State)
+    benchmark::DoNotOptimize(Lexer::tokenizeParallel(
+        SourceBuffer::getMemBuffer(Program),
+        static_cast<unsigned>(State.range(0))
+    ));
+  setBytesProcessed(State, Program);
+}
+BENCHMARK(BM_TokenizeParallel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+/// Parsing alone, split across State.range(0) threads, on 2MiB of source.
+void BM_ParseParallel(benchmark::State& State) {
+  static const std::string Program = makeProgram(20000);
+  Lexer       Lex{SourceBuffer::getMemBuffer(Program)};
+  TokenStream Tokens = Lex.tokenize();
+  for (auto _ : State)
+    benchmark::DoNotOptimize(
+        Parser::parseParallel(Tokens, static_cast<unsigned>(State.range(0)))
+    );
+  setBytesProcessed(State, Program);
+}
+BENCHMARK(BM_ParseParallel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+} // namespace
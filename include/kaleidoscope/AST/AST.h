@@ -1,18 +1,17 @@
 #ifndef KALEIDOSCOPE_AST_AST_H
 #define KALEIDOSCOPE_AST_AST_H
 
-#include <llvm/Support/Casting.h>
+#include "kaleidoscope/AST/ASTRef.h"
+#include "kaleidoscope/Util/SourceLocation.h"
+#include "kaleidoscope/Util/Symbol.h"
 
-#include <fmt/compile.h>
-#include <fmt/format.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/Casting.h>
 
-#include <array>
-#include <iterator>
-#include <memory>
-#include <string>
+#include <cassert>
+#include <cstdint>
 #include <string_view>
 #include <utility>
-#include <vector>
 
 namespace kaleidoscope {
 
@@ -24,6 +23,11 @@ namespace kaleidoscope {
 
 /// ----------------------------------------------------------------------------
 /// Abstract Syntax Tree
+///
+/// Nodes are allocated in an ASTContext and refer to their children and arrays
+/// through ASTRef and ASTArrayRef, so a tree is one flat block of memory. They
+/// are trivially destructible so a whole tree is freed at once with its
+/// context.
 /// ----------------------------------------------------------------------------
 
 class ASTNode {
@@ -50,18 +54,32 @@ class ASTNode {
  private:
   const ASTNodeKind MyKind;
 
+  /// Loc - The location of the node's leading token, or of the operator for
+  /// operator expressions.
+  const SourceLocation Loc;
+
  protected:
-  constexpr ASTNode(ASTNodeKind K) noexcept : MyKind(K) {}
+  constexpr ASTNode(ASTNodeKind K, SourceLocation Loc) noexcept
+      : MyKind(K)
+      , Loc(Loc) {}
 
  public:
-  ASTNode()                             = delete;
-  constexpr virtual ~ASTNode() noexcept = default;
+  ASTNode() = delete;
 
   [[nodiscard]] constexpr auto getKind() const noexcept -> ASTNodeKind {
     return MyKind;
   }
+
+  [[nodiscard]] constexpr auto getLoc() const noexcept -> SourceLocation {
+    return Loc;
+  }
 };
 
+static_assert(
+    sizeof(ASTNode) == 2 * sizeof(std::uint32_t),
+    "ASTNode should hold nothing but its kind and location"
+);
+
 /// ----------------------------------------------------------------------------
 /// Expression ASTs - Nodes that can occur inside the body of functions
 /// ----------------------------------------------------------------------------
@@ -72,11 +90,11 @@ class ExprAST : public ASTNode {
   static constexpr ASTNodeKind Kind = ANK_ExprAST;
 
  protected:
-  constexpr ExprAST(ASTNodeKind K) noexcept : ASTNode(K) {}
+  constexpr ExprAST(ASTNodeKind K, SourceLocation Loc) noexcept
+      : ASTNode(K, Loc) {}
 
  public:
-  ExprAST()                              = delete;
-  constexpr ~ExprAST() noexcept override = default;
+  ExprAST() = delete;
 
   LLVM_CLASS_OF(A) {
     return A->getKind() >= ANK_ExprAST && A->getKind() <= ANK_LastExprAST;
@@ -85,20 +103,24 @@ class ExprAST : public ASTNode {
 
 /// BinaryExprAST - Expression class for a binary operator.
 class BinaryExprAST : public ExprAST {
-  const char                     Op;
-  const std::unique_ptr<ExprAST> LHS, RHS;
+  const char            Op;
+  const ASTRef<ExprAST> LHS;
+  const ASTRef<ExprAST> RHS;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_BinaryExprAST;
   static constexpr std::string_view NodeName = "BinaryExprAST";
 
   BinaryExprAST(
-      char Op, std::unique_ptr<ExprAST> LHS, std::unique_ptr<ExprAST> RHS
+      char           Op,
+      const ExprAST* LHS,
+      const ExprAST* RHS,
+      SourceLocation Loc = {}
   ) noexcept
-      : ExprAST(Kind)
+      : ExprAST(Kind, Loc)
       , Op(Op)
-      , LHS(std::move(LHS))
-      , RHS(std::move(RHS)) {}
+      , LHS(LHS)
+      , RHS(RHS) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
@@ -111,17 +133,19 @@ class BinaryExprAST : public ExprAST {
 
 /// UnaryExprAST - Expression class for a unary operator.
 class UnaryExprAST : public ExprAST {
-  const char                     Opcode;
-  const std::unique_ptr<ExprAST> Operand;
+  const char            Opcode;
+  const ASTRef<ExprAST> Operand;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_UnaryExprAST;
   static constexpr std::string_view NodeName = "UnaryExprAST";
 
-  UnaryExprAST(char Op, std::unique_ptr<ExprAST> Operand) noexcept
-      : ExprAST(Kind)
+  UnaryExprAST(
+      char Op, const ExprAST* Operand, SourceLocation Loc = {}
+  ) noexcept
+      : ExprAST(Kind, Loc)
       , Opcode(Op)
-      , Operand(std::move(Operand)) {}
+      , Operand(Operand) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
@@ -134,60 +158,63 @@ class UnaryExprAST : public ExprAST {
 
 /// CallExprAST - Expression class for function calls.
 class CallExprAST : public ExprAST {
-  const std::string                           Callee;
-  const std::vector<std::unique_ptr<ExprAST>> Args;
+  const Symbol                       Callee;
+  const ASTArrayRef<ASTRef<ExprAST>> Args;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_CallExprAST;
   static constexpr std::string_view NodeName = "CallExprAST";
 
+  /// Args must be allocated in the same ASTContext item as the node.
   CallExprAST(
-      std::string Callee, std::vector<std::unique_ptr<ExprAST>> Args
+      Symbol                          Callee,
+      llvm::ArrayRef<ASTRef<ExprAST>> Args,
+      SourceLocation                  Loc = {}
   ) noexcept
-      : ExprAST(Kind)
-      , Callee(std::move(Callee))
-      , Args(std::move(Args)) {}
+      : ExprAST(Kind, Loc)
+      , Callee(Callee)
+      , Args(Args) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
-  [[nodiscard]] auto getCallee() const noexcept -> const std::string& {
-    return Callee;
-  }
+  [[nodiscard]] auto getCallee() const noexcept -> Symbol { return Callee; }
 
   [[nodiscard]] auto getArgs() const noexcept
-      -> const std::vector<std::unique_ptr<ExprAST>>& {
-    return Args;
+      -> llvm::ArrayRef<ASTRef<ExprAST>> {
+    return Args.get();
   }
 };
 
 /// ForExprAST - Expression class for for/in.
 class ForExprAST : public ExprAST {
-  const std::string              VarName;
-  const std::unique_ptr<ExprAST> Start, End, Step, Body;
+  const Symbol          VarName;
+  const ASTRef<ExprAST> Start;
+  const ASTRef<ExprAST> End;
+  const ASTRef<ExprAST> Step;
+  const ASTRef<ExprAST> Body;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_ForExprAST;
   static constexpr std::string_view NodeName = "ForExprAST";
 
   ForExprAST(
-      std::string              VarName,
-      std::unique_ptr<ExprAST> Start,
-      std::unique_ptr<ExprAST> End,
-      std::unique_ptr<ExprAST> Step,
-      std::unique_ptr<ExprAST> Body
+      Symbol         VarName,
+      const ExprAST* Start,
+      const ExprAST* End,
+      const ExprAST* Step,
+      const ExprAST* Body,
+      SourceLocation Loc = {}
   ) noexcept
-      : ExprAST(Kind)
-      , VarName(std::move(VarName))
-      , Start(std::move(Start))
-      , End(std::move(End))
-      , Step(std::move(Step))
-      , Body(std::move(Body)) {}
+      : ExprAST(Kind, Loc)
+      , VarName(VarName)
+      , Start(Start)
+      , End(End)
+      , Step(Step)
+      , Body(Body) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
-  [[nodiscard]] auto getVarName() const noexcept -> const std::string& {
-    return VarName;
-  }
+  [[nodiscard]] auto getVarName() const noexcept -> Symbol { return VarName; }
 
   [[nodiscard]] auto getStart() const noexcept -> const ExprAST& {
     return *Start;
@@ -206,21 +233,24 @@ class ForExprAST : public ExprAST {
 
 /// IfExprAST - Expression class for if/then/else.
 class IfExprAST : public ExprAST {
-  const std::unique_ptr<ExprAST> Cond, Then, Else;
+  const ASTRef<ExprAST> Cond;
+  const ASTRef<ExprAST> Then;
+  const ASTRef<ExprAST> Else;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_IfExprAST;
   static constexpr std::string_view NodeName = "IfExprAST";
 
   IfExprAST(
-      std::unique_ptr<ExprAST> Cond,
-      std::unique_ptr<ExprAST> Then,
-      std::unique_ptr<ExprAST> Else
+      const ExprAST* Cond,
+      const ExprAST* Then,
+      const ExprAST* Else,
+      SourceLocation Loc = {}
   ) noexcept
-      : ExprAST(Kind)
-      , Cond(std::move(Cond))
-      , Then(std::move(Then))
-      , Else(std::move(Else)) {}
+      : ExprAST(Kind, Loc)
+      , Cond(Cond)
+      , Then(Then)
+      , Else(Else) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
@@ -245,7 +275,9 @@ class NumberExprAST : public ExprAST {
   static constexpr ASTNodeKind      Kind     = ANK_NumberExprAST;
   static constexpr std::string_view NodeName = "NumberExprAST";
 
-  constexpr NumberExprAST(double Val) noexcept : ExprAST(Kind), Val(Val) {}
+  constexpr NumberExprAST(double Val, SourceLocation Loc = {}) noexcept
+      : ExprAST(Kind, Loc)
+      , Val(Val) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
@@ -254,48 +286,49 @@ class NumberExprAST : public ExprAST {
 
 /// VariableExprAST - Expression class for referencing a variable, like "a".
 class VariableExprAST : public ExprAST {
-  const std::string Name;
+  const Symbol Name;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_VariableExprAST;
   static constexpr std::string_view NodeName = "VariableExprAST";
 
-  VariableExprAST(std::string Name) noexcept
-      : ExprAST(Kind)
-      , Name(std::move(Name)) {}
+  VariableExprAST(Symbol Name, SourceLocation Loc = {}) noexcept
+      : ExprAST(Kind, Loc)
+      , Name(Name) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
-  [[nodiscard]] auto getName() const noexcept -> const std::string& {
-    return Name;
-  }
+  [[nodiscard]] auto getName() const noexcept -> Symbol { return Name; }
 };
 
 /// VarAssignExprAST - Expression class for referencing a variable, like "a".
 class VarAssignExprAST : public ExprAST {
  public:
-  using VarAssignPair = std::pair<std::string, std::unique_ptr<ExprAST>>;
+  using VarAssignPair = std::pair<Symbol, ASTRef<ExprAST>>;
 
  private:
-  std::vector<VarAssignPair> VarAs;
-  std::unique_ptr<ExprAST>   Body;
+  const ASTArrayRef<VarAssignPair> VarAs;
+  const ASTRef<ExprAST>            Body;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_VarAssignExprAST;
   static constexpr std::string_view NodeName = "VarAssignExprAST";
 
+  /// VarAs must be allocated in the same ASTContext item as the node.
   VarAssignExprAST(
-      std::vector<VarAssignPair> VarAs, std::unique_ptr<ExprAST> Body
+      llvm::ArrayRef<VarAssignPair> VarAs,
+      const ExprAST*                Body,
+      SourceLocation                Loc = {}
   ) noexcept
-      : ExprAST(Kind)
-      , VarAs(std::move(VarAs))
-      , Body(std::move(Body)) {}
+      : ExprAST(Kind, Loc)
+      , VarAs(VarAs)
+      , Body(Body) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
   [[nodiscard]] auto getVarAs() const noexcept
-      -> const std::vector<VarAssignPair>& {
-    return VarAs;
+      -> llvm::ArrayRef<VarAssignPair> {
+    return VarAs.get();
   }
 
   [[nodiscard]] auto getBody() const noexcept -> const ExprAST& {
@@ -311,39 +344,39 @@ class VarAssignExprAST : public ExprAST {
 /// which captures its name, and its argument names (thus implicitly the number
 /// of arguments the function takes).
 class PrototypeAST : public ASTNode {
-  const std::string              Name;
-  const std::vector<std::string> Args;
+  const Symbol              Name;
+  const ASTArrayRef<Symbol> Args;
 
  protected:
   PrototypeAST(
-      ASTNodeKind K, std::string Name, std::vector<std::string> Args
+      ASTNodeKind            K,
+      Symbol                 Name,
+      llvm::ArrayRef<Symbol> Args,
+      SourceLocation         Loc
   ) noexcept
-      : ASTNode(K)
-      , Name(std::move(Name))
-      , Args(std::move(Args)) {}
+      : ASTNode(K, Loc)
+      , Name(Name)
+      , Args(Args) {}
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_PrototypeAST;
   static constexpr std::string_view NodeName = "PrototypeAST";
 
-  PrototypeAST(std::string Name, std::vector<std::string> Args) noexcept
-      : PrototypeAST(Kind, std::move(Name), std::move(Args)) {}
-
-  PrototypeAST(const PrototypeAST&) noexcept = default;
-  PrototypeAST(PrototypeAST&&) noexcept      = default;
-  ~PrototypeAST() override                   = default;
+  /// Args must be allocated in the same ASTContext item as the node, or be
+  /// empty.
+  PrototypeAST(
+      Symbol Name, llvm::ArrayRef<Symbol> Args, SourceLocation Loc = {}
+  ) noexcept
+      : PrototypeAST(Kind, Name, Args, Loc) {}
 
   LLVM_CLASS_OF(A) {
     return A->getKind() >= Kind && A->getKind() <= ANK_LastPrototypeAST;
   }
 
-  [[nodiscard]] auto getName() const noexcept -> const std::string& {
-    return Name;
-  }
+  [[nodiscard]] auto getName() const noexcept -> Symbol { return Name; }
 
-  [[nodiscard]] auto getArgs() const noexcept
-      -> const std::vector<std::string>& {
-    return Args;
+  [[nodiscard]] auto getArgs() const noexcept -> llvm::ArrayRef<Symbol> {
+    return Args.get();
   }
 };
 
@@ -356,24 +389,26 @@ class ProtoBinaryAST : public PrototypeAST {
   static constexpr ASTNodeKind      Kind     = ANK_ProtoBinaryAST;
   static constexpr std::string_view NodeName = "ProtoBinaryAST";
 
+  /// Args holds the two operand names.
   ProtoBinaryAST(
-      char Op, std::array<std::string, 2> Args, int Precedence
+      char                   Op,
+      llvm::ArrayRef<Symbol> Args,
+      int                    Precedence,
+      SourceLocation         Loc = {}
   ) noexcept
-      : PrototypeAST(
-          Kind,
-          fmt::format(FMT_COMPILE("binary{}"), Op),
-          {std::make_move_iterator(Args.begin()),
-           std::make_move_iterator(Args.end())}
-      )
-      , Precedence(Precedence) {}
-
-  ProtoBinaryAST(const ProtoBinaryAST&) noexcept = default;
-  ProtoBinaryAST(ProtoBinaryAST&&) noexcept      = default;
+      : PrototypeAST(Kind, getFunctionName(Op), Args, Loc)
+      , Precedence(Precedence) {
+    assert(Args.size() == 2 && "binary operators take two operands");
+  }
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
+  /// getFunctionName - The name of the function defining the binary operator
+  /// Op, like "binary|". The names of the ASCII operators are interned once.
+  static auto getFunctionName(char Op) -> Symbol;
+
   [[nodiscard]] auto getOperator() const noexcept -> char {
-    return getName().back();
+    return getName().str().back();
   }
 
   [[nodiscard]] auto getPrecedence() const noexcept -> int {
@@ -388,21 +423,22 @@ class ProtoUnaryAST : public PrototypeAST {
   static constexpr ASTNodeKind      Kind     = ANK_ProtoUnaryAST;
   static constexpr std::string_view NodeName = "ProtoUnaryAST";
 
-  ProtoUnaryAST(char Op, std::array<std::string, 1> Args) noexcept
-      : PrototypeAST(
-          Kind,
-          fmt::format(FMT_COMPILE("unary{}"), Op),
-          {std::make_move_iterator(Args.begin()),
-           std::make_move_iterator(Args.end())}
-      ) {}
-
-  ProtoUnaryAST(const ProtoUnaryAST&) noexcept = default;
-  ProtoUnaryAST(ProtoUnaryAST&&) noexcept      = default;
+  /// Args holds the operand name.
+  ProtoUnaryAST(
+      char Op, llvm::ArrayRef<Symbol> Args, SourceLocation Loc = {}
+  ) noexcept
+      : PrototypeAST(Kind, getFunctionName(Op), Args, Loc) {
+    assert(Args.size() == 1 && "unary operators take one operand");
+  }
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
+  /// getFunctionName - The name of the function defining the unary operator
+  /// Op, like "unary!". The names of the ASCII operators are interned once.
+  static auto getFunctionName(char Op) -> Symbol;
+
   [[nodiscard]] auto getOperator() const noexcept -> char {
-    return getName().back();
+    return getName().str().back();
   }
 };
 
@@ -412,19 +448,19 @@ class ProtoUnaryAST : public PrototypeAST {
 
 /// FunctionAST - This class represents a function definition itself.
 class FunctionAST : public ASTNode {
-  const std::unique_ptr<PrototypeAST> Proto;
-  const std::unique_ptr<ExprAST>      Body;
+  const ASTRef<PrototypeAST> Proto;
+  const ASTRef<ExprAST>      Body;
 
  public:
   static constexpr ASTNodeKind      Kind     = ANK_FunctionAST;
   static constexpr std::string_view NodeName = "FunctionAST";
 
   FunctionAST(
-      std::unique_ptr<PrototypeAST> Proto, std::unique_ptr<ExprAST> Body
+      const PrototypeAST* Proto, const ExprAST* Body, SourceLocation Loc = {}
   ) noexcept
-      : ASTNode(Kind)
-      , Proto(std::move(Proto))
-      , Body(std::move(Body)) {}
+      : ASTNode(Kind, Loc)
+      , Proto(Proto)
+      , Body(Body) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 
@@ -443,7 +479,8 @@ class EndOfFileAST : public ASTNode {
   static constexpr ASTNodeKind      Kind     = ANK_EndOfFileAST;
   static constexpr std::string_view NodeName = "EndOfFileAST";
 
-  constexpr EndOfFileAST() noexcept : ASTNode(Kind) {}
+  constexpr EndOfFileAST(SourceLocation Loc = {}) noexcept
+      : ASTNode(Kind, Loc) {}
 
   LLVM_CLASS_OF(A) { return A->getKind() == Kind; }
 };
@@ -0,0 +1,221 @@
+#ifndef KALEIDOSCOPE_AST_ASTCONTEXT_H
+#define KALEIDOSCOPE_AST_ASTCONTEXT_H
+
+#include "kaleidoscope/AST/AST.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/MathExtras.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kaleidoscope {
+
+class ASTContext;
+
+/// ASTHandle - A node of the item being built in an ASTContext, by its offset
+/// from the start of the item. Unlike a pointer it stays valid when the item
+/// moves to a bigger slab, so builders hold handles until the item is done.
+template<typename T>
+class ASTHandle {
+  template<typename U>
+  friend class ASTHandle;
+  friend class ASTContext;
+
+  static constexpr std::uint32_t Null = ~0U;
+
+  std::uint32_t Offset = Null;
+
+  explicit constexpr ASTHandle(std::uint32_t Offset) noexcept
+      : Offset(Offset) {}
+
+ public:
+  constexpr ASTHandle(std::nullptr_t = nullptr) noexcept {}
+
+  template<
+      typename U,
+      typename = std::enable_if_t<std::is_base_of_v<T, U>>>
+  constexpr ASTHandle(ASTHandle<U> H) noexcept
+      : Offset(H.Offset) {}
+
+  explicit constexpr operator bool() const noexcept { return Offset != Null; }
+};
+
+/// ASTArrayHandle - An array of the item being built, like ASTHandle.
+template<typename T>
+class ASTArrayHandle {
+  friend class ASTContext;
+
+  std::uint32_t Offset = 0;
+  std::uint32_t Size   = 0;
+
+  constexpr ASTArrayHandle(std::uint32_t Offset, std::uint32_t Size) noexcept
+      : Offset(Offset)
+      , Size(Size) {}
+
+ public:
+  constexpr ASTArrayHandle() noexcept = default;
+};
+
+/// ASTContext - An arena which owns AST nodes and the arrays they reference.
+///
+/// Nodes are built one top-level item at a time, and each item is kept in one
+/// contiguous block so nodes can refer to each other with 32-bit ASTRefs. When
+/// an item outgrows its slab, the item alone moves to a bigger one; the items
+/// before it stay put, so pointers to finished items remain valid.
+///
+/// Nodes are trivially destructible and never destroyed one by one; the whole
+/// context is released at once when it is reset or goes away, so freeing an
+/// AST costs O(1) regardless of its size.
+class ASTContext {
+  /// ItemAlign - The alignment of slabs and items, enough for any node.
+  static constexpr std::size_t ItemAlign = alignof(std::uint64_t);
+
+  /// MinSlabSize - The size of the first slab.
+  static constexpr std::size_t MinSlabSize = 4096;
+
+  struct Slab {
+    std::unique_ptr<std::uint64_t[]> Mem;
+    std::size_t                      Size;
+  };
+
+  /// Slabs - The memory handed out so far; only the last one has room left.
+  std::vector<Slab> Slabs{};
+
+  /// ItemBegin/ItemEnd - The bytes of the last slab used by the current item.
+  std::size_t ItemBegin = 0, ItemEnd = 0;
+
+  std::size_t BytesAllocated = 0;
+
+  [[nodiscard]] auto itemBase() const noexcept -> std::byte* {
+    return reinterpret_cast<std::byte*>(Slabs.back().Mem.get()) + ItemBegin;
+  }
+
+  /// allocate - Makes room for Size bytes in the current item, returning
+  /// their offset in it.
+  auto allocate(std::size_t Size, std::size_t Align) -> std::uint32_t {
+    std::size_t Begin = llvm::alignTo(ItemEnd, Align);
+    if (Slabs.empty() || Begin + Size > Slabs.back().Size) {
+      moveItem(Begin - ItemBegin + Size);
+      Begin = llvm::alignTo(ItemEnd, Align);
+    }
+    ItemEnd         = Begin + Size;
+    BytesAllocated += Size;
+    return static_cast<std::uint32_t>(Begin - ItemBegin);
+  }
+
+  /// moveItem - Moves the current item to a new slab with room for at least
+  /// Needed bytes.
+  void moveItem(std::size_t Needed);
+
+  /// resolve - Turns handles into the pointers and arrays nodes are built
+  /// from, passing anything else through.
+  template<typename T>
+  auto resolve(T&& V) const noexcept -> decltype(auto) {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (IsHandle<U>::value) return get(V);
+    else if constexpr (IsArrayHandle<U>::value) return get(V);
+    else if constexpr (IsHandlePair<U>::value)
+      return std::pair(V.first, get(V.second));
+    else return std::forward<T>(V);
+  }
+
+  template<typename T>
+  struct IsHandle : std::false_type {};
+  template<typename T>
+  struct IsHandle<ASTHandle<T>> : std::true_type {};
+
+  template<typename T>
+  struct IsArrayHandle : std::false_type {};
+  template<typename T>
+  struct IsArrayHandle<ASTArrayHandle<T>> : std::true_type {};
+
+  template<typename T>
+  struct IsHandlePair : std::false_type {};
+  template<typename T, typename U>
+  struct IsHandlePair<std::pair<T, ASTHandle<U>>> : std::true_type {};
+
+ public:
+  ASTContext()                                     = default;
+  ASTContext(const ASTContext&)                    = delete;
+  auto operator=(const ASTContext&) -> ASTContext& = delete;
+
+  /// beginItem - Starts a new top-level item. Handles to the previous item
+  /// become invalid, but pointers to its nodes stay valid.
+  void beginItem() noexcept {
+    ItemBegin = ItemEnd = llvm::alignTo(ItemEnd, ItemAlign);
+  }
+
+  /// create - Allocates a T in the current item, constructed from Args with
+  /// any handles among them resolved.
+  template<typename T, typename... ArgTs>
+  auto create(ArgTs&&... Args) -> ASTHandle<T> {
+    static_assert(std::is_base_of_v<ASTNode, T>, "only AST nodes live here");
+    static_assert(
+        std::is_trivially_destructible_v<T>,
+        "arena nodes are never destroyed, so must not own resources"
+    );
+    static_assert(alignof(T) <= ItemAlign);
+    std::uint32_t Offset = allocate(sizeof(T), alignof(T));
+    new (itemBase() + Offset) T(resolve(std::forward<ArgTs>(Args))...);
+    return ASTHandle<T>(Offset);
+  }
+
+  /// copyArray - Copies Elts into the current item as an array of T, with
+  /// any handles among them resolved.
+  template<typename T, typename RangeT>
+  auto copyArray(const RangeT& Elts) -> ASTArrayHandle<T> {
+    static_assert(std::is_trivially_destructible_v<T>);
+    static_assert(alignof(T) <= ItemAlign);
+    auto Size = static_cast<std::uint32_t>(std::size(Elts));
+    if (Size == 0) return {};
+    std::uint32_t Offset = allocate(Size * sizeof(T), alignof(T));
+    auto*         Mem    = reinterpret_cast<T*>(itemBase() + Offset);
+    for (const auto& Elt : Elts) new (Mem++) T(resolve(Elt));
+    return {Offset, Size};
+  }
+
+  /// get - The node H refers to, which must be in the current item.
+  template<typename T>
+  [[nodiscard]] auto get(ASTHandle<T> H) const noexcept -> const T* {
+    if (!H) return nullptr;
+    return reinterpret_cast<const T*>(itemBase() + H.Offset);
+  }
+
+  /// get - The array H refers to, which must be in the current item.
+  template<typename T>
+  [[nodiscard]] auto get(ASTArrayHandle<T> H) const noexcept
+      -> llvm::ArrayRef<T> {
+    if (H.Size == 0) return {};
+    return {reinterpret_cast<const T*>(itemBase() + H.Offset), H.Size};
+  }
+
+  /// copy - Copies P, including its argument list, into the current item.
+  auto copy(const PrototypeAST& P) -> ASTHandle<PrototypeAST>;
+
+  /// clone - Copies P, including its argument list, into this context as an
+  /// item of its own.
+  auto clone(const PrototypeAST& P) -> const PrototypeAST* {
+    beginItem();
+    return get(copy(P));
+  }
+
+  /// reset - Releases every node allocated so far. The largest slab is kept
+  /// for reuse, so a context reset after each top-level item stops allocating
+  /// once it has grown to fit the largest one.
+  void reset();
+
+  /// getBytesAllocated - Total bytes handed out since the last reset.
+  [[nodiscard]] auto getBytesAllocated() const -> std::size_t {
+    return BytesAllocated;
+  }
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_AST_ASTCONTEXT_H
@@ -0,0 +1,93 @@
+#ifndef KALEIDOSCOPE_AST_ASTREF_H
+#define KALEIDOSCOPE_AST_ASTREF_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/Compiler.h>
+#include <llvm/Support/ErrorHandling.h>
+
+#include <cstdint>
+
+namespace kaleidoscope {
+
+/// ----------------------------------------------------------------------------
+/// Node references
+///
+/// Nodes refer to their children and arrays by a signed 32-bit byte offset
+/// from the reference itself instead of by pointer. ASTContext keeps each
+/// top-level item in one contiguous block, so offsets within a tree are small
+/// and survive the block being moved. References are position dependent: they
+/// are constructed in place from a pointer and cannot be copied.
+/// ----------------------------------------------------------------------------
+
+/// offsetBetween - The byte offset from From to To. An offset out of range
+/// would silently point at the wrong memory, so it is a fatal error in every
+/// build.
+inline auto offsetBetween(const void* From, const void* To) noexcept
+    -> std::int32_t {
+  auto Off = reinterpret_cast<std::intptr_t>(To)
+           - reinterpret_cast<std::intptr_t>(From);
+  if (LLVM_UNLIKELY(Off != static_cast<std::int32_t>(Off)))
+    llvm::report_fatal_error(
+        "node reference is too far away; allocate both in one ASTContext item"
+    );
+  return static_cast<std::int32_t>(Off);
+}
+
+/// ASTRef - A reference to a node in the same block.
+template<typename T>
+class ASTRef {
+  const std::int32_t Offset;
+
+ public:
+  ASTRef(const T* Node) noexcept
+      : Offset(offsetBetween(this, Node)) {}
+
+  ASTRef(const ASTRef&)                    = delete;
+  auto operator=(const ASTRef&) -> ASTRef& = delete;
+
+  [[nodiscard]] auto get() const noexcept -> const T* {
+    return reinterpret_cast<const T*>(
+        reinterpret_cast<const char*>(this) + Offset
+    );
+  }
+
+  auto operator*() const noexcept -> const T& { return *get(); }
+  auto operator->() const noexcept -> const T* { return get(); }
+};
+
+/// ASTArrayRef - A reference to an array in the same block.
+template<typename T>
+class ASTArrayRef {
+  const std::int32_t  Offset;
+  const std::uint32_t Size;
+
+ public:
+  ASTArrayRef(llvm::ArrayRef<T> Elts) noexcept
+      : Offset(Elts.empty() ? 0 : offsetBetween(this, Elts.data()))
+      , Size(static_cast<std::uint32_t>(Elts.size())) {}
+
+  ASTArrayRef(const ASTArrayRef&)                    = delete;
+  auto operator=(const ASTArrayRef&) -> ASTArrayRef& = delete;
+
+  [[nodiscard]] auto get() const noexcept -> llvm::ArrayRef<T> {
+    if (Size == 0) return {};
+    const auto* Data = reinterpret_cast<const char*>(this) + Offset;
+    return {reinterpret_cast<const T*>(Data), Size};
+  }
+};
+
+} // namespace kaleidoscope
+
+/// Lets isa/cast/dyn_cast look through an ASTRef to the node.
+template<typename T>
+struct llvm::simplify_type<const kaleidoscope::ASTRef<T>> {
+  using SimpleType = const T*;
+
+  static auto getSimplifiedValue(const kaleidoscope::ASTRef<T>& Ref)
+      -> SimpleType {
+    return Ref.get();
+  }
+};
+
+#endif // KALEIDOSCOPE_AST_ASTREF_H
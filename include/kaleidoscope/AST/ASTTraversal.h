@@ -0,0 +1,145 @@
+#ifndef KALEIDOSCOPE_AST_ASTTRAVERSAL_H
+#define KALEIDOSCOPE_AST_ASTTRAVERSAL_H
+
+#include "kaleidoscope/AST/AST.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/ErrorHandling.h>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace kaleidoscope {
+
+/// forEachChild - Calls F on each child of A, in the order they appear in the
+/// source. A function's prototype comes before its body; prototypes have no
+/// children.
+template<typename FnT>
+void forEachChild(const ASTNode& A, FnT&& F) {
+  switch (A.getKind()) {
+  case ASTNode::ANK_BinaryExprAST: {
+    const auto& B = llvm::cast<BinaryExprAST>(A);
+    F(B.getLHS());
+    F(B.getRHS());
+    return;
+  }
+  case ASTNode::ANK_UnaryExprAST:
+    F(llvm::cast<UnaryExprAST>(A).getOperand());
+    return;
+  case ASTNode::ANK_CallExprAST:
+    for (const auto& Arg : llvm::cast<CallExprAST>(A).getArgs()) F(*Arg);
+    return;
+  case ASTNode::ANK_ForExprAST: {
+    const auto& For = llvm::cast<ForExprAST>(A);
+    F(For.getStart());
+    F(For.getEnd());
+    F(For.getStep());
+    F(For.getBody());
+    return;
+  }
+  case ASTNode::ANK_IfExprAST: {
+    const auto& If = llvm::cast<IfExprAST>(A);
+    F(If.getCond());
+    F(If.getThen());
+    F(If.getElse());
+    return;
+  }
+  case ASTNode::ANK_VarAssignExprAST: {
+    const auto& Var = llvm::cast<VarAssignExprAST>(A);
+    for (const auto& [Name, Init] : Var.getVarAs()) F(*Init);
+    F(Var.getBody());
+    return;
+  }
+  case ASTNode::ANK_FunctionAST: {
+    const auto& Fn = llvm::cast<FunctionAST>(A);
+    F(Fn.getProto());
+    F(Fn.getBody());
+    return;
+  }
+  case ASTNode::ANK_NumberExprAST:
+  case ASTNode::ANK_VariableExprAST:
+  case ASTNode::ANK_PrototypeAST:
+  case ASTNode::ANK_ProtoUnaryAST:
+  case ASTNode::ANK_ProtoBinaryAST:
+  case ASTNode::ANK_EndOfFileAST: return;
+  case ASTNode::ANK_ExprAST:
+  case ASTNode::ANK_LastExprAST:
+  case ASTNode::ANK_LastPrototypeAST: break;
+  }
+  llvm_unreachable("Missing an AST type being handled");
+}
+
+/// ASTTraversal - Walks an AST with an explicit work stack instead of
+/// recursion, so how deep a tree can be is bounded by memory rather than by
+/// the native stack. A pass opts in by deriving from it and defining either
+/// hook:
+///
+///   auto preVisit(const ASTNode& A) -> bool
+///     Called before A's children; returning false skips them and A's
+///     postVisit.
+///   void postVisit(const ASTNode& A)
+///     Called once all of A's children are done.
+///
+/// Hooks can dispatch on the node's type by calling ASTVisitor::visit, as
+/// long as the visitImpl overloads they reach do not recurse themselves.
+template<typename SubClass>
+class ASTTraversal {
+  /// Frame - A node waiting for its children to be pushed, or for its
+  /// postVisit once they have been.
+  struct Frame {
+    const ASTNode* Node;
+    bool           Expanded;
+  };
+
+  llvm::SmallVector<Frame, 32> Work{};
+
+ protected:
+  ASTTraversal() noexcept  = default;
+  ~ASTTraversal() noexcept = default;
+
+  auto preVisit(const ASTNode&) -> bool { return true; }
+  void postVisit(const ASTNode&) {}
+
+ public:
+  /// traverse - Walks Root and everything below it in forEachChild's order.
+  /// Not reentrant: hooks must not call traverse.
+  void traverse(const ASTNode& Root) {
+    auto* Sub = static_cast<SubClass*>(this);
+    Work.push_back({&Root, false});
+    while (!Work.empty()) {
+      const ASTNode* Node = Work.back().Node;
+      if (Work.back().Expanded) {
+        Work.pop_back();
+        Sub->postVisit(*Node);
+        continue;
+      }
+      if (!Sub->preVisit(*Node)) {
+        Work.pop_back();
+        continue;
+      }
+      Work.back().Expanded = true;
+      std::size_t First    = Work.size();
+      forEachChild(*Node, [&](const ASTNode& C) {
+        Work.push_back({&C, false});
+      });
+      std::reverse(Work.begin() + First, Work.end());
+    }
+  }
+};
+
+/// NodeCounter - Counts the nodes of the trees it traverses.
+class NodeCounter : public ASTTraversal<NodeCounter> {
+  friend ASTTraversal<NodeCounter>;
+
+  std::size_t Count = 0;
+
+  void postVisit(const ASTNode&) { ++Count; }
+
+ public:
+  [[nodiscard]] auto getCount() const noexcept -> std::size_t { return Count; }
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_AST_ASTTRAVERSAL_H
@@ -26,14 +26,14 @@ case AST_TYPE::Kind:                                                           \
  return DELEGATE(llvm::cast<AST_TYPE>(A))
 
 #define VISIT_AST(AST_TYPE)                                                    \
- auto visit(const AST_TYPE& A) { return DELEGATE(A); }
+ decltype(auto) visit(const AST_TYPE& A) { return DELEGATE(A); }
 
  protected:
   constexpr ASTVisitor() noexcept  = default;
   constexpr ~ASTVisitor() noexcept = default;
 
  public:
-  auto visit(const ASTNode& A) {
+  decltype(auto) visit(const ASTNode& A) {
     const ASTNode* AP = &A;
 #define VISIT_CAST(_type_)                                                     \
  if (const auto* E = llvm::dyn_cast<_type_>(AP)) return visit(*E)
@@ -47,7 +47,7 @@ case AST_TYPE::Kind:                                                           \
 #undef VISIT_CAST
   }
 
-  auto visit(const ExprAST& A) {
+  decltype(auto) visit(const ExprAST& A) {
     if constexpr ((Delegate & AVDelType::ExprAST) != AVDelType::None) {
       switch (A.getKind()) {
         HANDLE_EXPR_AST(BinaryExprAST);
@@ -82,7 +82,7 @@ case AST_TYPE::Kind:                                                           \
   VISIT_AST(VariableExprAST)
   VISIT_AST(VarAssignExprAST)
 
-  auto visit(const PrototypeAST& A) {
+  decltype(auto) visit(const PrototypeAST& A) {
     if constexpr ((Delegate & AVDelType::PrototypeAST) != AVDelType::None) {
       switch (A.getKind()) {
         HANDLE_EXPR_AST(PrototypeAST);
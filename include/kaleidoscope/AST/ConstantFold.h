@@ -0,0 +1,92 @@
+#ifndef KALEIDOSCOPE_AST_CONSTANTFOLD_H
+#define KALEIDOSCOPE_AST_CONSTANTFOLD_H
+
+#include "kaleidoscope/AST/ASTContext.h"
+#include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/Util/SourceLocation.h"
+
+#include <cstddef>
+
+namespace kaleidoscope::ast {
+
+/// ConstantFold - Copies top-level items into an ASTContext with their
+/// constant parts evaluated, so CodeGen does not build IR only for LLVM to
+/// fold it away again. The copy:
+///
+///   - evaluates the builtin operators + - * / < > on constants, with the
+///     same IEEE semantics the IR they would become has,
+///   - keeps only the taken branch of an if whose condition is constant,
+///   - drops the constant left side of a ':' sequence, and
+///   - removes operations that give back their other operand unchanged:
+///     x*1, 1*x, x/1, x-0, x+(-0) and (-0)+x.
+///
+/// Anything that may have an effect, like calls, user-defined operators,
+/// assignments and loops, is kept, though its operands are folded. A dropped
+/// branch is not checked, so errors CodeGen would have reported in it, like
+/// an unknown function, go away with it.
+class ConstantFold : private ASTVisitor<ConstantFold, AVDelType::ExprAST> {
+  using Self   = ConstantFold;
+  using Parent = ASTVisitor<Self, AVDelType::ExprAST>;
+  friend Parent;
+
+  /// Folded - A folded expression: either a constant, which is only given a
+  /// node when something needs it as an operand, or its copy.
+  struct Folded {
+    ASTHandle<ExprAST> Node{};
+    double             Val = 0;
+    SourceLocation     Loc{};
+
+    [[nodiscard]] auto isConstant() const noexcept -> bool { return !Node; }
+  };
+
+  ASTContext& Ctx;
+
+  std::size_t NumOriginal = 0;
+  std::size_t NumFolded   = 0;
+
+ public:
+  explicit ConstantFold(ASTContext& Ctx) noexcept
+      : Ctx(Ctx) {}
+
+  /// fold - Copies F into the context as an item of its own.
+  auto fold(const FunctionAST& F) -> const FunctionAST*;
+
+  /// fold - Copies E, a top-level expression, into the context as an item of
+  /// its own.
+  auto fold(const ExprAST& E) -> const ExprAST*;
+
+  /// getNumEliminated - How many nodes of the last item folded are not in
+  /// its copy.
+  [[nodiscard]] auto getNumEliminated() const noexcept -> std::size_t {
+    return NumOriginal - NumFolded;
+  }
+
+ private:
+  void beginItem();
+
+  /// node - The node of F, creating it for a constant.
+  auto node(const Folded& F) -> ASTHandle<ExprAST>;
+
+  /// copy - Wraps the copy H of a node of the original.
+  template<typename T>
+  auto copy(ASTHandle<T> H) -> Folded {
+    ++NumFolded;
+    return {H};
+  }
+
+  /// drop - Counts the nodes of E, which is left out of the copy.
+  void drop(const ExprAST& E);
+
+  auto visitImpl(const BinaryExprAST& A) -> Folded;
+  auto visitImpl(const UnaryExprAST& A) -> Folded;
+  auto visitImpl(const CallExprAST& A) -> Folded;
+  auto visitImpl(const ForExprAST& A) -> Folded;
+  auto visitImpl(const IfExprAST& A) -> Folded;
+  auto visitImpl(const NumberExprAST& A) -> Folded;
+  auto visitImpl(const VariableExprAST& A) -> Folded;
+  auto visitImpl(const VarAssignExprAST& A) -> Folded;
+};
+
+} // namespace kaleidoscope::ast
+
+#endif // KALEIDOSCOPE_AST_CONSTANTFOLD_H
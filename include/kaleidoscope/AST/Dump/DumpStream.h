@@ -0,0 +1,76 @@
+#ifndef KALEIDOSCOPE_AST_DUMP_DUMPSTREAM_H
+#define KALEIDOSCOPE_AST_DUMP_DUMPSTREAM_H
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace kaleidoscope::ast {
+
+/// DumpStream - The output the AST dumpers write through. Text is gathered in
+/// a buffer that is handed to the stream in large blocks, and the spaces that
+/// indent each line are made once and reused. Whatever is still buffered is
+/// written out by flush or when the DumpStream is destroyed.
+class DumpStream {
+  /// FlushSize - How much is gathered before it is written to the stream.
+  static constexpr std::size_t FlushSize = 64 * 1024;
+
+  std::ostream&              Out;
+  llvm::SmallVector<char, 0> Buf{};
+  std::string                Spaces{};
+
+ public:
+  explicit DumpStream(std::ostream& Out) noexcept
+      : Out(Out) {}
+
+  DumpStream(const DumpStream&)                    = delete;
+  auto operator=(const DumpStream&) -> DumpStream& = delete;
+
+  ~DumpStream() { flush(); }
+
+  /// flush - Writes everything gathered so far to the stream.
+  void flush();
+
+  /// indent - Starts a line indented by N spaces.
+  auto indent(std::size_t N) -> DumpStream& {
+    if (Spaces.size() < N) Spaces.resize(std::max(N, 2 * Spaces.size()), ' ');
+    Buf.append(Spaces.data(), Spaces.data() + N);
+    return *this;
+  }
+
+  auto write(std::string_view S) -> DumpStream& {
+    Buf.append(S.begin(), S.end());
+    return *this;
+  }
+  auto write(char C) -> DumpStream& {
+    Buf.push_back(C);
+    return *this;
+  }
+
+  /// print - Formats Args into the buffer.
+  template<typename... Ts>
+  auto print(fmt::format_string<Ts...> Fmt, Ts&&... Args) -> DumpStream& {
+    fmt::format_to(std::back_inserter(Buf), Fmt, std::forward<Ts>(Args)...);
+    return *this;
+  }
+
+  /// endLine - Ends the current line, writing the buffer out once it is
+  /// large.
+  auto endLine() -> DumpStream& {
+    Buf.push_back('\n');
+    if (Buf.size() >= FlushSize) flush();
+    return *this;
+  }
+};
+
+} // namespace kaleidoscope::ast
+
+#endif // KALEIDOSCOPE_AST_DUMP_DUMPSTREAM_H
@@ -0,0 +1,111 @@
+#ifndef KALEIDOSCOPE_AST_DUMP_JSONDUMP_H
+#define KALEIDOSCOPE_AST_DUMP_JSONDUMP_H
+
+#include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/AST/Dump/DumpStream.h"
+#include "kaleidoscope/Util/Symbol.h"
+
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+
+namespace kaleidoscope::ast {
+
+/// JSONDump - Dumps an AST as JSON for tooling. Each node is an object whose
+/// "Kind" is the node's name, with the same fields XMLDump prints; lists of
+/// children are arrays, and a prototype's name and arguments sit beside its
+/// operator and precedence. Numbers that are not finite are written as the
+/// strings "inf", "-inf" and "nan". Each node visited is written as one
+/// value followed by a newline.
+class JSONDump : private ASTVisitor<JSONDump, AVDelType::All> {
+  using Self   = JSONDump;
+  using Parent = ASTVisitor<Self, AVDelType::All>;
+  friend Parent;
+
+  DumpStream  OS;
+  std::size_t Spaces;
+
+  /// First - Whether nothing has been written yet in the innermost object
+  /// or array.
+  bool First = true;
+
+ public:
+  JSONDump(std::ostream& Out, std::size_t Spaces = 0) noexcept
+      : OS(Out)
+      , Spaces(Spaces) {}
+
+  /// visit - Dumps A, writing it all out to the stream before returning.
+  template<typename T>
+  auto visit(const T& A) -> Self& {
+    OS.indent(Spaces);
+    Parent::visit(A);
+    OS.endLine().flush();
+    return *this;
+  }
+
+ private:
+  auto beginObject() -> Self&;
+  auto endObject() -> Self&;
+
+  /// beginNode - Starts the object of a node, beginning with its kind.
+  auto beginNode(std::string_view Kind) -> Self& {
+    return beginObject().key("Kind").writeString(Kind);
+  }
+
+  auto beginArray(std::string_view Key) -> Self&;
+  auto endArray() -> Self&;
+
+  /// element - Starts the next element of an array.
+  auto element() -> Self&;
+
+  /// key - Starts the member Key of an object.
+  auto key(std::string_view Key) -> Self&;
+
+  auto writeString(std::string_view S) -> Self&;
+  auto writeString(Symbol S) -> Self& {
+    return writeString(std::string_view(S.str()));
+  }
+  auto writeString(char C) -> Self& {
+    return writeString(std::string_view(&C, 1));
+  }
+  auto writeNumber(double V) -> Self&;
+
+  auto member(std::string_view Key, Symbol Val) -> Self& {
+    return key(Key).writeString(Val);
+  }
+  auto member(std::string_view Key, char Val) -> Self& {
+    return key(Key).writeString(Val);
+  }
+  auto member(std::string_view Key, double Val) -> Self& {
+    return key(Key).writeNumber(Val);
+  }
+  auto member(std::string_view Key, int Val) -> Self& {
+    return key(Key).writeNumber(Val);
+  }
+  auto member(std::string_view Key, const ASTNode& A) -> Self&;
+
+  auto visitImpl(const BinaryExprAST& A) -> Self&;
+  auto visitImpl(const UnaryExprAST& A) -> Self&;
+  auto visitImpl(const CallExprAST& A) -> Self&;
+  auto visitImpl(const ForExprAST& A) -> Self&;
+  auto visitImpl(const IfExprAST& A) -> Self&;
+  auto visitImpl(const NumberExprAST& A) -> Self&;
+  auto visitImpl(const VariableExprAST& A) -> Self&;
+  auto visitImpl(const VarAssignExprAST& A) -> Self&;
+
+  auto visitImpl(const FunctionAST& A) -> Self&;
+
+  /// prototype - Starts the object of a prototype of kind Kind with the
+  /// members every prototype has.
+  auto prototype(std::string_view Kind, const PrototypeAST& A) -> Self&;
+
+  auto visitImpl(const PrototypeAST& A) -> Self&;
+  auto visitImpl(const ProtoBinaryAST& A) -> Self&;
+  auto visitImpl(const ProtoUnaryAST& A) -> Self&;
+
+  auto visitImpl(const EndOfFileAST& A) -> Self&;
+};
+
+} // namespace kaleidoscope::ast
+
+#endif // KALEIDOSCOPE_AST_DUMP_JSONDUMP_H
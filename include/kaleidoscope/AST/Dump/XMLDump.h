@@ -2,38 +2,60 @@
 #define KALEIDOSCOPE_AST_DUMP_XMLDUMP_H
 
 #include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/AST/Dump/DumpStream.h"
+#include "kaleidoscope/Util/Symbol.h"
 
+#include <cstddef>
 #include <ostream>
+#include <string_view>
+#include <type_traits>
 
 namespace kaleidoscope::ast {
 
-/// Technically this isn't true XML and just XML inspired
+/// Technically this isn't true XML and just XML inspired: argument tags are
+/// written Arg[N]. Text content is escaped.
 class XMLDump : private ASTVisitor<XMLDump, AVDelType::All> {
   using Self   = XMLDump;
   using Parent = ASTVisitor<Self, AVDelType::All>;
   friend Parent;
 
-  std::ostream&     Out;
-  const std::size_t Spaces;
+  DumpStream  OS;
+  std::size_t Spaces;
 
  public:
   XMLDump(std::ostream& Out, std::size_t Spaces = 0) noexcept
-      : Out(Out)
+      : OS(Out)
       , Spaces(Spaces) {}
 
-  using Parent::visit;
+  /// visit - Dumps A, writing it all out to the stream before returning.
+  template<typename T>
+  auto visit(const T& A) -> Self& {
+    Parent::visit(A);
+    OS.flush();
+    return *this;
+  }
 
  private:
-  auto child(std::size_t MS) -> Self;
-
-  [[nodiscard]] auto padding(std::size_t MS = 0) -> std::string;
-
   auto open(std::string_view S, std::size_t MS = 0) -> Self&;
   auto close(std::string_view S, std::size_t MS = 0) -> Self&;
 
+  /// printSubItem - Prints Tag holding text, escaped.
+  auto printSubItem(
+      std::string_view Tag, std::string_view Text, std::size_t MS = 0
+  ) -> Self&;
+  auto printSubItem(std::string_view Tag, Symbol S, std::size_t MS = 0)
+      -> Self& {
+    return printSubItem(Tag, std::string_view(S.str()), MS);
+  }
+  auto printSubItem(std::string_view Tag, char C, std::size_t MS = 0)
+      -> Self& {
+    return printSubItem(Tag, std::string_view(&C, 1), MS);
+  }
+
+  /// printSubItem - Prints Tag holding a number.
   template<typename T>
-  auto printSubItem(std::string_view Tag, const T& Content, std::size_t MS = 0)
-      -> std::enable_if_t<fmt::is_formattable<T>::value, Self&>;
+  auto printSubItem(std::string_view Tag, T Content, std::size_t MS = 0)
+      -> std::enable_if_t<std::is_arithmetic_v<T>, Self&>;
 
   auto printSubAST(std::string_view Tag, const ASTNode& A, std::size_t MS = 0)
       -> Self&;
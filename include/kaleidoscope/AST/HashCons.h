@@ -0,0 +1,148 @@
+#ifndef KALEIDOSCOPE_AST_HASHCONS_H
+#define KALEIDOSCOPE_AST_HASHCONS_H
+
+#include "kaleidoscope/AST/ASTContext.h"
+#include "kaleidoscope/AST/ASTVisitor.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace kaleidoscope::ast {
+
+/// HashCons - Copies top-level items into an ASTContext with every repeated
+/// expression subtree allocated once and shared by all of its uses.
+///
+/// Each expression gets a structural hash built from its kind, its operator,
+/// value or names, and the hashes of its children; locations play no part.
+/// Subtrees are only shared within one item, since nodes refer to each other
+/// by ASTRef, and a shared node keeps the location of its first occurrence.
+///
+/// A variable reference is also keyed on the binding it refers to: an
+/// argument, or one for or var binding of the item. Two occurrences of a
+/// subtree are only shared if each of their variables is bound by the same
+/// binding, so the variables of a shared node are in scope wherever it is
+/// used, and the Resolver finds the same ones. A subtree that binds a
+/// variable and refers to it is therefore never shared.
+///
+/// Sharing is purely structural: two occurrences of a call or of a variable
+/// that is assigned in between may still evaluate differently, so callers
+/// looking for common subexpressions must check that reusing a value is safe.
+class HashCons : private ASTVisitor<HashCons, AVDelType::ExprAST> {
+  using Self   = HashCons;
+  using Parent = ASTVisitor<Self, AVDelType::ExprAST>;
+  friend Parent;
+
+  /// Entry - An expression of the item being copied, allocated once.
+  struct Entry {
+    ASTHandle<ExprAST> Node;
+    std::uint64_t      Hash;
+
+    /// KeyBegin/KeyEnd - The words of Keys that identify the node: its kind,
+    /// its fields and the entries of its children.
+    std::uint32_t KeyBegin, KeyEnd;
+
+    /// Occurrences - How many times the subtree occurs in the original.
+    std::uint32_t Occurrences;
+  };
+
+  ASTContext& Ctx;
+
+  std::vector<Entry>         Entries{};
+  std::vector<std::uint64_t> Keys{};
+
+  /// ByHash - The entry of the current item with each hash. Of two different
+  /// subtrees whose hashes collide only the first is shared.
+  llvm::DenseMap<std::uint64_t, std::uint32_t> ByHash{};
+
+  /// ByNode - The entry of each node of the last item copied.
+  llvm::DenseMap<const ExprAST*, std::uint32_t> ByNode{};
+
+  /// Scope - The variables in scope and the binding of each, numbered in
+  /// the order they were bound. A name shadows the same name earlier on.
+  llvm::SmallVector<std::pair<Symbol, std::uint32_t>, 16> Scope{};
+  std::uint32_t                                           NumBindings = 0;
+
+  std::size_t NumVisited = 0;
+
+ public:
+  explicit HashCons(ASTContext& Ctx) noexcept
+      : Ctx(Ctx) {}
+
+  /// intern - Copies F into the context as an item of its own.
+  auto intern(const FunctionAST& F) -> const FunctionAST*;
+
+  /// intern - Copies E, a top-level expression, into the context as an item
+  /// of its own.
+  auto intern(const ExprAST& E) -> const ExprAST*;
+
+  /// getHash - The structural hash of E, if it is a node of the last item
+  /// copied.
+  [[nodiscard]] auto getHash(const ExprAST& E) const
+      -> std::optional<std::uint64_t> {
+    auto It = ByNode.find(&E);
+    if (It == ByNode.end()) return std::nullopt;
+    return Entries[It->second].Hash;
+  }
+
+  /// getOccurrences - How many times E, a node of the last item copied,
+  /// occurred in the original, or 0 for any other node. More than one makes E
+  /// a common subexpression.
+  [[nodiscard]] auto getOccurrences(const ExprAST& E) const -> std::size_t {
+    auto It = ByNode.find(&E);
+    return It == ByNode.end() ? 0 : Entries[It->second].Occurrences;
+  }
+
+  /// getNumVisited/getNumUnique - How many expressions the last item copied
+  /// had, and how many of them were allocated.
+  [[nodiscard]] auto getNumVisited() const noexcept -> std::size_t {
+    return NumVisited;
+  }
+  [[nodiscard]] auto getNumUnique() const noexcept -> std::size_t {
+    return Entries.size();
+  }
+
+ private:
+  void beginItem();
+  void endItem();
+
+  /// bind - Brings a new binding of Name into scope.
+  void bind(Symbol Name) { Scope.emplace_back(Name, NumBindings++); }
+
+  /// bindingOf - The binding Name refers to, or ~0 if it is not in scope.
+  [[nodiscard]] auto bindingOf(Symbol Name) const -> std::uint64_t;
+
+  /// node - The node of entry Id.
+  [[nodiscard]] auto node(std::uint32_t Id) const -> ASTHandle<ExprAST> {
+    return Entries[Id].Node;
+  }
+
+  /// lookupOrCreate - The entry of the node with the given kind, fields and
+  /// children, calling Create to allocate it if there is none yet.
+  template<typename CreateT>
+  auto lookupOrCreate(
+      ASTNode::ASTNodeKind          Kind,
+      llvm::ArrayRef<std::uint64_t> Fields,
+      llvm::ArrayRef<std::uint32_t> Children,
+      CreateT&&                     Create
+  ) -> std::uint32_t;
+
+  auto visitImpl(const BinaryExprAST& A) -> std::uint32_t;
+  auto visitImpl(const UnaryExprAST& A) -> std::uint32_t;
+  auto visitImpl(const CallExprAST& A) -> std::uint32_t;
+  auto visitImpl(const ForExprAST& A) -> std::uint32_t;
+  auto visitImpl(const IfExprAST& A) -> std::uint32_t;
+  auto visitImpl(const NumberExprAST& A) -> std::uint32_t;
+  auto visitImpl(const VariableExprAST& A) -> std::uint32_t;
+  auto visitImpl(const VarAssignExprAST& A) -> std::uint32_t;
+};
+
+} // namespace kaleidoscope::ast
+
+#endif // KALEIDOSCOPE_AST_HASHCONS_H
@@ -0,0 +1,139 @@
+#ifndef KALEIDOSCOPE_AST_INLINER_H
+#define KALEIDOSCOPE_AST_INLINER_H
+
+#include "kaleidoscope/AST/ASTContext.h"
+#include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/Util/SourceLocation.h"
+#include "kaleidoscope/Util/Symbol.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace kaleidoscope::ast {
+
+/// Inliner - Copies top-level items into an ASTContext with calls to small
+/// user functions and operators replaced by their bodies. Each item is
+/// compiled into a module of its own, so LLVM never sees a caller and its
+/// callee together and cannot inline them itself.
+///
+/// A call f(x, y) to def f(a b) becomes var a.f = x, b.f = y in <body>. The
+/// arguments are evaluated once, in order, as they would be for the call.
+/// Every variable of an inlined body has the callee's name appended after a
+/// dot, which no identifier has, so the body cannot capture or shadow the
+/// caller's variables.
+///
+/// Functions are inlined bottom up. Each definition is expanded with the
+/// functions already known inlined into it, and is kept for its callers if
+/// the expansion has at most Threshold nodes and does not call the function
+/// itself. Anything recursive, directly or through a function it inlines,
+/// so stays a call, and inlining a kept body never has to expand it again.
+/// A function called before it is defined is not inlined into that caller.
+///
+/// A definition is only kept once commit is called for it, after the later
+/// stages have accepted it; one they reject is never inlined.
+class Inliner : private ASTVisitor<Inliner, AVDelType::ExprAST> {
+  using Self   = Inliner;
+  using Parent = ASTVisitor<Self, AVDelType::ExprAST>;
+  friend Parent;
+
+  /// Callee - A function small enough to inline, with its variables renamed.
+  struct Callee {
+    std::vector<Symbol> Params;
+    const ExprAST*      Body;
+  };
+
+  ASTContext& Ctx;
+
+  /// Bodies - Owns the bodies in Callees, which outlive the items they were
+  /// defined in.
+  ASTContext                     Bodies{};
+  llvm::DenseMap<Symbol, Callee> Callees{};
+
+  std::size_t Threshold;
+  std::size_t NumInlined = 0;
+
+  /// Out - The context being copied into: Ctx, or Bodies when a callee is
+  /// being kept.
+  ASTContext* Out = &Ctx;
+
+  /// Expand - Whether calls are being inlined, rather than a kept body being
+  /// copied as it is.
+  bool Expand = true;
+
+  /// Suffix - What is appended to variable names while a callee is being
+  /// kept; empty otherwise.
+  Symbol Suffix{};
+
+  /// Definition - The function being expanded, if any, and whether a call to
+  /// it was found.
+  Symbol Definition{};
+  bool   CallsDefinition = false;
+
+  /// Pending - The last item, if it is a definition commit would keep.
+  const FunctionAST* Pending = nullptr;
+
+ public:
+  /// DefaultThreshold - The most nodes an inlined body has by default.
+  static constexpr std::size_t DefaultThreshold = 32;
+
+  explicit Inliner(
+      ASTContext& Ctx, std::size_t Threshold = DefaultThreshold
+  ) noexcept
+      : Ctx(Ctx)
+      , Threshold(Threshold) {}
+
+  /// expand - Copies F into the context as an item of its own. If it
+  /// qualifies for inlining, commit keeps it for later items.
+  auto expand(const FunctionAST& F) -> const FunctionAST*;
+
+  /// expand - Copies E, a top-level expression, into the context as an item
+  /// of its own.
+  auto expand(const ExprAST& E) -> const ExprAST*;
+
+  /// commit - Keeps the definition expanded last for inlining into later
+  /// items, if it qualifies. Call it once the definition has been compiled,
+  /// and before the context is reset.
+  void commit();
+
+  /// getNumInlined - How many calls were inlined into the last item.
+  [[nodiscard]] auto getNumInlined() const noexcept -> std::size_t {
+    return NumInlined;
+  }
+
+  /// isInlinable - Whether calls to the function Name are inlined.
+  [[nodiscard]] auto isInlinable(Symbol Name) const -> bool {
+    return Callees.count(Name) != 0;
+  }
+
+ private:
+  /// keep - Copies the body of F, just expanded, into Bodies for inlining.
+  void keep(const FunctionAST& F);
+
+  /// call - Copies a call at Loc to Name with arguments Args, inlining it if
+  /// Name is kept; Copy makes the call itself when it is not.
+  template<typename CopyT>
+  auto call(
+      Symbol                         Name,
+      llvm::ArrayRef<const ExprAST*> Args,
+      SourceLocation                 Loc,
+      CopyT&&                        Copy
+  ) -> ASTHandle<ExprAST>;
+
+  auto rename(Symbol Name) const -> Symbol;
+
+  auto visitImpl(const BinaryExprAST& A) -> ASTHandle<ExprAST>;
+  auto visitImpl(const UnaryExprAST& A) -> ASTHandle<ExprAST>;
+  auto visitImpl(const CallExprAST& A) -> ASTHandle<ExprAST>;
+  auto visitImpl(const ForExprAST& A) -> ASTHandle<ExprAST>;
+  auto visitImpl(const IfExprAST& A) -> ASTHandle<ExprAST>;
+  auto visitImpl(const NumberExprAST& A) -> ASTHandle<ExprAST>;
+  auto visitImpl(const VariableExprAST& A) -> ASTHandle<ExprAST>;
+  auto visitImpl(const VarAssignExprAST& A) -> ASTHandle<ExprAST>;
+};
+
+} // namespace kaleidoscope::ast
+
+#endif // KALEIDOSCOPE_AST_INLINER_H
@@ -0,0 +1,37 @@
+#ifndef KALEIDOSCOPE_AST_SERIALIZE_ASTFORMAT_H
+#define KALEIDOSCOPE_AST_SERIALIZE_ASTFORMAT_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace kaleidoscope::ast::format {
+
+/// ----------------------------------------------------------------------------
+/// Binary AST format
+///
+/// A file holds a sequence of top-level items and refers to nothing outside
+/// itself, so it can be read back at any address and in any process:
+///
+///   file   ::= Magic Version:u32le strings items
+///   strings::= count:uleb (size:uleb byte*)*
+///   items  ::= count:uleb item*
+///   item   ::= count:uleb record+
+///   record ::= kind:u8 field*
+///
+/// Names are indices into the string table. Each item is a list of records in
+/// post-order, the last being the item itself, and a record refers to a child
+/// by how many records back the child is, so a subtree shared by several
+/// parents is written once. Records are tagged with their ASTNodeKind and
+/// carry the node's fields in the order its constructor takes them; a number
+/// is written as uleb 2N for a small whole number N, or as uleb 1 followed by
+/// the double as u64le. Locations are not kept.
+/// ----------------------------------------------------------------------------
+
+inline constexpr std::string_view Magic = "KAST";
+
+/// Version - Bumped whenever the layout or the ASTNodeKind values change.
+inline constexpr std::uint32_t Version = 1;
+
+} // namespace kaleidoscope::ast::format
+
+#endif // KALEIDOSCOPE_AST_SERIALIZE_ASTFORMAT_H
@@ -0,0 +1,105 @@
+#ifndef KALEIDOSCOPE_AST_SERIALIZE_ASTREADER_H
+#define KALEIDOSCOPE_AST_SERIALIZE_ASTREADER_H
+
+#include "kaleidoscope/AST/ASTContext.h"
+#include "kaleidoscope/Util/Symbol.h"
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kaleidoscope::ast {
+
+/// ASTReader - Loads the items an ASTWriter wrote back into an ASTContext,
+/// ready for CodeGen, without lexing or parsing anything. The input is
+/// checked as it is read, so a damaged file is reported rather than trusted.
+/// Loaded nodes have no locations.
+class ASTReader {
+  /// Slot - The node a record of the current item was read into.
+  struct Slot {
+    ASTHandle<ExprAST>      Expr{};
+    ASTHandle<PrototypeAST> Proto{};
+    ASTHandle<FunctionAST>  Fn{};
+  };
+
+  ASTContext&         Ctx;
+  const std::uint8_t* Cur;
+  const std::uint8_t* End;
+  std::vector<Symbol> Strings{};
+  std::vector<Slot>   Slots{};
+  std::string         Err{};
+
+  ASTReader(ASTContext& Ctx, llvm::StringRef Data) noexcept
+      : Ctx(Ctx)
+      , Cur(Data.bytes_begin())
+      , End(Data.bytes_end()) {}
+
+ public:
+  /// read - Reads the items in Buf into Ctx, in the order they were added.
+  /// On failure the nodes read so far are left in Ctx.
+  static auto read(llvm::MemoryBufferRef Buf, ASTContext& Ctx)
+      -> llvm::Expected<std::vector<const ASTNode*>>;
+
+  /// load - Maps the file at Path read-only and reads it like read. The file
+  /// is only needed while it is read.
+  static auto load(const llvm::Twine& Path, ASTContext& Ctx)
+      -> llvm::Expected<std::vector<const ASTNode*>>;
+
+ private:
+  /// error - Records the first problem found and stops reading.
+  auto error(const char* Msg) -> std::nullptr_t;
+
+  [[nodiscard]] auto failed() const noexcept -> bool { return !Err.empty(); }
+
+  [[nodiscard]] auto remaining() const noexcept -> std::size_t {
+    return static_cast<std::size_t>(End - Cur);
+  }
+
+  auto readItems() -> std::vector<const ASTNode*>;
+  auto readItem() -> const ASTNode*;
+  void readRecord(std::uint32_t Idx);
+
+  /// readByte/readULEB - Read a byte and a uleb128, with the common cases
+  /// inline.
+  auto readByte() -> char {
+    if (Cur == End) return readPastEnd();
+    return static_cast<char>(*Cur++);
+  }
+  auto readULEB() -> std::uint64_t {
+    if (Cur != End && *Cur < 0x80) return *Cur++;
+    return readLongULEB();
+  }
+  auto readPastEnd() -> char;
+  auto readLongULEB() -> std::uint64_t;
+
+  /// readCount - Reads how many elements follow.
+  auto readCount() -> std::uint32_t;
+
+  auto readNumber() -> double;
+
+  auto readString() -> Symbol {
+    std::uint64_t ID = readULEB();
+    if (ID < Strings.size()) return Strings[ID];
+    error("string index out of range");
+    return {};
+  }
+
+  /// readExpr - Reads a reference from record Idx to an expression.
+  auto readExpr(std::uint32_t Idx) -> ASTHandle<ExprAST> {
+    std::uint64_t Back = readULEB();
+    if (Back == 0 || Back > Idx) return error("reference out of range");
+    ASTHandle<ExprAST> E = Slots[Idx - Back].Expr;
+    if (!E) return error("expected a reference to an expression");
+    return E;
+  }
+};
+
+} // namespace kaleidoscope::ast
+
+#endif // KALEIDOSCOPE_AST_SERIALIZE_ASTREADER_H
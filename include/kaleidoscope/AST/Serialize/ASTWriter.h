@@ -0,0 +1,102 @@
+#ifndef KALEIDOSCOPE_AST_SERIALIZE_ASTWRITER_H
+#define KALEIDOSCOPE_AST_SERIALIZE_ASTWRITER_H
+
+#include "kaleidoscope/AST/ASTTraversal.h"
+#include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/Util/Symbol.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kaleidoscope::ast {
+
+/// ASTWriter - Collects top-level items and writes them out in the binary
+/// format described in ASTFormat.h, for ASTReader to load again. Items are
+/// walked with ASTTraversal, so trees of any depth can be written.
+class ASTWriter
+    : private ASTVisitor<ASTWriter, AVDelType::All>
+    , private ASTTraversal<ASTWriter> {
+  using Self      = ASTWriter;
+  using Parent    = ASTVisitor<Self, AVDelType::All>;
+  using Traversal = ASTTraversal<Self>;
+  friend Parent;
+  friend Traversal;
+
+  /// Items - The items added so far, each with its record count.
+  llvm::SmallVector<char, 0> Items{};
+  std::size_t                NumItems = 0;
+
+  /// Records - The records of the item being added.
+  llvm::SmallVector<char, 0> Records{};
+  std::uint32_t              NumRecords = 0;
+
+  /// Indices - The record written for each expression of the item being
+  /// added, so that a shared subtree is only written once.
+  llvm::DenseMap<const ExprAST*, std::uint32_t> Indices{};
+
+  /// Finished - The records of the nodes written whose parent has not been
+  /// yet. The children of the node being written are the last of them.
+  llvm::SmallVector<std::uint32_t, 32> Finished{};
+
+  /// Children - The records of the children of the node being written.
+  llvm::ArrayRef<std::uint32_t> Children{};
+
+  std::vector<Symbol>                   Strings{};
+  llvm::DenseMap<Symbol, std::uint32_t> StringIDs{};
+
+ public:
+  /// add - Appends Item, a function definition, extern or top-level
+  /// expression.
+  void add(const ASTNode& Item);
+
+  /// write - Writes every item added so far to OS.
+  void write(llvm::raw_ostream& OS) const;
+
+ private:
+  /// preVisit - Skips the subtrees of the item that are already written.
+  auto preVisit(const ASTNode& A) -> bool;
+
+  /// postVisit - Writes the record of A once its children's are written.
+  void postVisit(const ASTNode& A);
+
+  /// beginRecord - Starts the record of a node of kind K, returning its
+  /// index.
+  auto beginRecord(ASTNode::ASTNodeKind K) -> std::uint32_t;
+
+  void writeByte(char C) { Records.push_back(C); }
+  void writeULEB(std::uint64_t V);
+  void writeNumber(double V);
+  void writeString(Symbol S);
+
+  /// writeRef - Writes the reference from record Idx to record Child.
+  void writeRef(std::uint32_t Idx, std::uint32_t Child) {
+    writeULEB(Idx - Child);
+  }
+
+  auto visitImpl(const BinaryExprAST& A) -> std::uint32_t;
+  auto visitImpl(const UnaryExprAST& A) -> std::uint32_t;
+  auto visitImpl(const CallExprAST& A) -> std::uint32_t;
+  auto visitImpl(const ForExprAST& A) -> std::uint32_t;
+  auto visitImpl(const IfExprAST& A) -> std::uint32_t;
+  auto visitImpl(const NumberExprAST& A) -> std::uint32_t;
+  auto visitImpl(const VariableExprAST& A) -> std::uint32_t;
+  auto visitImpl(const VarAssignExprAST& A) -> std::uint32_t;
+
+  auto visitImpl(const FunctionAST& A) -> std::uint32_t;
+
+  auto visitImpl(const PrototypeAST& A) -> std::uint32_t;
+  auto visitImpl(const ProtoBinaryAST& A) -> std::uint32_t;
+  auto visitImpl(const ProtoUnaryAST& A) -> std::uint32_t;
+
+  auto visitImpl(const EndOfFileAST& A) -> std::uint32_t;
+};
+
+} // namespace kaleidoscope::ast
+
+#endif // KALEIDOSCOPE_AST_SERIALIZE_ASTWRITER_H
@@ -2,20 +2,26 @@
 #define KALEIDOSCOPE_CODEGEN_CODEGEN_H
 
 #include "kaleidoscope/AST/AST.h"
+#include "kaleidoscope/AST/ASTContext.h"
 #include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/Sema/SlotTable.h"
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Value.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 namespace kaleidoscope {
 
+/// CodeGen - Emits IR for top-level items. The variables in an item must
+/// have been resolved by a Resolver first, into the table given to setSlots.
 class CodeGen : public ASTVisitor<CodeGen, AVDelType::ExprAST> {
   using Parent = ASTVisitor<CodeGen, AVDelType::ExprAST>;
   friend Parent;
@@ -30,11 +36,22 @@ class CodeGen : public ASTVisitor<CodeGen, AVDelType::ExprAST> {
   };
 
  private:
-  std::unordered_map<std::string, llvm::AllocaInst*> NamedValues{};
-  std::unique_ptr<Session>                           CGS{};
-  std::unordered_map<std::string, std::unique_ptr<PrototypeAST>>
-                                  FunctionProtos{};
-  std::unordered_set<std::string> CompiledFunctions{};
+  std::unique_ptr<Session>                    CGS{};
+  llvm::DenseMap<Symbol, const PrototypeAST*> FunctionProtos{};
+  llvm::DenseSet<Symbol>                      CompiledFunctions{};
+
+  /// Slots - The allocas of the variables in scope, indexed by the slots the
+  /// Resolver gave their references.
+  std::vector<llvm::AllocaInst*> Slots{};
+
+  /// Resolved - The slots of the variable references in the current item,
+  /// and the index in it of the next reference to be emitted.
+  const SlotTable* Resolved = nullptr;
+  std::size_t      NextRef  = 0;
+
+  /// ProtoCtx - Owns the copies of the prototypes in FunctionProtos, which
+  /// outlive the per-item contexts their originals were parsed into.
+  ASTContext ProtoCtx{};
 
   auto genAssignment(const BinaryExprAST& A) -> llvm::Value*;
 
@@ -51,7 +68,15 @@ class CodeGen : public ASTVisitor<CodeGen, AVDelType::ExprAST> {
 
   auto visitImpl(const PrototypeAST& A) const -> llvm::Function*;
 
-  auto getFunction(llvm::StringRef Name) const -> llvm::Function*;
+  auto getFunction(Symbol Name) const -> llvm::Function*;
+
+  /// getSlot - The alloca of the variable A, the next reference of the item,
+  /// refers to, or null if A was not resolved.
+  auto getSlot(const VariableExprAST& A) -> llvm::AllocaInst* {
+    std::uint32_t Slot =
+        Resolved ? Resolved->lookup(NextRef++, A) : SlotTable::NoSlot;
+    return Slot < Slots.size() ? Slots[Slot] : nullptr;
+  }
 
   auto createEntryBlockAlloca(
       llvm::Function* TheFunction, const llvm::Twine& VarName
@@ -64,11 +89,14 @@ class CodeGen : public ASTVisitor<CodeGen, AVDelType::ExprAST> {
     return std::exchange(CGS, std::make_unique<Session>());
   }
 
-  auto addPrototype(std::unique_ptr<PrototypeAST> P) -> const PrototypeAST& {
-    return *(FunctionProtos[P->getName()] = std::move(P));
+  auto addPrototype(const PrototypeAST& P) -> const PrototypeAST& {
+    return *(FunctionProtos[P.getName()] = ProtoCtx.clone(P));
   }
 
   auto handleAnonExpr(const ExprAST& A) -> llvm::Function*;
+
+  /// setSlots - The slots of the items generated next, or null.
+  void setSlots(const SlotTable* T) noexcept { Resolved = T; }
 };
 
 } // namespace kaleidoscope
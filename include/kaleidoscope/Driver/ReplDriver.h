@@ -2,14 +2,20 @@
 #define KALEIDOSCOPE_DRIVER_REPLDRIVER_H
 
 #include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/AST/ConstantFold.h"
+#include "kaleidoscope/AST/Inliner.h"
 #include "kaleidoscope/CodeGen/CodeGen.h"
 #include "kaleidoscope/JIT/KaleidoscopeJIT.h"
 #include "kaleidoscope/Lexer/Lexer.h"
 #include "kaleidoscope/Parser/Parser.h"
+#include "kaleidoscope/Sema/Resolver.h"
+#include "kaleidoscope/Util/Error/Diagnostic.h"
 
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Support/Error.h>
 
+#include <vector>
+
 namespace kaleidoscope {
 
 class ReplDriver : protected ASTVisitor<ReplDriver, AVDelType::None> {
@@ -24,6 +30,14 @@ class ReplDriver : protected ASTVisitor<ReplDriver, AVDelType::None> {
 
   Lexer                                  Lex;
   Parser                                 Parse;
+  ASTContext                             ItemCtx;
+  std::vector<Diagnostic>                ParseDiags;
+  ASTContext                             InlineCtx;
+  ast::Inliner                           Inline;
+  ASTContext                             FoldCtx;
+  ast::ConstantFold                      Fold;
+  Resolver                               Resolve;
+  SlotTable                              Slots;
   CodeGen                                CG;
   const std::unique_ptr<KaleidoscopeJIT> JIT;
 
@@ -33,6 +47,17 @@ class ReplDriver : protected ASTVisitor<ReplDriver, AVDelType::None> {
 
   auto resetSession() -> std::unique_ptr<CodeGen::Session>;
 
+  /// simplify - Inlines small functions into A and folds its constants,
+  /// reporting what that did.
+  template<typename T>
+  auto simplify(const T& A) -> const T&;
+
+  /// prepare - Resolves A as it was written, so that every unknown variable
+  /// is reported even in code simplify removes, then simplifies it and
+  /// resolves the result into Slots for CodeGen. Null if A does not resolve.
+  template<typename T>
+  auto prepare(const T& A) -> const T*;
+
   auto visitImpl(const ExprAST& A) -> VisitRet;
   auto visitImpl(const FunctionAST& A) -> VisitRet;
   auto visitImpl(const PrototypeAST& A) -> VisitRet;
@@ -42,7 +67,9 @@ class ReplDriver : protected ASTVisitor<ReplDriver, AVDelType::None> {
   }
 
  public:
-  explicit ReplDriver();
+  explicit ReplDriver(
+      std::unique_ptr<SourceBuffer> Source = SourceBuffer::getSTDIN()
+  );
   /// top ::= definition | external | expression
   void mainLoop();
 };
@@ -0,0 +1,38 @@
+#ifndef KALEIDOSCOPE_LEXER_CHARSCAN_H
+#define KALEIDOSCOPE_LEXER_CHARSCAN_H
+
+namespace kaleidoscope {
+
+/// ScanISA - Instruction sets the character scanners are implemented for.
+enum class ScanISA { Scalar, SSE2, AVX2 };
+
+/// CharScanner - Routines which find the end of a run of one character class
+/// in [Begin, End). Each returns a pointer to the first character not in the
+/// class, or End. The vector versions test 16 or 32 characters at a time and
+/// agree exactly with the scalar ones.
+struct CharScanner {
+  using ScanFn = auto (*)(const char* Begin, const char* End) -> const char*;
+
+  /// SkipSpace - Whitespace as classified by std::isspace in the C locale.
+  ScanFn SkipSpace;
+
+  /// FindEndOfLine - Skips everything up to the next '\n' or '\r'.
+  ScanFn FindEndOfLine;
+
+  /// SkipIdentifier - Identifier characters: [_a-zA-Z0-9].
+  ScanFn SkipIdentifier;
+
+  /// get - The scanners for ISA. ISA must be supported by the running CPU.
+  static auto get(ScanISA ISA) -> const CharScanner&;
+
+  /// getBest - The scanners for the widest instruction set the running CPU
+  /// supports, detected once at first use.
+  static auto getBest() -> const CharScanner&;
+
+  /// isSupported - Whether the running CPU supports ISA.
+  static auto isSupported(ScanISA ISA) -> bool;
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_LEXER_CHARSCAN_H
@@ -1,13 +1,39 @@
 #ifndef KALEIDOSCOPE_LEXER_LEXER_H
 #define KALEIDOSCOPE_LEXER_LEXER_H
 
+#include "kaleidoscope/Lexer/CharScan.h"
+#include "kaleidoscope/Lexer/SourceBuffer.h"
+#include "kaleidoscope/Lexer/TokenStream.h"
+#include "kaleidoscope/Util/Error/Diagnostic.h"
+#include "kaleidoscope/Util/SourceLocation.h"
+#include "kaleidoscope/Util/Symbol.h"
+
+#include <llvm/Support/Allocator.h>
+
 #include <cstdio>
 #include <functional>
-#include <string>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace kaleidoscope {
 
-class Lexer {
+/// LexedToken - A token together with its payload and location, so it can be
+/// buffered without consulting the Lexer again.
+struct LexedToken {
+  /// Kind - A Lexer::Token or the character itself, as returned by gettok.
+  int            Kind = EOF;
+  SourceLocation Loc{};
+
+  /// Identifier - The interned name of a tok_identifier.
+  Symbol Identifier{};
+
+  /// NumVal - The value of a tok_number.
+  double NumVal = 0;
+};
+
+class Lexer : public DiagnosticSink {
  public:
   /// The lexer returns tokens [0-255] if it is an unknown character, otherwise
   /// one of these for known things.
@@ -41,34 +67,155 @@ class Lexer {
   };
 
  private:
-  std::function<int()> GetChar;
-  std::string          IdentifierStr;
-  double               NumVal;
+  /// Source - Shared with the SourceManager, which keeps the text alive for as
+  /// long as locations into it may be decoded.
+  std::shared_ptr<SourceBuffer> Source;
+  std::string_view              IdentifierStr;
+  Symbol                        Identifier;
+  double                        NumVal;
+
+  /// BufferID - Source's entry in the SourceManager, or NoBufferID if the
+  /// caller registered the text and preset ChunkLoc.
+  static constexpr unsigned NoBufferID = ~0U;
+  unsigned                  BufferID;
+
+  /// TokLoc - The location of the first character of the last token.
+  SourceLocation TokLoc{};
+
+  /// LastError - What was wrong with the last tok_err.
+  Diagnostic LastError{};
+
+  /// Scan - Vectorised character class scanners for the running CPU.
+  const CharScanner& Scan = CharScanner::getBest();
+
+  /// SpillAlloc - Holds copies of the few tokens which span two source chunks
+  /// so every view handed out by the lexer is stable.
+  llvm::BumpPtrAllocator SpillAlloc{};
+
+  /// Unregistered - The owners of chunks the SourceManager could not take,
+  /// once its locations ran out, which views may still point into.
+  std::vector<std::shared_ptr<const void>> Unregistered{};
+
+  /// BufCur/BufEnd - The unread remainder of the current source chunk.
+  const char* BufCur = nullptr;
+  const char* BufEnd = nullptr;
+
+  /// ChunkBegin/ChunkLoc - The start of the current chunk and its location.
+  const char*    ChunkBegin = nullptr;
+  SourceLocation ChunkLoc{};
+
+  /// refill - Moves on to the next source chunk. Returns false at end of input.
+  auto refill() -> bool;
+
+  /// getCurrentLoc - The location of BufCur.
+  [[nodiscard]] auto getCurrentLoc() const noexcept -> SourceLocation {
+    return ChunkLoc.getLocWithOffset(
+        static_cast<std::uint32_t>(BufCur - ChunkBegin)
+    );
+  }
+
+  /// peekChar - Returns the next character without consuming it, or EOF.
+  auto peekChar() -> int {
+    if (BufCur == BufEnd && !refill()) return EOF;
+    return static_cast<unsigned char>(*BufCur);
+  }
 
-  int LastChar = ' ';
+  /// consumeWhile - Consumes the run of characters ScanRun(BufCur, BufEnd)
+  /// skips and returns a view of it. The view points straight into the source
+  /// chunk unless the run spans chunks, in which case it is stitched into
+  /// SpillAlloc.
+  template<typename ScanFn>
+  auto consumeWhile(ScanFn ScanRun) -> std::string_view;
 
   // Identifiers: [_a-zA-Z][_a-zA-Z0-9]*
   auto handleIdentifier() -> int;
 
   // Number: [0-9.]+
+  // Malformed literals such as "1.2.3" are lexed as tok_err, with the error
+  // left in LastError.
   auto handleNumber() -> int;
 
-  // Comment
-  auto handleComment() -> int;
+  // Comment: '#' until end of line
+  void skipComment();
+
+  /// lexToken - Lexes the next token like gettok, without reporting errors.
+  auto lexToken() -> int;
+
+  /// Lexes Piece, a slice of text already registered with the SourceManager
+  /// which starts at PieceLoc.
+  Lexer(std::string_view Piece, SourceLocation PieceLoc);
 
  public:
-  Lexer(std::function<int()> GetChar = std::getchar) noexcept
-      : GetChar(std::move(GetChar)) {}
+  /// Lexes standard input.
+  Lexer() : Lexer(SourceBuffer::getSTDIN()) {}
 
-  [[nodiscard]] auto getIdentifierStr() const noexcept -> const std::string& {
+  explicit Lexer(std::unique_ptr<SourceBuffer> Source);
+
+  /// Compatibility path pulling one character at a time from GetChar.
+  Lexer(std::function<int()> GetChar)
+      : Lexer(SourceBuffer::getCallback(std::move(GetChar))) {}
+
+  /// getIdentifierStr - The text of the last identifier or keyword. The view
+  /// is backed by the source buffer and stays valid for the Lexer's lifetime,
+  /// so it only needs copying if the consumer must own the string.
+  [[nodiscard]] auto getIdentifierStr() const noexcept -> std::string_view {
     return IdentifierStr;
   }
 
+  /// getIdentifier - The interned name of the last tok_identifier token.
+  [[nodiscard]] auto getIdentifier() const noexcept -> Symbol {
+    return Identifier;
+  }
+
   [[nodiscard]] auto getNumVal() const noexcept -> double { return NumVal; }
 
-  /// gettok - Return the next token from standard input.
+  /// getTokLoc - The location of the first character of the last token
+  /// returned by gettok. At end of input this is one past the last character.
+  [[nodiscard]] auto getTokLoc() const noexcept -> SourceLocation {
+    return TokLoc;
+  }
+
+  /// classifyIdentifier - Returns the keyword token for S, or tok_identifier.
+  /// Keywords are found with a single probe of a compile time perfect hash.
+  static auto classifyIdentifier(std::string_view S) noexcept -> Token;
+
+  /// gettok - Return the next token from the source buffer. The error of a
+  /// tok_err is reported as it is lexed.
   auto gettok() -> int;
+
+  /// lex - Returns the next token with its payload.
+  auto lex() -> LexedToken {
+    LexedToken Tok{gettok(), TokLoc};
+    if (Tok.Kind == tok_identifier) Tok.Identifier = Identifier;
+    else if (Tok.Kind == tok_number) Tok.NumVal = NumVal;
+    return Tok;
+  }
+
+  /// lex - Lexes tokens into Out until it is full or tok_eof has been stored.
+  /// Returns the number of tokens stored.
+  auto lex(std::span<LexedToken> Out) -> std::size_t;
+
+  /// tokenize - Lexes the rest of the input, up to and including tok_eof, in
+  /// one go. Meant for batch compilation; it reads until end of input, so the
+  /// REPL keeps using gettok. Errors are kept in the stream, not reported.
+  auto tokenize() -> TokenStream;
+
+  /// tokenizeParallel - Tokenizes all of Source like tokenize, but splits the
+  /// text at line breaks and lexes the pieces concurrently on up to
+  /// NumThreads threads, 0 meaning one per core. A line break is always a
+  /// token boundary, and never inside a comment, so the result is identical
+  /// to tokenize's.
+  static auto tokenizeParallel(
+      std::unique_ptr<SourceBuffer> Source, unsigned NumThreads = 0
+  ) -> TokenStream;
 };
+
+inline auto TokenStream::getToken(std::size_t I) const noexcept -> LexedToken {
+  LexedToken Tok{getKind(I), getLoc(I)};
+  if (Tok.Kind == Lexer::tok_identifier) Tok.Identifier = getIdentifier(I);
+  else if (Tok.Kind == Lexer::tok_number) Tok.NumVal = getNumVal(I);
+  return Tok;
+}
 } // namespace kaleidoscope
 
 #endif // KALEIDOSCOPE_LEXER_LEXER_H
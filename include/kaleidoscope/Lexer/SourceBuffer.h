@@ -0,0 +1,65 @@
+#ifndef KALEIDOSCOPE_LEXER_SOURCEBUFFER_H
+#define KALEIDOSCOPE_LEXER_SOURCEBUFFER_H
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/ErrorOr.h>
+
+#include <functional>
+#include <memory>
+#include <string_view>
+
+namespace kaleidoscope {
+
+/// SourceChunk - A contiguous piece of program text.
+struct SourceChunk {
+  std::string_view Text{};
+
+  /// Owner - Keeps Text alive, for sources which read their input piece by
+  /// piece, so a chunk can be freed once nothing refers to it. Null if the
+  /// SourceBuffer itself owns Text.
+  std::shared_ptr<const void> Owner{};
+};
+
+/// SourceBuffer - A source of program text for the Lexer. Text is handed out
+/// in contiguous chunks which the lexer scans with raw pointers. Every chunk
+/// stays valid and unchanged for the lifetime of the SourceBuffer, or of its
+/// Owner if it has one.
+class SourceBuffer {
+ public:
+  SourceBuffer()                                       = default;
+  SourceBuffer(const SourceBuffer&)                    = delete;
+  auto operator=(const SourceBuffer&) -> SourceBuffer& = delete;
+  virtual ~SourceBuffer()                              = default;
+
+  /// getNextChunk - Returns the next non-empty chunk of text, or an empty one
+  /// once the input is exhausted.
+  virtual auto getNextChunk() -> SourceChunk = 0;
+
+  /// getName - A name for the input used in diagnostics, such as its path.
+  [[nodiscard]] virtual auto getName() const -> std::string_view = 0;
+
+  /// getFile - Memory maps (or reads, for small files) the file at Path.
+  static auto getFile(llvm::StringRef Path)
+      -> llvm::ErrorOr<std::unique_ptr<SourceBuffer>>;
+
+  /// getMemBuffer - Wraps Text without copying. Text must outlive the buffer.
+  static auto getMemBuffer(std::string_view Text)
+      -> std::unique_ptr<SourceBuffer>;
+
+  /// getMemBufferCopy - Copies Text into a buffer owned by the SourceBuffer.
+  static auto getMemBufferCopy(std::string_view Text)
+      -> std::unique_ptr<SourceBuffer>;
+
+  /// getSTDIN - Reads standard input in chunks of whatever has arrived, so the
+  /// REPL sees each line as soon as it is entered or written to a pipe.
+  static auto getSTDIN() -> std::unique_ptr<SourceBuffer>;
+
+  /// getCallback - Compatibility path which pulls one character at a time
+  /// from GetChar until it returns EOF.
+  static auto getCallback(std::function<int()> GetChar)
+      -> std::unique_ptr<SourceBuffer>;
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_LEXER_SOURCEBUFFER_H
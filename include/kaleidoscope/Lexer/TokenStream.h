@@ -0,0 +1,87 @@
+#ifndef KALEIDOSCOPE_LEXER_TOKENSTREAM_H
+#define KALEIDOSCOPE_LEXER_TOKENSTREAM_H
+
+#include "kaleidoscope/Util/Error/Diagnostic.h"
+#include "kaleidoscope/Util/SourceLocation.h"
+#include "kaleidoscope/Util/Symbol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kaleidoscope {
+
+struct LexedToken;
+
+/// TokenStream - A whole input lexed up front by Lexer::tokenize, stored as a
+/// structure of arrays so a consumer walking the kinds touches nothing else.
+/// Identifier and number payloads live in their own arrays, referenced by
+/// index. The last token is always tok_eof.
+///
+/// The errors of malformed tokens are kept with them rather than reported, for
+/// the parser to report when it reaches them, in order with its own.
+class TokenStream {
+  friend class Lexer;
+
+  /// Kinds - The token kinds; Lexer tokens and characters all fit 16 bits.
+  std::vector<std::int16_t> Kinds{};
+
+  /// Locs - The location of the first character of each token.
+  std::vector<SourceLocation> Locs{};
+
+  /// Payloads - For identifiers an index into Identifiers, for numbers an
+  /// index into Numbers, for tok_err an index into Errors, otherwise 0.
+  std::vector<std::uint32_t> Payloads{};
+
+  std::vector<Symbol>     Identifiers{};
+  std::vector<double>     Numbers{};
+  std::vector<Diagnostic> Errors{};
+
+  void reserve(std::size_t N) {
+    Kinds.reserve(N);
+    Locs.reserve(N);
+    Payloads.reserve(N);
+  }
+
+  void push(int Kind, SourceLocation Loc, std::uint32_t Payload = 0) {
+    Kinds.push_back(static_cast<std::int16_t>(Kind));
+    Locs.push_back(Loc);
+    Payloads.push_back(Payload);
+  }
+
+ public:
+  [[nodiscard]] auto size() const noexcept -> std::size_t {
+    return Kinds.size();
+  }
+
+  [[nodiscard]] auto getKind(std::size_t I) const noexcept -> int {
+    return Kinds[I];
+  }
+
+  [[nodiscard]] auto getLoc(std::size_t I) const noexcept -> SourceLocation {
+    return Locs[I];
+  }
+
+  /// getIdentifier - The name of token I, which must be a tok_identifier.
+  [[nodiscard]] auto getIdentifier(std::size_t I) const noexcept -> Symbol {
+    return Identifiers[Payloads[I]];
+  }
+
+  /// getNumVal - The value of token I, which must be a tok_number.
+  [[nodiscard]] auto getNumVal(std::size_t I) const noexcept -> double {
+    return Numbers[Payloads[I]];
+  }
+
+  /// getError - What is wrong with token I, which must be a tok_err.
+  [[nodiscard]] auto getError(std::size_t I) const noexcept
+      -> const Diagnostic& {
+    return Errors[Payloads[I]];
+  }
+
+  /// getToken - Token I gathered back into a LexedToken. Defined in Lexer.h.
+  [[nodiscard]] auto getToken(std::size_t I) const noexcept -> LexedToken;
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_LEXER_TOKENSTREAM_H
@@ -0,0 +1,86 @@
+#ifndef KALEIDOSCOPE_PARSER_INCREMENTALPARSER_H
+#define KALEIDOSCOPE_PARSER_INCREMENTALPARSER_H
+
+#include "kaleidoscope/AST/ASTContext.h"
+#include "kaleidoscope/Lexer/TokenStream.h"
+#include "kaleidoscope/Parser/Parser.h"
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace kaleidoscope {
+
+/// IncrementalParser - Parses successive versions of one input, such as a file
+/// being edited, reusing the AST of every item that has not changed.
+///
+/// The input is cut into runs of tokens ending at each ';', which in well
+/// formed code is one item each. A run is keyed on its tokens, their positions
+/// relative to its first one, and the operators in effect before it, and found
+/// by a hash of that key. A run whose key was seen in the previous version is
+/// not parsed again: its items come back as the very same nodes, so later
+/// stages can key caches of their own on them. Reused nodes keep the locations
+/// of the version they were parsed from, and ParsedModule::getLoc moves those
+/// into the current one.
+///
+/// The parser never reads the text of an earlier version again, but the
+/// SourceManager keeps each version's text for as long as its locations may
+/// be decoded. Once a version is parsed, the caller releases the previous
+/// one with SourceManager::releaseBuffer, or every version stays in memory.
+class IncrementalParser {
+  /// Run - What parsing one run without errors produced. Most runs hold one
+  /// item and leave the operators alone, so both are kept compact.
+  struct Run {
+    llvm::SmallVector<const ASTNode*, 1> Items{};
+
+    /// EndOps - The operators in effect after the run, or null if the run
+    /// did not change them.
+    std::unique_ptr<Parser::OperatorTable> EndOps{};
+
+    std::shared_ptr<ASTContext> Ctx{};
+
+    /// Loc - The location of the run's first token in the version it was
+    /// parsed from.
+    SourceLocation Loc{};
+
+    /// LastVersion - The last version the run was part of.
+    unsigned LastVersion = 0;
+
+    /// Key - The bytes the run was keyed on, to tell it from another run
+    /// whose key has the same hash.
+    std::string Key{};
+  };
+
+  /// Runs - The runs of the last version parsed, by the hash of their key.
+  llvm::DenseMap<std::uint64_t, Run> Runs{};
+
+  /// Version - The number of versions parsed so far.
+  unsigned Version = 0;
+
+  std::size_t NumReused = 0, NumParsed = 0;
+
+ public:
+  /// parse - Parses Tokens, the next version of the input, like
+  /// Parser::parseParallel would, but only the runs that changed since the
+  /// previous call. A run is forgotten once a version goes without it. The
+  /// previous version's text may be released as soon as this returns.
+  auto parse(const TokenStream& Tokens) -> ParsedModule;
+
+  /// getNumReused/getNumParsed - How many runs the last call to parse reused
+  /// and parsed.
+  [[nodiscard]] auto getNumReused() const noexcept -> std::size_t {
+    return NumReused;
+  }
+  [[nodiscard]] auto getNumParsed() const noexcept -> std::size_t {
+    return NumParsed;
+  }
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_PARSER_INCREMENTALPARSER_H
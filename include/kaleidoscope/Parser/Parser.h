@@ -2,46 +2,142 @@
 #define KALEIDOSCOPE_PARSER_PARSER_H
 
 #include "kaleidoscope/AST/AST.h"
+#include "kaleidoscope/AST/ASTContext.h"
 #include "kaleidoscope/Lexer/Lexer.h"
+#include "kaleidoscope/Util/Error/Diagnostic.h"
 
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 namespace kaleidoscope {
 
-class Parser {
-  Lexer& Lex;
+/// ParsedModule - The top-level items of a whole input, as parsed by
+/// Parser::parseParallel, along with the contexts that own their nodes.
+struct ParsedModule {
+  /// Items - Every item before tok_eof, in source order. Items that failed to
+  /// parse are null.
+  std::vector<const ASTNode*> Items{};
+
+  /// Diags - The errors found, in source order.
+  std::vector<Diagnostic> Diags{};
+
+  /// Contexts - The contexts owning the items' nodes, which may be shared
+  /// with other modules.
+  std::vector<std::shared_ptr<ASTContext>> Contexts{};
+
+  /// LocOffsets - What to add to the locations in each item's nodes to place
+  /// them in this input. Only the IncrementalParser fills it in, as an item
+  /// it reuses keeps the locations of the version it was parsed from.
+  std::vector<std::uint32_t> LocOffsets{};
+
+  /// getLoc - Loc, taken from a node of item I, as a location in this input.
+  [[nodiscard]] auto getLoc(std::size_t I, SourceLocation Loc) const noexcept
+      -> SourceLocation {
+    return I < LocOffsets.size() ? Loc.getLocWithOffset(LocOffsets[I]) : Loc;
+  }
+};
+
+class Parser : public DiagnosticSink {
+  friend class IncrementalParser;
+
+  /// Lex/Tokens - Where tokens come from: lexed on demand from Lex, or read by
+  /// index from a stream tokenized up front. Exactly one is set.
+  Lexer* const             Lex    = nullptr;
+  const TokenStream* const Tokens = nullptr;
+
+  /// NextTok - The index in Tokens of the token after Cur.
+  std::size_t NextTok = 0;
+
+  /// Cur/getNextToken - Provide a simple token buffer.
+  /// Cur is the current token the parser is looking at, with its payload.
+  LexedToken Cur{};
+
+  /// LookaheadSize - Capacity of the lookahead ring buffer. A power of two.
+  static constexpr std::size_t LookaheadSize = 16;
+
+  /// Ahead/AheadBegin/AheadCount - Ring buffer of the tokens already lexed
+  /// after Cur, oldest first.
+  std::array<LexedToken, LookaheadSize> Ahead{};
+  std::size_t                           AheadBegin = 0, AheadCount = 0;
+
+  /// LexAhead - Whether to refill the whole ring buffer at once whenever it
+  /// runs dry, rather than lexing each token as it is needed.
+  const bool LexAhead;
+
+  /// fillAhead - Lexes tokens into the ring buffer until it holds at least N.
+  void fillAhead(std::size_t N);
+
+  /// Ctx - The context nodes of the item being parsed are allocated in.
+  ASTContext* Ctx = nullptr;
+
+  /// OwnCtx - The context parse() without arguments allocates in.
+  ASTContext OwnCtx{};
+
+  /// HoldCur - Whether Cur already starts the next item, having been found by
+  /// synchronize, so parseTopLevel must not move past it.
+  bool HoldCur = false;
+
+  /// IterativeExprs - Whether to parse operator expressions with an explicit
+  /// stack rather than by recursive descent. See parseExpressionIterative.
+  bool IterativeExprs = false;
 
-  /// CurTok/getNextToken - Provide a simple token buffer.
-  /// CurTok is the current token the parser is looking at.
-  int CurTok;
+  /// OperatorInfo - What an ASCII character means as an operator.
+  struct OperatorInfo {
+    /// BinaryPrec - The precedence as a binary operator, or -1 if it is not
+    /// one.
+    std::int8_t BinaryPrec = -1;
 
-  /// UserBinOpPrec - This holds the precedence for each binary operator that
-  /// is defined.
-  std::unordered_map<char, int> UserBinOpPrec{};
+    /// IsUnary - Whether it is a user defined unary operator.
+    bool IsUnary = false;
 
-  /// UserUnaryOps - This holds each unary operator that is defined.
-  std::unordered_set<char> UserUnaryOps{};
+    friend auto operator==(const OperatorInfo&, const OperatorInfo&)
+        -> bool = default;
+  };
+
+  /// OperatorTable - What each ASCII character means as an operator, indexed
+  /// by its code.
+  using OperatorTable = std::array<OperatorInfo, 128>;
+
+  /// DefaultOperators - The builtin binary operators.
+  static const OperatorTable DefaultOperators;
+
+  /// Operators - The operators in effect. User binary and unary definitions
+  /// update it in place.
+  OperatorTable Operators = DefaultOperators;
+
+  /// synchronize - Skips the rest of a failed item, up to the ';' ending it or
+  /// a def or extern starting the next one, so that one error does not cascade
+  /// through the items after it.
+  void synchronize();
 
   /// getTokPrecedence - Get the precedence of the pending binary operator
   /// token.
-  auto getTokPrecedence(int Tok) const -> int;
+  [[nodiscard]] auto getTokPrecedence(int Tok) const noexcept -> int {
+    if (!isascii(Tok)) return -1;
+    return Operators[static_cast<std::size_t>(Tok)].BinaryPrec;
+  }
 
   /// numberexpr ::= number
-  auto parseNumberExpr() -> std::unique_ptr<NumberExprAST>;
+  auto parseNumberExpr() -> ASTHandle<NumberExprAST>;
 
   /// parenexpr ::= '(' expression ')'
-  auto parseParenExpr() -> std::unique_ptr<ExprAST>;
+  auto parseParenExpr() -> ASTHandle<ExprAST>;
 
   /// identifierexpr
   ///   ::= identifier
   ///   ::= identifier '(' expression* ')'
-  auto parseIdentifierOrCallExpr() -> std::unique_ptr<ExprAST>;
+  auto parseIdentifierOrCallExpr() -> ASTHandle<ExprAST>;
 
   /// unaryexpr
   ///   ::= unaryop expression
-  auto parseUnaryExpr() -> std::unique_ptr<UnaryExprAST>;
+  auto parseUnaryExpr() -> ASTHandle<UnaryExprAST>;
 
   /// primary
   ///   ::= identifierexpr
@@ -51,51 +147,99 @@ class Parser {
   ///   ::= ifexpr
   ///   ::= forexpr
   ///   ::= varassignexpr
-  auto parsePrimary() -> std::unique_ptr<ExprAST>;
+  /// A malformed token fails without another error, as the lexer has reported
+  /// it already.
+  auto parsePrimary() -> ASTHandle<ExprAST>;
 
   /// binoprhs
   ///   ::= ('+' primary)*
-  auto parseBinOpRHS(int ExprPrec, std::unique_ptr<ExprAST> LHS)
-      -> std::unique_ptr<ExprAST>;
+  auto parseBinOpRHS(int ExprPrec, ASTHandle<ExprAST> LHS)
+      -> ASTHandle<ExprAST>;
 
   /// ifexpr
   ///   ::= 'if' expression 'then' expression 'else' expression
-  auto parseIfExpr() -> std::unique_ptr<IfExprAST>;
+  auto parseIfExpr() -> ASTHandle<IfExprAST>;
 
   /// forexpr
   ///   ::= 'for' identifier '=' expr ',' expr (',' expr)? 'in' expression
-  auto parseForExpr() -> std::unique_ptr<ForExprAST>;
+  auto parseForExpr() -> ASTHandle<ForExprAST>;
 
   /// varassignexpr
   ///   ::= 'var' identifier '=' expr (',' identifier '=' expr)* 'in' expression
-  auto parseVarAssignExpr() -> std::unique_ptr<VarAssignExprAST>;
+  auto parseVarAssignExpr() -> ASTHandle<VarAssignExprAST>;
 
   /// expression
   ///   ::= primary binoprhs
-  auto parseExpression() -> std::unique_ptr<ExprAST>;
+  auto parseExpression() -> ASTHandle<ExprAST>;
+
+  /// parseExpressionIterative - Parses an expression like parseExpression,
+  /// building the same AST, but keeps the pending parentheses, unary operators
+  /// and binary operators on explicit stacks. Only calls, if, for and var
+  /// still recurse for the expressions inside them, so operator nesting of any
+  /// depth costs heap rather than call stack.
+  auto parseExpressionIterative() -> ASTHandle<ExprAST>;
 
   /// protobinary
   ///   ::= binary char number (id, id)
-  auto parseProtoBinary() -> std::unique_ptr<ProtoBinaryAST>;
+  auto parseProtoBinary() -> ASTHandle<ProtoBinaryAST>;
 
   /// protounary
   ///   ::= unary char (id)
-  auto parseProtoUnary() -> std::unique_ptr<ProtoUnaryAST>;
+  auto parseProtoUnary() -> ASTHandle<ProtoUnaryAST>;
 
   /// prototype
   ///   ::= id '(' id* ')'
   ///   ::= protobinary
   ///   ::= protounary
-  auto parsePrototype() -> std::unique_ptr<PrototypeAST>;
+  auto parsePrototype() -> ASTHandle<PrototypeAST>;
 
   /// definition ::= 'def' prototype expression
-  auto parseDefinition() -> std::unique_ptr<FunctionAST>;
+  auto parseDefinition() -> ASTHandle<FunctionAST>;
 
   /// external ::= 'extern' prototype
-  auto parseExtern() -> std::unique_ptr<PrototypeAST>;
+  auto parseExtern() -> ASTHandle<PrototypeAST>;
+
+  /// astnode ::= expression | external | definition
+  auto parseTopLevel() -> ASTHandle<ASTNode>;
+
+  /// Parses Tokens from index Begin on, as if the items before it had been
+  /// parsed already and had left the operators as Ops. Begin must be 0 or
+  /// follow a ';'.
+  Parser(
+      const TokenStream& Tokens, std::size_t Begin, const OperatorTable& Ops
+  ) noexcept
+      : Tokens(&Tokens)
+      , NextTok(Begin)
+      , LexAhead(false)
+      , Operators(Ops) {
+    if (Begin != 0) Cur = Tokens.getToken(Begin - 1);
+  }
+
+  /// definesSemicolon - Whether Tokens define ';' as an operator, in which
+  /// case a ';' does not always end an item.
+  static auto definesSemicolon(const TokenStream& Tokens) -> bool;
+
+  /// parseItems - Parses items into C and appends them to Items, up to the
+  /// one ending at the ';' at index End, or up to tok_eof. A failed item is
+  /// appended as null.
+  void parseItems(
+      ASTContext&                            C,
+      std::size_t                            End,
+      llvm::SmallVectorImpl<const ASTNode*>& Items
+  );
 
  public:
-  explicit Parser(Lexer& Lex) : Lex(Lex) {}
+  /// Lexing ahead in bulk is only safe if the input will not block, so it is
+  /// off for the REPL and meant for whole files.
+  explicit Parser(Lexer& Lex, bool LexAhead = false) noexcept
+      : Lex(&Lex)
+      , LexAhead(LexAhead) {}
+
+  /// Parses a stream produced by Lexer::tokenize, which must outlive the
+  /// Parser.
+  explicit Parser(const TokenStream& Tokens) noexcept
+      : Tokens(&Tokens)
+      , LexAhead(false) {}
 
   ~Parser() = default;
 
@@ -103,14 +247,70 @@ class Parser {
   Parser(const Parser&) = delete;
   Parser(Parser&&)      = delete;
 
-  /// getNextToken - reads another token from the lexer and updates CurTok with
-  /// its results.
-  auto getNextToken() -> int { return CurTok = Lex.gettok(); }
+  /// setDiagnostics - Collects errors into D instead of printing them, or goes
+  /// back to printing if D is null. Those of the Lexer read from go there too.
+  void setDiagnostics(std::vector<Diagnostic>* D) noexcept {
+    DiagnosticSink::setDiagnostics(D);
+    if (Lex) Lex->setDiagnostics(D);
+  }
 
-  [[nodiscard]] auto getCurToken() const noexcept -> int { return CurTok; }
+  /// getNextToken - Moves on to the next token, from the lookahead buffer if
+  /// it has been lexed already, and returns its kind. The error of a tok_err
+  /// read from a stream is reported as the parser reaches it.
+  auto getNextToken() -> int {
+    if (Tokens) {
+      Cur = Tokens->getToken(NextTok);
+      if (Cur.Kind == Lexer::tok_err) {
+        const Diagnostic& D = Tokens->getError(NextTok);
+        error(D.Loc, D.Message);
+      }
+      if (NextTok + 1 != Tokens->size()) ++NextTok; // Stay on tok_eof.
+      return Cur.Kind;
+    }
+    if (AheadCount == 0 && !LexAhead) return (Cur = Lex->lex()).Kind;
+    fillAhead(1);
+    Cur        = Ahead[AheadBegin];
+    AheadBegin = (AheadBegin + 1) % LookaheadSize;
+    --AheadCount;
+    return Cur.Kind;
+  }
 
-  /// astnode ::= expression | external | definition
-  auto parse() -> std::unique_ptr<ASTNode>;
+  /// peekToken - The token N places after the current one, lexing it if
+  /// needed. N must be in [1, LookaheadSize].
+  auto peekToken(std::size_t N = 1) -> LexedToken {
+    if (Tokens)
+      return Tokens->getToken(std::min(NextTok + N - 1, Tokens->size() - 1));
+    fillAhead(N);
+    return Ahead[(AheadBegin + N - 1) % LookaheadSize];
+  }
+
+  [[nodiscard]] auto getCurToken() const noexcept -> int { return Cur.Kind; }
+
+  [[nodiscard]] auto getCurLoc() const noexcept -> SourceLocation {
+    return Cur.Loc;
+  }
+
+  /// setIterativeExprs - Chooses between the recursive and explicit stack
+  /// expression parsers, for input that may be nested deeper than the call
+  /// stack allows.
+  void setIterativeExprs(bool Enable) noexcept { IterativeExprs = Enable; }
+
+  /// parse - Parses the next top-level item into a new item of C, which owns
+  /// its nodes. After a failed item, which returns null, the parser skips to
+  /// the start of the next one.
+  auto parse(ASTContext& C) -> const ASTNode*;
+
+  /// parse - Parses into a context owned by the parser, so the result lives
+  /// as long as the parser does.
+  auto parse() -> const ASTNode* { return parse(OwnCtx); }
+
+  /// parseParallel - Parses all of Tokens, splitting it at ';' into runs of
+  /// items parsed concurrently on up to NumThreads threads, 0 meaning one per
+  /// core, each into a context of its own. The result is what parsing the
+  /// items one by one would give. Errors are collected into the result rather
+  /// than printed.
+  static auto parseParallel(const TokenStream& Tokens, unsigned NumThreads = 0)
+      -> ParsedModule;
 };
 
 } // namespace kaleidoscope
@@ -0,0 +1,65 @@
+#ifndef KALEIDOSCOPE_SEMA_RESOLVER_H
+#define KALEIDOSCOPE_SEMA_RESOLVER_H
+
+#include "kaleidoscope/AST/AST.h"
+#include "kaleidoscope/AST/ASTVisitor.h"
+#include "kaleidoscope/Sema/SlotTable.h"
+#include "kaleidoscope/Util/Error/Diagnostic.h"
+
+#include <llvm/ADT/SmallVector.h>
+
+namespace kaleidoscope {
+
+/// Resolver - Works out which variable each VariableExprAST of a top-level
+/// item refers to, ahead of CodeGen, and records it in a SlotTable.
+/// The variables of a function are numbered in the order they come into
+/// scope: its arguments, then each for and var binding, with a binding
+/// getting the slot after the innermost variable still in scope. Sibling
+/// scopes thus share slots, and CodeGen can keep the variables in a flat
+/// stack indexed by slot.
+///
+/// Every unknown variable in the item is reported, not only the first.
+/// References are visited in the order CodeGen emits them, which is the
+/// order their slots are listed in.
+class Resolver
+    : public DiagnosticSink
+    , private ASTVisitor<Resolver, AVDelType::ExprAST> {
+  using Self   = Resolver;
+  using Parent = ASTVisitor<Self, AVDelType::ExprAST>;
+  friend Parent;
+
+  /// Scope - The variables in scope, indexed by slot. A name shadows the
+  /// same name earlier on.
+  llvm::SmallVector<Symbol, 16> Scope{};
+
+  /// Slots - Where the slots of the item being resolved go.
+  SlotTable* Slots = nullptr;
+
+  bool Failed = false;
+
+ public:
+  /// resolve - Resolves the variables in F's body into S, replacing what it
+  /// held, and returns whether they were all found.
+  auto resolve(const FunctionAST& F, SlotTable& S) -> bool;
+
+  /// resolve - Resolves the variables in E, a top-level expression, into S.
+  auto resolve(const ExprAST& E, SlotTable& S) -> bool;
+
+ private:
+  /// resolveItem - Resolves Body, with the item's arguments already in
+  /// scope, into S.
+  auto resolveItem(const ExprAST& Body, SlotTable& S) -> bool;
+
+  void visitImpl(const BinaryExprAST& A);
+  void visitImpl(const UnaryExprAST& A);
+  void visitImpl(const CallExprAST& A);
+  void visitImpl(const ForExprAST& A);
+  void visitImpl(const IfExprAST& A);
+  void visitImpl(const NumberExprAST& A);
+  void visitImpl(const VariableExprAST& A);
+  void visitImpl(const VarAssignExprAST& A);
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_SEMA_RESOLVER_H
@@ -0,0 +1,59 @@
+#ifndef KALEIDOSCOPE_SEMA_SLOTTABLE_H
+#define KALEIDOSCOPE_SEMA_SLOTTABLE_H
+
+#include "kaleidoscope/AST/AST.h"
+
+#include <llvm/ADT/ArrayRef.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kaleidoscope {
+
+/// SlotTable - The slot of each variable reference in one top-level item: the
+/// index of the variable among those in scope where it is referenced, counting
+/// the function's arguments first and then each enclosing for and var binding
+/// from the outermost in.
+///
+/// Slots are listed in the order the Resolver reaches the references, which is
+/// the order CodeGen emits them in, so CodeGen finds each one by position
+/// rather than by a lookup. A node reached from more than one place, as in
+/// HashCons's output, gets an entry, and possibly a different slot, at each.
+class SlotTable {
+ public:
+  /// Entry - A reference, kept to check that CodeGen is where the Resolver
+  /// was, and its slot.
+  struct Entry {
+    const VariableExprAST* Ref;
+    std::uint32_t          Slot;
+  };
+
+ private:
+  std::vector<Entry> Entries{};
+
+  friend class Resolver;
+
+ public:
+  /// NoSlot - The slot of a reference that was not resolved.
+  static constexpr std::uint32_t NoSlot = ~std::uint32_t{0};
+
+  /// lookup - The slot of reference I of the item if it is V, or NoSlot if
+  /// it has none or the item was visited in another order.
+  [[nodiscard]] auto lookup(std::size_t I, const VariableExprAST& V) const
+      -> std::uint32_t {
+    if (I >= Entries.size() || Entries[I].Ref != &V) return NoSlot;
+    return Entries[I].Slot;
+  }
+
+  [[nodiscard]] auto entries() const noexcept -> llvm::ArrayRef<Entry> {
+    return Entries;
+  }
+
+  /// clear - Forgets every slot, ready for the next item.
+  void clear() { Entries.clear(); }
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_SEMA_SLOTTABLE_H
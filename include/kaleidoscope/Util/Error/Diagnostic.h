@@ -0,0 +1,46 @@
+#ifndef KALEIDOSCOPE_UTIL_ERROR_DIAGNOSTIC_H
+#define KALEIDOSCOPE_UTIL_ERROR_DIAGNOSTIC_H
+
+#include "kaleidoscope/Util/Error/Log.h"
+#include "kaleidoscope/Util/SourceLocation.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kaleidoscope {
+
+/// Diagnostic - An error kept for reporting later rather than printed when it
+/// is found.
+struct Diagnostic {
+  SourceLocation Loc{};
+  std::string    Message{};
+
+  /// print - Reports the error on stderr, as logError would have.
+  void print() const { logError(Loc, Message); }
+};
+
+/// DiagnosticSink - Base for the stages that report errors in the source:
+/// they are printed as they are found, or collected for reporting later.
+class DiagnosticSink {
+  /// Diags - Where errors go, or null to print them.
+  std::vector<Diagnostic>* Diags = nullptr;
+
+ public:
+  /// setDiagnostics - Collects errors into D instead of printing them, or goes
+  /// back to printing if D is null.
+  void setDiagnostics(std::vector<Diagnostic>* D) noexcept { Diags = D; }
+
+ protected:
+  /// error - Reports Msg at Loc and returns null for the caller to pass up.
+  auto error(SourceLocation Loc, std::string_view Msg) const -> std::nullptr_t {
+    if (!Diags) return logError(Loc, Msg);
+    Diags->push_back({Loc, std::string(Msg)});
+    return nullptr;
+  }
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_UTIL_ERROR_DIAGNOSTIC_H
@@ -1,6 +1,8 @@
 #ifndef KALEIDOSCOPE_UTIL_ERROR_LOG_H
 #define KALEIDOSCOPE_UTIL_ERROR_LOG_H
 
+#include "kaleidoscope/Util/SourceLocation.h"
+
 #include <fmt/core.h>
 
 #include <string_view>
@@ -13,6 +15,18 @@ inline static auto logError(std::string_view Str) -> std::nullptr_t {
   return nullptr;
 }
 
+/// logError - Reports Str prefixed with the decoded position of Loc, or
+/// without a position if Loc is invalid.
+inline static auto logError(SourceLocation Loc, std::string_view Str)
+    -> std::nullptr_t {
+  PresumedLoc P = SourceManager::get().getPresumedLoc(Loc);
+  if (!P.isValid()) return logError(Str);
+  fmt::print(
+      stderr, "{}:{}:{}: Error: {}\n", P.BufferName, P.Line, P.Column, Str
+  );
+  return nullptr;
+}
+
 } // namespace kaleidoscope
 
 #endif // KALEIDOSCOPE_UTIL_ERROR_LOG_H
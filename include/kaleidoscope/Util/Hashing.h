@@ -0,0 +1,30 @@
+#ifndef KALEIDOSCOPE_UTIL_HASHING_H
+#define KALEIDOSCOPE_UTIL_HASHING_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/xxhash.h>
+
+#include <cstdint>
+
+namespace kaleidoscope {
+
+/// hashKey - A 63-bit hash of Bytes, for use as a DenseMap key. The top bit is
+/// dropped to keep clear of the empty and tombstone keys DenseMap reserves for
+/// std::uint64_t. Distinct keys may share a hash, so callers compare the keys
+/// themselves on a match.
+inline auto hashKey(llvm::StringRef Bytes) -> std::uint64_t {
+  return llvm::xxHash64(Bytes) >> 1;
+}
+
+/// hashKey - A 63-bit hash of the object representation of Words.
+template<typename T>
+auto hashKey(llvm::ArrayRef<T> Words) -> std::uint64_t {
+  return hashKey(llvm::StringRef(
+      reinterpret_cast<const char*>(Words.data()), Words.size() * sizeof(T)
+  ));
+}
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_UTIL_HASHING_H
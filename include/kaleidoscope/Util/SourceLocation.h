@@ -0,0 +1,175 @@
+#ifndef KALEIDOSCOPE_UTIL_SOURCELOCATION_H
+#define KALEIDOSCOPE_UTIL_SOURCELOCATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kaleidoscope {
+
+/// SourceLocation - A position in some lexed text, encoded in 32 bits as an
+/// offset into the SourceManager's table of chunks. Zero is the invalid
+/// location; everything else is decoded lazily through the SourceManager.
+class SourceLocation {
+  std::uint32_t Raw = 0;
+
+ public:
+  constexpr SourceLocation() noexcept = default;
+
+  [[nodiscard]] static constexpr auto fromRaw(std::uint32_t Raw) noexcept
+      -> SourceLocation {
+    SourceLocation L;
+    L.Raw = Raw;
+    return L;
+  }
+
+  [[nodiscard]] constexpr auto getRaw() const noexcept -> std::uint32_t {
+    return Raw;
+  }
+
+  [[nodiscard]] constexpr auto isValid() const noexcept -> bool {
+    return Raw != 0;
+  }
+
+  /// getLocWithOffset - The location Offset characters further on.
+  [[nodiscard]] constexpr auto getLocWithOffset(std::uint32_t Offset
+  ) const noexcept -> SourceLocation {
+    return isValid() ? fromRaw(Raw + Offset) : SourceLocation();
+  }
+
+  friend constexpr auto operator==(SourceLocation, SourceLocation) noexcept
+      -> bool = default;
+};
+
+/// PresumedLoc - A decoded SourceLocation. Line and column are 1 based.
+struct PresumedLoc {
+  std::string_view BufferName{};
+  std::uint32_t    Offset = 0;
+  unsigned         Line = 0, Column = 0;
+
+  [[nodiscard]] auto isValid() const noexcept -> bool { return Line != 0; }
+};
+
+/// SourceManager - The process wide table mapping SourceLocations back to the
+/// text they came from. Every chunk a Lexer reads is registered here and gets
+/// its own range of locations. The text itself is not copied: each buffer
+/// holds a reference to the owner of its chunks, or each chunk to its own
+/// owner, which releasing the chunk drops. Line tables are only built for a
+/// chunk the first time one of its locations, or a later one, is decoded.
+/// Callers release what they no longer decode, and locations into released
+/// text decode as invalid. All members are thread safe.
+class SourceManager {
+  /// NoChunk - Marks the end of a buffer's list of chunks.
+  static constexpr std::size_t NoChunk = ~std::size_t{0};
+
+  struct Buffer {
+    std::string                 Name;
+    std::shared_ptr<const void> Owner;
+    std::uint32_t               Size = 0;
+    bool                        Released = false;
+
+    /// FirstChunk/LastChunk - The buffer's first chunk not yet released and
+    /// its last chunk, or NoChunk.
+    std::size_t FirstChunk = NoChunk, LastChunk = NoChunk;
+
+    /// Uncounted - The buffer's first chunk whose lines have not been
+    /// counted, or NoChunk. NextLine is the line it starts in and
+    /// NextLineStart the buffer offset of that line.
+    std::size_t   Uncounted     = NoChunk;
+    unsigned      NextLine      = 1;
+    std::uint32_t NextLineStart = 0;
+  };
+
+  struct Chunk {
+    std::string_view Text;
+    unsigned         BufferID;
+    std::uint32_t    Base;
+    std::uint32_t    OffsetInBuffer;
+    std::size_t      NextInBuffer = NoChunk;
+    bool             Released     = false;
+
+    /// Owner - Keeps Text alive, if the buffer's owner does not.
+    std::shared_ptr<const void> Owner{};
+
+    /// FirstLine/FirstLineStart - The line the chunk starts in and the buffer
+    /// offset of that line, once the chunk's lines have been counted.
+    unsigned      FirstLine      = 0;
+    std::uint32_t FirstLineStart = 0;
+
+    /// LineStarts - Buffer offsets of the character after each '\n' in Text,
+    /// built on first use.
+    std::unique_ptr<std::vector<std::uint32_t>> LineStarts{};
+  };
+
+  mutable std::mutex Lock{};
+  std::deque<Buffer> Buffers{};
+
+  /// Chunks - Every chunk from FirstChunk on, in location order. Chunks are
+  /// identified by their index counting from the very first one, and released
+  /// chunks are dropped from the front.
+  std::deque<Chunk> Chunks{};
+  std::size_t       FirstChunk = 0;
+
+  /// NextBase - The raw location the next chunk starts at. Each chunk also
+  /// reserves the location one past its end, which becomes the start of the
+  /// next chunk if that is from the same buffer. Consecutive chunks of a
+  /// buffer are therefore usually contiguous, so a location can be offset
+  /// across a chunk boundary.
+  std::uint32_t NextBase = 1;
+
+  auto getChunk(std::size_t Index) -> Chunk& {
+    return Chunks[Index - FirstChunk];
+  }
+
+  /// findChunk - The index of the live chunk holding Loc, or NoChunk.
+  auto findChunk(SourceLocation Loc) const -> std::size_t;
+
+  auto getLineStarts(Chunk& C) -> const std::vector<std::uint32_t>&;
+
+  /// countLines - Counts the lines of the chunks of Buf before the chunk
+  /// Index.
+  void countLines(Buffer& Buf, std::size_t Index);
+
+  /// releaseChunk - Forgets the text, owner and line table of C, dropping
+  /// released chunks from the front of the table.
+  void releaseChunk(Chunk& C);
+
+ public:
+  static auto get() -> SourceManager&;
+
+  /// createBuffer - Registers a new, empty buffer and returns its ID. Owner
+  /// keeps the text of the buffer's chunks alive.
+  auto createBuffer(std::string Name, std::shared_ptr<const void> Owner)
+      -> unsigned;
+
+  /// addChunk - Appends Text to buffer BufferID and returns the location of
+  /// its first character, or an invalid location once the 32 bit location
+  /// space is exhausted. Owner, if any, keeps Text alive until the chunk is
+  /// released. The buffer must not have been released.
+  auto addChunk(
+      unsigned                    BufferID,
+      std::string_view            Text,
+      std::shared_ptr<const void> Owner = nullptr
+  ) -> SourceLocation;
+
+  /// getPresumedLoc - Decodes Loc into its buffer, line and column.
+  auto getPresumedLoc(SourceLocation Loc) -> PresumedLoc;
+
+  /// releaseBuffer - Forgets the whole buffer holding Loc, such as an earlier
+  /// version of an input, and drops the reference to its text.
+  void releaseBuffer(SourceLocation Loc);
+
+  /// releaseChunksBefore - Forgets the chunks of Loc's buffer that come before
+  /// the one holding Loc, such as the lines of a REPL's earlier items. Later
+  /// lines keep their numbers.
+  void releaseChunksBefore(SourceLocation Loc);
+};
+
+} // namespace kaleidoscope
+
+#endif // KALEIDOSCOPE_UTIL_SOURCELOCATION_H
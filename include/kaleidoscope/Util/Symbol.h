@@ -0,0 +1,86 @@
+#ifndef KALEIDOSCOPE_UTIL_SYMBOL_H
+#define KALEIDOSCOPE_UTIL_SYMBOL_H
+
+#include <llvm/ADT/DenseMapInfo.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <string_view>
+
+namespace kaleidoscope {
+
+/// Symbol - An interned identifier. Every distinct name is stored exactly once
+/// in a process wide table, so copying, comparing and hashing a Symbol only
+/// touches a pointer. Interning is thread safe.
+class Symbol {
+  /// Points at the interned, null terminated characters of the name.
+  const char* Data = nullptr;
+  std::size_t Size = 0;
+
+  constexpr Symbol(const char* Data, std::size_t Size) noexcept
+      : Data(Data)
+      , Size(Size) {}
+
+  friend struct llvm::DenseMapInfo<Symbol>;
+
+ public:
+  /// Constructs the empty symbol, which names nothing.
+  constexpr Symbol() noexcept = default;
+
+  /// get - Interns Name, returning the unique Symbol for it.
+  static auto get(std::string_view Name) -> Symbol;
+
+  [[nodiscard]] constexpr auto str() const noexcept -> llvm::StringRef {
+    return {Data, Size};
+  }
+
+  [[nodiscard]] constexpr auto empty() const noexcept -> bool {
+    return Data == nullptr;
+  }
+
+  /// getOpaqueValue - A unique integer identifying this symbol.
+  [[nodiscard]] auto getOpaqueValue() const noexcept -> std::uintptr_t {
+    return reinterpret_cast<std::uintptr_t>(Data);
+  }
+
+  friend constexpr auto operator==(Symbol L, Symbol R) noexcept -> bool {
+    return L.Data == R.Data;
+  }
+
+  friend auto operator==(Symbol L, llvm::StringRef R) noexcept -> bool {
+    return L.str() == R;
+  }
+};
+
+} // namespace kaleidoscope
+
+template<>
+struct llvm::DenseMapInfo<kaleidoscope::Symbol> {
+  using Symbol = kaleidoscope::Symbol;
+
+  static auto getEmptyKey() -> Symbol {
+    return {DenseMapInfo<const char*>::getEmptyKey(), 0};
+  }
+
+  static auto getTombstoneKey() -> Symbol {
+    return {DenseMapInfo<const char*>::getTombstoneKey(), 0};
+  }
+
+  static auto getHashValue(Symbol S) -> unsigned {
+    return DenseMapInfo<const char*>::getHashValue(S.Data);
+  }
+
+  static auto isEqual(Symbol L, Symbol R) -> bool { return L == R; }
+};
+
+template<>
+struct fmt::formatter<kaleidoscope::Symbol> : formatter<std::string_view> {
+  template<typename FormatContext>
+  auto format(kaleidoscope::Symbol S, FormatContext& Ctx) const {
+    return formatter<std::string_view>::format(S.str(), Ctx);
+  }
+};
+
+#endif // KALEIDOSCOPE_UTIL_SYMBOL_H
@@ -0,0 +1,48 @@
+#include "kaleidoscope/AST/AST.h"
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// OperatorNames - The function names of one kind of operator, like
+/// "binary|", interned once for every ASCII character and indexed by its
+/// code.
+class OperatorNames {
+  std::string_view        Kind;
+  std::array<Symbol, 128> Names{};
+
+  auto intern(char Op) const -> Symbol {
+    return Symbol::get(fmt::format(FMT_COMPILE("{}{}"), Kind, Op));
+  }
+
+ public:
+  explicit OperatorNames(std::string_view Kind)
+      : Kind(Kind) {
+    for (std::size_t C = 0; C < Names.size(); ++C)
+      Names[C] = intern(static_cast<char>(C));
+  }
+
+  auto get(char Op) const -> Symbol {
+    auto C = static_cast<unsigned char>(Op);
+    return C < Names.size() ? Names[C] : intern(Op);
+  }
+};
+
+} // namespace
+
+auto ProtoBinaryAST::getFunctionName(char Op) -> Symbol {
+  static const OperatorNames Names("binary");
+  return Names.get(Op);
+}
+
+auto ProtoUnaryAST::getFunctionName(char Op) -> Symbol {
+  static const OperatorNames Names("unary");
+  return Names.get(Op);
+}
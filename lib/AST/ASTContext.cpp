@@ -0,0 +1,42 @@
+#include "kaleidoscope/AST/ASTContext.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace kaleidoscope;
+
+void ASTContext::moveItem(std::size_t Needed) {
+  std::size_t Size = MinSlabSize;
+  if (!Slabs.empty()) Size = 2 * Slabs.back().Size;
+  Size = std::max(Size, static_cast<std::size_t>(llvm::PowerOf2Ceil(Needed)));
+
+  Slab New{
+      std::unique_ptr<std::uint64_t[]>(new std::uint64_t[Size / ItemAlign]),
+      Size};
+  std::size_t ItemSize = ItemEnd - ItemBegin;
+  if (ItemSize != 0) std::memcpy(New.Mem.get(), itemBase(), ItemSize);
+
+  // A slab holding nothing but the item being moved is no longer needed.
+  if (!Slabs.empty() && ItemBegin == 0) Slabs.pop_back();
+  Slabs.push_back(std::move(New));
+  ItemBegin = 0;
+  ItemEnd   = ItemSize;
+}
+
+void ASTContext::reset() {
+  if (Slabs.size() > 1) Slabs.erase(Slabs.begin(), std::prev(Slabs.end()));
+  ItemBegin = ItemEnd = 0;
+  BytesAllocated      = 0;
+}
+
+auto ASTContext::copy(const PrototypeAST& P) -> ASTHandle<PrototypeAST> {
+  auto Args = copyArray<Symbol>(P.getArgs());
+  if (const auto* B = llvm::dyn_cast<ProtoBinaryAST>(&P))
+    return create<ProtoBinaryAST>(
+        B->getOperator(), Args, B->getPrecedence(), B->getLoc()
+    );
+  if (const auto* U = llvm::dyn_cast<ProtoUnaryAST>(&P))
+    return create<ProtoUnaryAST>(U->getOperator(), Args, U->getLoc());
+  return create<PrototypeAST>(P.getName(), Args, P.getLoc());
+}
@@ -0,0 +1,154 @@
+#include "kaleidoscope/AST/ConstantFold.h"
+
+#include "kaleidoscope/AST/ASTTraversal.h"
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <cmath>
+#include <optional>
+#include <utility>
+
+using namespace kaleidoscope;
+using namespace kaleidoscope::ast;
+
+namespace {
+
+/// evaluate - L Op R for a builtin operator, computed the way the IR CodeGen
+/// emits for it does, or nothing if Op is not one.
+auto evaluate(char Op, double L, double R) -> std::optional<double> {
+  switch (Op) {
+  case '+': return L + R;
+  case '-': return L - R;
+  case '*': return L * R;
+  case '/': return L / R;
+  // The comparisons are unordered, so they hold when either side is a NaN.
+  case '<': return std::isless(L, R) || std::isunordered(L, R) ? 1.0 : 0.0;
+  case '>': return std::isgreater(L, R) || std::isunordered(L, R) ? 1.0 : 0.0;
+  default: return std::nullopt;
+  }
+}
+
+/// isIdentity - Whether C Op X is X whatever X is, when C is on the left or
+/// X Op C is when it is on the right.
+auto isIdentity(char Op, double C, bool ConstOnLeft) -> bool {
+  switch (Op) {
+  case '*': return C == 1.0;
+  case '/': return !ConstOnLeft && C == 1.0;
+  // -0 is the identity of addition but +0 is not, as -0 + +0 is +0.
+  case '+': return C == 0.0 && std::signbit(C);
+  case '-': return !ConstOnLeft && C == 0.0 && !std::signbit(C);
+  default: return false;
+  }
+}
+
+} // namespace
+
+void ConstantFold::beginItem() {
+  NumOriginal = 0;
+  NumFolded   = 0;
+  Ctx.beginItem();
+}
+
+auto ConstantFold::fold(const FunctionAST& F) -> const FunctionAST* {
+  beginItem();
+  auto Proto = Ctx.copy(F.getProto());
+  auto Body  = node(visit(F.getBody()));
+  return Ctx.get(Ctx.create<FunctionAST>(Proto, Body, F.getLoc()));
+}
+
+auto ConstantFold::fold(const ExprAST& E) -> const ExprAST* {
+  beginItem();
+  return Ctx.get(node(visit(E)));
+}
+
+auto ConstantFold::node(const Folded& F) -> ASTHandle<ExprAST> {
+  if (!F.isConstant()) return F.Node;
+  ++NumFolded;
+  return Ctx.create<NumberExprAST>(F.Val, F.Loc);
+}
+
+void ConstantFold::drop(const ExprAST& E) {
+  NodeCounter Counter;
+  Counter.traverse(E);
+  NumOriginal += Counter.getCount();
+}
+
+auto ConstantFold::visitImpl(const BinaryExprAST& A) -> Folded {
+  ++NumOriginal;
+  Folded L = visit(A.getLHS());
+  Folded R = visit(A.getRHS());
+  char   Op = A.getOp();
+
+  if (L.isConstant() && R.isConstant())
+    if (auto Val = evaluate(Op, L.Val, R.Val)) return {{}, *Val, A.getLoc()};
+  // A constant has no effect, so all a sequence starting with one gives is
+  // its right side.
+  if (Op == ':' && L.isConstant()) return R;
+  if (L.isConstant() && isIdentity(Op, L.Val, true)) return R;
+  if (R.isConstant() && isIdentity(Op, R.Val, false)) return L;
+
+  return copy(Ctx.create<BinaryExprAST>(Op, node(L), node(R), A.getLoc()));
+}
+
+auto ConstantFold::visitImpl(const UnaryExprAST& A) -> Folded {
+  ++NumOriginal;
+  Folded Operand = visit(A.getOperand());
+  return copy(Ctx.create<UnaryExprAST>(
+      A.getOpcode(), node(Operand), A.getLoc()
+  ));
+}
+
+auto ConstantFold::visitImpl(const CallExprAST& A) -> Folded {
+  ++NumOriginal;
+  llvm::SmallVector<ASTHandle<ExprAST>, 8> Args;
+  for (const auto& Arg : A.getArgs()) Args.push_back(node(visit(*Arg)));
+  return copy(Ctx.create<CallExprAST>(
+      A.getCallee(), Ctx.copyArray<ASTRef<ExprAST>>(Args), A.getLoc()
+  ));
+}
+
+auto ConstantFold::visitImpl(const ForExprAST& A) -> Folded {
+  ++NumOriginal;
+  auto Start = node(visit(A.getStart()));
+  auto End   = node(visit(A.getEnd()));
+  auto Step  = node(visit(A.getStep()));
+  auto Body  = node(visit(A.getBody()));
+  return copy(Ctx.create<ForExprAST>(
+      A.getVarName(), Start, End, Step, Body, A.getLoc()
+  ));
+}
+
+auto ConstantFold::visitImpl(const IfExprAST& A) -> Folded {
+  ++NumOriginal;
+  Folded Cond = visit(A.getCond());
+  if (Cond.isConstant()) {
+    // The condition is taken when it is ordered and not equal to 0.
+    bool Taken = Cond.Val != 0.0 && !std::isnan(Cond.Val);
+    drop(Taken ? A.getElse() : A.getThen());
+    return visit(Taken ? A.getThen() : A.getElse());
+  }
+  auto Then = node(visit(A.getThen()));
+  auto Else = node(visit(A.getElse()));
+  return copy(Ctx.create<IfExprAST>(node(Cond), Then, Else, A.getLoc()));
+}
+
+auto ConstantFold::visitImpl(const NumberExprAST& A) -> Folded {
+  ++NumOriginal;
+  return {{}, A.getVal(), A.getLoc()};
+}
+
+auto ConstantFold::visitImpl(const VariableExprAST& A) -> Folded {
+  ++NumOriginal;
+  return copy(Ctx.create<VariableExprAST>(A.getName(), A.getLoc()));
+}
+
+auto ConstantFold::visitImpl(const VarAssignExprAST& A) -> Folded {
+  ++NumOriginal;
+  llvm::SmallVector<std::pair<Symbol, ASTHandle<ExprAST>>, 4> VarAs;
+  for (const auto& [Name, Init] : A.getVarAs())
+    VarAs.emplace_back(Name, node(visit(*Init)));
+  auto Body = node(visit(A.getBody()));
+  return copy(Ctx.create<VarAssignExprAST>(
+      Ctx.copyArray<VarAssignExprAST::VarAssignPair>(VarAs), Body, A.getLoc()
+  ));
+}
@@ -0,0 +1,10 @@
+#include "kaleidoscope/AST/Dump/DumpStream.h"
+
+using namespace kaleidoscope;
+using namespace kaleidoscope::ast;
+
+void DumpStream::flush() {
+  if (Buf.empty()) return;
+  Out.write(Buf.data(), static_cast<std::streamsize>(Buf.size()));
+  Buf.clear();
+}
@@ -0,0 +1,182 @@
+#include "kaleidoscope/AST/Dump/JSONDump.h"
+
+#include <cmath>
+#include <cstddef>
+#include <string_view>
+
+using namespace kaleidoscope;
+using namespace kaleidoscope::ast;
+
+auto JSONDump::beginObject() -> Self& {
+  OS.write('{');
+  First = true;
+  Spaces += 2;
+  return *this;
+}
+
+auto JSONDump::endObject() -> Self& {
+  Spaces -= 2;
+  if (!First) OS.endLine().indent(Spaces);
+  OS.write('}');
+  First = false;
+  return *this;
+}
+
+auto JSONDump::beginArray(std::string_view Key) -> Self& {
+  key(Key);
+  OS.write('[');
+  First = true;
+  Spaces += 2;
+  return *this;
+}
+
+auto JSONDump::endArray() -> Self& {
+  Spaces -= 2;
+  if (!First) OS.endLine().indent(Spaces);
+  OS.write(']');
+  First = false;
+  return *this;
+}
+
+auto JSONDump::element() -> Self& {
+  if (!First) OS.write(',');
+  OS.endLine().indent(Spaces);
+  First = false;
+  return *this;
+}
+
+auto JSONDump::key(std::string_view Key) -> Self& {
+  element().writeString(Key);
+  OS.write(": ");
+  return *this;
+}
+
+auto JSONDump::writeString(std::string_view S) -> Self& {
+  OS.write('"');
+  std::size_t Start = 0;
+  for (std::size_t I = 0; I < S.size(); ++I) {
+    auto C = static_cast<unsigned char>(S[I]);
+    if (C >= 0x20 && C != '"' && C != '\\') continue;
+    OS.write(S.substr(Start, I - Start));
+    Start = I + 1;
+    switch (C) {
+    case '"': OS.write("\\\""); break;
+    case '\\': OS.write("\\\\"); break;
+    case '\n': OS.write("\\n"); break;
+    case '\r': OS.write("\\r"); break;
+    case '\t': OS.write("\\t"); break;
+    default: OS.print("\\u{:04x}", C); break;
+    }
+  }
+  OS.write(S.substr(Start)).write('"');
+  return *this;
+}
+
+auto JSONDump::writeNumber(double V) -> Self& {
+  if (std::isfinite(V)) {
+    OS.print("{}", V);
+    return *this;
+  }
+  OS.print("\"{}\"", V);
+  return *this;
+}
+
+auto JSONDump::member(std::string_view Key, const ASTNode& A) -> Self& {
+  key(Key);
+  Parent::visit(A);
+  return *this;
+}
+
+auto JSONDump::visitImpl(const BinaryExprAST& A) -> Self& {
+  return beginNode(A.NodeName)
+      .member("Op", A.getOp())
+      .member("LHS", A.getLHS())
+      .member("RHS", A.getRHS())
+      .endObject();
+}
+
+auto JSONDump::visitImpl(const UnaryExprAST& A) -> Self& {
+  return beginNode(A.NodeName)
+      .member("Opcode", A.getOpcode())
+      .member("Operand", A.getOperand())
+      .endObject();
+}
+
+auto JSONDump::visitImpl(const CallExprAST& A) -> Self& {
+  beginNode(A.NodeName).member("Callee", A.getCallee()).beginArray("Args");
+  for (const auto& Arg : A.getArgs()) {
+    element();
+    Parent::visit(*Arg);
+  }
+  return endArray().endObject();
+}
+
+auto JSONDump::visitImpl(const ForExprAST& A) -> Self& {
+  return beginNode(A.NodeName)
+      .member("VarName", A.getVarName())
+      .member("Start", A.getStart())
+      .member("End", A.getEnd())
+      .member("Step", A.getStep())
+      .member("Body", A.getBody())
+      .endObject();
+}
+
+auto JSONDump::visitImpl(const IfExprAST& A) -> Self& {
+  return beginNode(A.NodeName)
+      .member("Cond", A.getCond())
+      .member("Then", A.getThen())
+      .member("Else", A.getElse())
+      .endObject();
+}
+
+auto JSONDump::visitImpl(const NumberExprAST& A) -> Self& {
+  return beginNode(A.NodeName).member("Val", A.getVal()).endObject();
+}
+
+auto JSONDump::visitImpl(const VariableExprAST& A) -> Self& {
+  return beginNode(A.NodeName).member("Name", A.getName()).endObject();
+}
+
+auto JSONDump::visitImpl(const VarAssignExprAST& A) -> Self& {
+  beginNode(A.NodeName).beginArray("Vars");
+  for (const auto& [Name, Init] : A.getVarAs()) {
+    element().beginObject().member("Name", Name);
+    member("Init", *Init).endObject();
+  }
+  return endArray().member("Body", A.getBody()).endObject();
+}
+
+auto JSONDump::visitImpl(const FunctionAST& A) -> Self& {
+  return beginNode(A.NodeName)
+      .member("Proto", A.getProto())
+      .member("Body", A.getBody())
+      .endObject();
+}
+
+auto JSONDump::prototype(std::string_view Kind, const PrototypeAST& A)
+    -> Self& {
+  beginNode(Kind).member("Name", A.getName()).beginArray("Args");
+  for (Symbol Arg : A.getArgs()) element().writeString(Arg);
+  return endArray();
+}
+
+auto JSONDump::visitImpl(const PrototypeAST& A) -> Self& {
+  return prototype(A.NodeName, A).endObject();
+}
+
+auto JSONDump::visitImpl(const ProtoBinaryAST& A) -> Self& {
+  return prototype(A.NodeName, A)
+      .member("Operator", A.getOperator())
+      .member("Precedence", A.getPrecedence())
+      .endObject();
+}
+
+auto JSONDump::visitImpl(const ProtoUnaryAST& A) -> Self& {
+  return prototype(A.NodeName, A)
+      .member("Operator", A.getOperator())
+      .endObject();
+}
+
+auto JSONDump::visitImpl(const EndOfFileAST& A) -> Self& {
+  return beginNode(A.NodeName).endObject();
+}
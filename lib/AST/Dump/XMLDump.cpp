@@ -1,35 +1,74 @@
 #include "kaleidoscope/AST/Dump/XMLDump.h"
 
 #include <fmt/core.h>
-#include <fmt/ostream.h>
 
-#include <string>
+#include <cstddef>
+#include <string_view>
 
 using namespace kaleidoscope;
 using namespace kaleidoscope::ast;
 
-auto XMLDump::child(std::size_t MS) -> Self { return Self(Out, Spaces + MS); }
-
-auto XMLDump::padding(std::size_t MS) -> std::string {
-  return std::string(Spaces + MS, ' ');
-}
+namespace {
+
+/// writeEscaped - Writes Text with the characters XML gives meaning to
+/// replaced by entities.
+void writeEscaped(DumpStream& OS, std::string_view Text) {
+  std::size_t Start = 0;
+  for (std::size_t I = 0; I < Text.size(); ++I) {
+    std::string_view Entity;
+    switch (Text[I]) {
+    case '<': Entity = "&lt;"; break;
+    case '>': Entity = "&gt;"; break;
+    case '&': Entity = "&amp;"; break;
+    case '"': Entity = "&quot;"; break;
+    case '\'': Entity = "&apos;"; break;
+    default: continue;
+    }
+    OS.write(Text.substr(Start, I - Start)).write(Entity);
+    Start = I + 1;
+  }
+  OS.write(Text.substr(Start));
+}
+
+/// ArgTag - The tag of the argument at Idx, formatted without allocating.
+class ArgTag {
+  char        Buf[32];
+  std::size_t Size;
+
+ public:
+  explicit ArgTag(std::size_t Idx) noexcept
+      : Size(fmt::format_to_n(Buf, sizeof(Buf), "Arg[{}]", Idx).size) {}
+
+  operator std::string_view() const noexcept { return {Buf, Size}; }
+};
+
+} // namespace
 
 auto XMLDump::open(std::string_view S, const std::size_t MS) -> Self& {
-  fmt::print(Out, "{}<{}>\n", padding(MS), S);
+  OS.indent(Spaces + MS).write('<').write(S).write('>').endLine();
   return *this;
 }
 
 auto XMLDump::close(std::string_view S, const std::size_t MS) -> Self& {
-  fmt::print(Out, "{}</{}>\n", padding(MS), S);
+  OS.indent(Spaces + MS).write("</").write(S).write('>').endLine();
+  return *this;
+}
+
+auto XMLDump::printSubItem(
+    const std::string_view Tag, const std::string_view Text, std::size_t MS
+) -> Self& {
+  OS.indent(Spaces + 2 + MS).write('<').write(Tag).write('>');
+  writeEscaped(OS, Text);
+  OS.write("</").write(Tag).write('>').endLine();
   return *this;
 }
 
 template<typename T>
 auto XMLDump::printSubItem(
-    const std::string_view Tag, const T& Content, std::size_t MS
-) -> std::enable_if_t<fmt::is_formattable<T>::value, Self&> {
-  /// NOTE: if Content is '<', '>', '&', '"', or ''' then it is invalid XML
-  fmt::print(Out, "{}<{}>{}</{}>\n", padding(2 + MS), Tag, Content, Tag);
+    const std::string_view Tag, const T Content, std::size_t MS
+) -> std::enable_if_t<std::is_arithmetic_v<T>, Self&> {
+  OS.indent(Spaces + 2 + MS).write('<').write(Tag).write('>');
+  OS.print("{}", Content).write("</").write(Tag).write('>').endLine();
   return *this;
 }
 
@@ -37,9 +76,10 @@ auto XMLDump::printSubAST(
     std::string_view Tag, const ASTNode& A, std::size_t MS
 ) -> Self& {
   open(Tag, 2 + MS);
-  child(4 + MS).visit(A);
-  close(Tag, 2 + MS);
-  return *this;
+  Spaces += 4 + MS;
+  Parent::visit(A);
+  Spaces -= 4 + MS;
+  return close(Tag, 2 + MS);
 }
 
 auto XMLDump::visitImpl(const BinaryExprAST& A) -> Self& {
@@ -59,8 +99,8 @@ auto XMLDump::visitImpl(const UnaryExprAST& A) -> Self& {
 
 auto XMLDump::visitImpl(const CallExprAST& A) -> Self& {
   open(A.NodeName).printSubItem("Callee", A.getCallee()).open("Args", 2);
-  for (int Idx = 0; const auto& Arg : A.getArgs())
-    printSubAST(fmt::format("Arg[{}]", Idx++), *Arg, 2);
+  for (std::size_t Idx = 0; const auto& Arg : A.getArgs())
+    printSubAST(ArgTag(Idx++), *Arg, 2);
   return close("Args", 2).close(A.NodeName);
 }
 
@@ -92,7 +132,8 @@ auto XMLDump::visitImpl(const VariableExprAST& A) -> Self& {
 
 auto XMLDump::visitImpl(const VarAssignExprAST& A) -> XMLDump::Self& {
   open(A.NodeName).open("Vars", 2);
-  for (const auto& [Name, Init] : A.getVarAs()) printSubAST(Name, *Init, 2);
+  for (const auto& [Name, Init] : A.getVarAs())
+    printSubAST(Name.str(), *Init, 2);
   return close("Vars", 2).printSubAST("Body", A.getBody()).close(A.NodeName);
 }
 
@@ -105,20 +146,26 @@ auto XMLDump::visitImpl(const FunctionAST& A) -> Self& {
 
 auto XMLDump::visitImpl(const PrototypeAST& A) -> Self& {
   open(A.NodeName).printSubItem("Name", A.getName()).open("Args", 2);
-  for (int Idx = 0; const auto& Arg : A.getArgs())
-    printSubItem(fmt::format("Arg[{}]", Idx++), Arg, 2);
+  for (std::size_t Idx = 0; const auto& Arg : A.getArgs())
+    printSubItem(ArgTag(Idx++), Arg, 2);
   return close("Args", 2).close(A.NodeName);
 }
 
 auto XMLDump::visitImpl(const ProtoBinaryAST& A) -> Self& {
-  open(A.NodeName).child(2).visitImpl(llvm::cast<PrototypeAST>(A));
+  open(A.NodeName);
+  Spaces += 2;
+  visitImpl(llvm::cast<PrototypeAST>(A));
+  Spaces -= 2;
   return printSubItem("Operator", A.getOperator())
       .printSubItem("Precedence", A.getPrecedence())
       .close(A.NodeName);
 }
 
 auto XMLDump::visitImpl(const ProtoUnaryAST& A) -> Self& {
-  open(A.NodeName).child(2).visitImpl(llvm::cast<PrototypeAST>(A));
+  open(A.NodeName);
+  Spaces += 2;
+  visitImpl(llvm::cast<PrototypeAST>(A));
+  Spaces -= 2;
   return printSubItem("Operator", A.getOperator()).close(A.NodeName);
 }
 
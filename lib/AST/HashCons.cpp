@@ -0,0 +1,218 @@
+#include "kaleidoscope/AST/HashCons.h"
+
+#include "kaleidoscope/Util/Hashing.h"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <utility>
+
+using namespace kaleidoscope;
+using namespace kaleidoscope::ast;
+
+void HashCons::beginItem() {
+  Entries.clear();
+  Keys.clear();
+  ByHash.clear();
+  ByNode.clear();
+  Scope.clear();
+  NumBindings = 0;
+  NumVisited  = 0;
+  Ctx.beginItem();
+}
+
+auto HashCons::bindingOf(Symbol Name) const -> std::uint64_t {
+  for (const auto& [Var, Binding] : llvm::reverse(Scope))
+    if (Var == Name) return Binding;
+  return ~std::uint64_t{0};
+}
+
+void HashCons::endItem() {
+  // The item is done growing, so pointers to its nodes are now stable.
+  ByNode.reserve(static_cast<unsigned>(Entries.size()));
+  for (std::uint32_t Id = 0; const auto& E : Entries)
+    ByNode.try_emplace(Ctx.get(E.Node), Id++);
+}
+
+auto HashCons::intern(const FunctionAST& F) -> const FunctionAST* {
+  beginItem();
+  for (Symbol Arg : F.getProto().getArgs()) bind(Arg);
+  auto          Proto = Ctx.copy(F.getProto());
+  std::uint32_t Body  = visit(F.getBody());
+  const auto*   Res   = Ctx.get(
+      Ctx.create<FunctionAST>(Proto, node(Body), F.getLoc())
+  );
+  endItem();
+  return Res;
+}
+
+auto HashCons::intern(const ExprAST& E) -> const ExprAST* {
+  beginItem();
+  const ExprAST* Res = Ctx.get(node(visit(E)));
+  endItem();
+  return Res;
+}
+
+template<typename CreateT>
+auto HashCons::lookupOrCreate(
+    ASTNode::ASTNodeKind          Kind,
+    llvm::ArrayRef<std::uint64_t> Fields,
+    llvm::ArrayRef<std::uint32_t> Children,
+    CreateT&&                     Create
+) -> std::uint32_t {
+  ++NumVisited;
+  auto KeyBegin = static_cast<std::uint32_t>(Keys.size());
+  Keys.push_back(Kind);
+  Keys.insert(Keys.end(), Fields.begin(), Fields.end());
+  Keys.insert(Keys.end(), Children.begin(), Children.end());
+  auto KeyEnd = static_cast<std::uint32_t>(Keys.size());
+
+  // Hash the children's hashes rather than their entries, so the hash does
+  // not depend on what else is in the item.
+  llvm::SmallVector<std::uint64_t, 8> Words;
+  Words.push_back(Kind);
+  Words.append(Fields.begin(), Fields.end());
+  for (std::uint32_t Child : Children) Words.push_back(Entries[Child].Hash);
+  std::uint64_t Hash = hashKey(llvm::ArrayRef<std::uint64_t>(Words));
+
+  auto Id             = static_cast<std::uint32_t>(Entries.size());
+  auto [It, Inserted] = ByHash.try_emplace(Hash, Id);
+  if (!Inserted) {
+    Entry& Seen = Entries[It->second];
+    if (std::equal(
+            Keys.begin() + Seen.KeyBegin,
+            Keys.begin() + Seen.KeyEnd,
+            Keys.begin() + KeyBegin,
+            Keys.end()
+        )) {
+      Keys.resize(KeyBegin);
+      ++Seen.Occurrences;
+      return It->second;
+    }
+  }
+  Entries.push_back({Create(), Hash, KeyBegin, KeyEnd, 1});
+  return Id;
+}
+
+auto HashCons::visitImpl(const BinaryExprAST& A) -> std::uint32_t {
+  std::uint32_t LHS = visit(A.getLHS());
+  std::uint32_t RHS = visit(A.getRHS());
+  return lookupOrCreate(
+      A.Kind,
+      {static_cast<unsigned char>(A.getOp())},
+      {LHS, RHS},
+      [&] {
+        return Ctx.create<BinaryExprAST>(
+            A.getOp(), node(LHS), node(RHS), A.getLoc()
+        );
+      }
+  );
+}
+
+auto HashCons::visitImpl(const UnaryExprAST& A) -> std::uint32_t {
+  std::uint32_t Operand = visit(A.getOperand());
+  return lookupOrCreate(
+      A.Kind,
+      {static_cast<unsigned char>(A.getOpcode())},
+      {Operand},
+      [&] {
+        return Ctx.create<UnaryExprAST>(
+            A.getOpcode(), node(Operand), A.getLoc()
+        );
+      }
+  );
+}
+
+auto HashCons::visitImpl(const CallExprAST& A) -> std::uint32_t {
+  llvm::SmallVector<std::uint32_t, 8> Args;
+  for (const auto& Arg : A.getArgs()) Args.push_back(visit(*Arg));
+  return lookupOrCreate(
+      A.Kind, {A.getCallee().getOpaqueValue()}, Args, [&] {
+        llvm::SmallVector<ASTHandle<ExprAST>, 8> Nodes;
+        for (std::uint32_t Arg : Args) Nodes.push_back(node(Arg));
+        return Ctx.create<CallExprAST>(
+            A.getCallee(), Ctx.copyArray<ASTRef<ExprAST>>(Nodes), A.getLoc()
+        );
+      }
+  );
+}
+
+auto HashCons::visitImpl(const ForExprAST& A) -> std::uint32_t {
+  // The start is evaluated before the loop variable comes into scope.
+  std::uint32_t Start = visit(A.getStart());
+  bind(A.getVarName());
+  std::uint32_t End  = visit(A.getEnd());
+  std::uint32_t Step = visit(A.getStep());
+  std::uint32_t Body = visit(A.getBody());
+  Scope.pop_back();
+  return lookupOrCreate(
+      A.Kind,
+      {A.getVarName().getOpaqueValue()},
+      {Start, End, Step, Body},
+      [&] {
+        return Ctx.create<ForExprAST>(
+            A.getVarName(),
+            node(Start),
+            node(End),
+            node(Step),
+            node(Body),
+            A.getLoc()
+        );
+      }
+  );
+}
+
+auto HashCons::visitImpl(const IfExprAST& A) -> std::uint32_t {
+  std::uint32_t Cond = visit(A.getCond());
+  std::uint32_t Then = visit(A.getThen());
+  std::uint32_t Else = visit(A.getElse());
+  return lookupOrCreate(A.Kind, {}, {Cond, Then, Else}, [&] {
+    return Ctx.create<IfExprAST>(
+        node(Cond), node(Then), node(Else), A.getLoc()
+    );
+  });
+}
+
+auto HashCons::visitImpl(const NumberExprAST& A) -> std::uint32_t {
+  return lookupOrCreate(
+      A.Kind, {std::bit_cast<std::uint64_t>(A.getVal())}, {}, [&] {
+        return Ctx.create<NumberExprAST>(A.getVal(), A.getLoc());
+      }
+  );
+}
+
+auto HashCons::visitImpl(const VariableExprAST& A) -> std::uint32_t {
+  Symbol Name = A.getName();
+  return lookupOrCreate(
+      A.Kind, {Name.getOpaqueValue(), bindingOf(Name)}, {}, [&] {
+        return Ctx.create<VariableExprAST>(Name, A.getLoc());
+      }
+  );
+}
+
+auto HashCons::visitImpl(const VarAssignExprAST& A) -> std::uint32_t {
+  llvm::SmallVector<std::uint64_t, 4> Names;
+  llvm::SmallVector<std::uint32_t, 4> Children;
+  // Each initializer sees the variables bound before it.
+  std::size_t Outer = Scope.size();
+  for (const auto& [Name, Init] : A.getVarAs()) {
+    Names.push_back(Name.getOpaqueValue());
+    Children.push_back(visit(*Init));
+    bind(Name);
+  }
+  Children.push_back(visit(A.getBody()));
+  Scope.resize(Outer);
+  return lookupOrCreate(A.Kind, Names, Children, [&] {
+    llvm::SmallVector<std::pair<Symbol, ASTHandle<ExprAST>>, 4> VarAs;
+    for (auto [Var, Init] : llvm::zip(A.getVarAs(), Children))
+      VarAs.emplace_back(Var.first, node(Init));
+    return Ctx.create<VarAssignExprAST>(
+        Ctx.copyArray<VarAssignExprAST::VarAssignPair>(VarAs),
+        node(Children.back()),
+        A.getLoc()
+    );
+  });
+}
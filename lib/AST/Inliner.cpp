@@ -0,0 +1,189 @@
+#include "kaleidoscope/AST/Inliner.h"
+
+#include "kaleidoscope/AST/ASTTraversal.h"
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <fmt/compile.h>
+#include <fmt/core.h>
+
+#include <cstddef>
+#include <utility>
+
+using namespace kaleidoscope;
+using namespace kaleidoscope::ast;
+
+namespace {
+
+/// isBuiltin - Whether CodeGen emits the binary operator Op itself rather
+/// than calling a user definition.
+auto isBuiltin(char Op) -> bool {
+  switch (Op) {
+  case '=':
+  case ':':
+  case '+':
+  case '-':
+  case '*':
+  case '/':
+  case '<':
+  case '>': return true;
+  default: return false;
+  }
+}
+
+} // namespace
+
+auto Inliner::expand(const FunctionAST& F) -> const FunctionAST* {
+  NumInlined = 0;
+  Pending    = nullptr;
+  Ctx.beginItem();
+  Symbol Name     = F.getProto().getName();
+  Definition      = Name;
+  CallsDefinition = false;
+  auto Proto      = Ctx.copy(F.getProto());
+  auto Body       = visit(F.getBody());
+  Definition      = {};
+  const FunctionAST* Expanded =
+      Ctx.get(Ctx.create<FunctionAST>(Proto, Body, F.getLoc()));
+
+  // A redefinition is an error CodeGen reports, so keep the first one.
+  if (CallsDefinition || Callees.count(Name)) return Expanded;
+  NodeCounter Counter;
+  Counter.traverse(Expanded->getBody());
+  if (Counter.getCount() <= Threshold) Pending = Expanded;
+  return Expanded;
+}
+
+auto Inliner::expand(const ExprAST& E) -> const ExprAST* {
+  NumInlined = 0;
+  Pending    = nullptr;
+  Ctx.beginItem();
+  return Ctx.get(visit(E));
+}
+
+void Inliner::commit() {
+  if (Pending) keep(*Pending);
+  Pending = nullptr;
+}
+
+void Inliner::keep(const FunctionAST& F) {
+  Symbol Name = F.getProto().getName();
+  Out         = &Bodies;
+  Expand      = false;
+  Suffix      = Name;
+  Bodies.beginItem();
+  Callee C;
+  for (Symbol Param : F.getProto().getArgs()) C.Params.push_back(rename(Param));
+  C.Body = Bodies.get(visit(F.getBody()));
+  Out    = &Ctx;
+  Expand = true;
+  Suffix = {};
+  Callees.try_emplace(Name, std::move(C));
+}
+
+template<typename CopyT>
+auto Inliner::call(
+    Symbol                         Name,
+    llvm::ArrayRef<const ExprAST*> Args,
+    SourceLocation                 Loc,
+    CopyT&&                        Copy
+) -> ASTHandle<ExprAST> {
+  if (Name == Definition) CallsDefinition = true;
+  auto It = Expand ? Callees.find(Name) : Callees.end();
+  // A call with the wrong number of arguments is left for CodeGen to report.
+  if (It == Callees.end() || It->second.Params.size() != Args.size())
+    return Copy();
+
+  const Callee& C = It->second;
+  llvm::SmallVector<std::pair<Symbol, ASTHandle<ExprAST>>, 4> VarAs;
+  for (std::size_t I = 0; I < Args.size(); ++I)
+    VarAs.emplace_back(C.Params[I], visit(*Args[I]));
+  // The kept body is already expanded, so it is copied as it is.
+  Expand    = false;
+  auto Body = visit(*C.Body);
+  Expand    = true;
+  ++NumInlined;
+  if (VarAs.empty()) return Body;
+  return Out->create<VarAssignExprAST>(
+      Out->copyArray<VarAssignExprAST::VarAssignPair>(VarAs), Body, Loc
+  );
+}
+
+auto Inliner::rename(Symbol Name) const -> Symbol {
+  if (Suffix.empty()) return Name;
+  return Symbol::get(fmt::format(FMT_COMPILE("{}.{}"), Name, Suffix));
+}
+
+auto Inliner::visitImpl(const BinaryExprAST& A) -> ASTHandle<ExprAST> {
+  char Op   = A.getOp();
+  auto Copy = [&]() -> ASTHandle<ExprAST> {
+    auto L = visit(A.getLHS());
+    auto R = visit(A.getRHS());
+    return Out->create<BinaryExprAST>(Op, L, R, A.getLoc());
+  };
+  if (isBuiltin(Op)) return Copy();
+  return call(
+      ProtoBinaryAST::getFunctionName(Op),
+      {&A.getLHS(), &A.getRHS()},
+      A.getLoc(),
+      Copy
+  );
+}
+
+auto Inliner::visitImpl(const UnaryExprAST& A) -> ASTHandle<ExprAST> {
+  char Op = A.getOpcode();
+  auto Copy = [&]() -> ASTHandle<ExprAST> {
+    auto Operand = visit(A.getOperand());
+    return Out->create<UnaryExprAST>(Op, Operand, A.getLoc());
+  };
+  return call(
+      ProtoUnaryAST::getFunctionName(Op), {&A.getOperand()}, A.getLoc(), Copy
+  );
+}
+
+auto Inliner::visitImpl(const CallExprAST& A) -> ASTHandle<ExprAST> {
+  llvm::SmallVector<const ExprAST*, 8> Args;
+  for (const auto& Arg : A.getArgs()) Args.push_back(Arg.get());
+  return call(A.getCallee(), Args, A.getLoc(), [&] {
+    llvm::SmallVector<ASTHandle<ExprAST>, 8> Copies;
+    for (const ExprAST* Arg : Args) Copies.push_back(visit(*Arg));
+    return ASTHandle<ExprAST>(Out->create<CallExprAST>(
+        A.getCallee(), Out->copyArray<ASTRef<ExprAST>>(Copies), A.getLoc()
+    ));
+  });
+}
+
+auto Inliner::visitImpl(const ForExprAST& A) -> ASTHandle<ExprAST> {
+  auto Start = visit(A.getStart());
+  auto End   = visit(A.getEnd());
+  auto Step  = visit(A.getStep());
+  auto Body  = visit(A.getBody());
+  return Out->create<ForExprAST>(
+      rename(A.getVarName()), Start, End, Step, Body, A.getLoc()
+  );
+}
+
+auto Inliner::visitImpl(const IfExprAST& A) -> ASTHandle<ExprAST> {
+  auto Cond = visit(A.getCond());
+  auto Then = visit(A.getThen());
+  auto Else = visit(A.getElse());
+  return Out->create<IfExprAST>(Cond, Then, Else, A.getLoc());
+}
+
+auto Inliner::visitImpl(const NumberExprAST& A) -> ASTHandle<ExprAST> {
+  return Out->create<NumberExprAST>(A.getVal(), A.getLoc());
+}
+
+auto Inliner::visitImpl(const VariableExprAST& A) -> ASTHandle<ExprAST> {
+  return Out->create<VariableExprAST>(rename(A.getName()), A.getLoc());
+}
+
+auto Inliner::visitImpl(const VarAssignExprAST& A) -> ASTHandle<ExprAST> {
+  llvm::SmallVector<std::pair<Symbol, ASTHandle<ExprAST>>, 4> VarAs;
+  for (const auto& [Name, Init] : A.getVarAs())
+    VarAs.emplace_back(rename(Name), visit(*Init));
+  auto Body = visit(A.getBody());
+  return Out->create<VarAssignExprAST>(
+      Out->copyArray<VarAssignExprAST::VarAssignPair>(VarAs), Body, A.getLoc()
+  );
+}
@@ -0,0 +1,254 @@
+#include "kaleidoscope/AST/Serialize/ASTReader.h"
+
+#include "kaleidoscope/AST/Serialize/ASTFormat.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/LEB128.h>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <utility>
+
+using namespace kaleidoscope;
+using namespace kaleidoscope::ast;
+
+auto ASTReader::read(llvm::MemoryBufferRef Buf, ASTContext& Ctx)
+    -> llvm::Expected<std::vector<const ASTNode*>> {
+  ASTReader R{Ctx, Buf.getBuffer()};
+  auto      Items = R.readItems();
+  auto      Pos   = R.Cur - Buf.getBuffer().bytes_begin();
+  if (R.failed())
+    return llvm::createStringError(
+        llvm::inconvertibleErrorCode(),
+        fmt::format(
+            "{}: {} at byte {}",
+            Buf.getBufferIdentifier().str(),
+            R.Err,
+            Pos
+        )
+    );
+  return Items;
+}
+
+auto ASTReader::load(const llvm::Twine& Path, ASTContext& Ctx)
+    -> llvm::Expected<std::vector<const ASTNode*>> {
+  auto BufOrErr = llvm::MemoryBuffer::getFile(
+      Path, /*IsText=*/false, /*RequiresNullTerminator=*/false
+  );
+  if (!BufOrErr) return llvm::createFileError(Path, BufOrErr.getError());
+  return read(**BufOrErr, Ctx);
+}
+
+auto ASTReader::error(const char* Msg) -> std::nullptr_t {
+  if (Err.empty()) Err = Msg;
+  End = Cur;
+  return nullptr;
+}
+
+auto ASTReader::readItems() -> std::vector<const ASTNode*> {
+  std::vector<const ASTNode*> Items;
+  if (remaining() < format::Magic.size() + 4
+      || !std::equal(format::Magic.begin(), format::Magic.end(), Cur)) {
+    error("not a binary AST file");
+    return Items;
+  }
+  Cur += format::Magic.size();
+  std::uint32_t Version = llvm::support::endian::read32le(Cur);
+  if (Version != format::Version) {
+    error("unsupported binary AST version");
+    return Items;
+  }
+  Cur += 4;
+
+  Strings.resize(readCount());
+  for (Symbol& S : Strings) {
+    std::uint32_t Size = readCount();
+    if (failed()) return Items;
+    S    = Symbol::get({reinterpret_cast<const char*>(Cur), Size});
+    Cur += Size;
+  }
+
+  Items.resize(readCount());
+  for (const ASTNode*& Item : Items)
+    if (!(Item = readItem())) return Items;
+  if (remaining() != 0) error("unexpected data after the last item");
+  return Items;
+}
+
+auto ASTReader::readItem() -> const ASTNode* {
+  std::uint32_t NumRecords = readCount();
+  if (NumRecords == 0) return error("empty item");
+
+  Slots.clear();
+  Slots.resize(NumRecords);
+  Ctx.beginItem();
+  for (std::uint32_t Idx = 0; Idx < NumRecords; ++Idx) {
+    readRecord(Idx);
+    if (failed()) return nullptr;
+    if (Slots[Idx].Fn && Idx + 1 != NumRecords)
+      return error("function nested in an item");
+  }
+
+  const Slot& Root = Slots.back();
+  if (Root.Fn) return Ctx.get(Root.Fn);
+  if (Root.Proto) return Ctx.get(Root.Proto);
+  return Ctx.get(Root.Expr);
+}
+
+void ASTReader::readRecord(std::uint32_t Idx) {
+  Slot& S = Slots[Idx];
+  switch (static_cast<unsigned char>(readByte())) {
+  case BinaryExprAST::Kind: {
+    char Op  = readByte();
+    auto LHS = readExpr(Idx);
+    auto RHS = readExpr(Idx);
+    if (!failed()) S.Expr = Ctx.create<BinaryExprAST>(Op, LHS, RHS);
+    return;
+  }
+  case UnaryExprAST::Kind: {
+    char Op      = readByte();
+    auto Operand = readExpr(Idx);
+    if (!failed()) S.Expr = Ctx.create<UnaryExprAST>(Op, Operand);
+    return;
+  }
+  case CallExprAST::Kind: {
+    Symbol                                   Callee = readString();
+    llvm::SmallVector<ASTHandle<ExprAST>, 8> Args(readCount());
+    for (auto& Arg : Args) Arg = readExpr(Idx);
+    if (!failed())
+      S.Expr = Ctx.create<CallExprAST>(
+          Callee, Ctx.copyArray<ASTRef<ExprAST>>(Args)
+      );
+    return;
+  }
+  case ForExprAST::Kind: {
+    Symbol Var   = readString();
+    auto   Start = readExpr(Idx);
+    auto   End   = readExpr(Idx);
+    auto   Step  = readExpr(Idx);
+    auto   Body  = readExpr(Idx);
+    if (!failed())
+      S.Expr = Ctx.create<ForExprAST>(Var, Start, End, Step, Body);
+    return;
+  }
+  case IfExprAST::Kind: {
+    auto Cond = readExpr(Idx);
+    auto Then = readExpr(Idx);
+    auto Else = readExpr(Idx);
+    if (!failed()) S.Expr = Ctx.create<IfExprAST>(Cond, Then, Else);
+    return;
+  }
+  case NumberExprAST::Kind: {
+    double Val = readNumber();
+    if (!failed()) S.Expr = Ctx.create<NumberExprAST>(Val);
+    return;
+  }
+  case VariableExprAST::Kind: {
+    Symbol Name = readString();
+    if (!failed()) S.Expr = Ctx.create<VariableExprAST>(Name);
+    return;
+  }
+  case VarAssignExprAST::Kind: {
+    llvm::SmallVector<std::pair<Symbol, ASTHandle<ExprAST>>, 4> VarAs(
+        readCount()
+    );
+    for (auto& [Name, Init] : VarAs) {
+      Name = readString();
+      Init = readExpr(Idx);
+    }
+    auto Body = readExpr(Idx);
+    if (VarAs.empty()) error("var without variables");
+    if (!failed())
+      S.Expr = Ctx.create<VarAssignExprAST>(
+          Ctx.copyArray<VarAssignExprAST::VarAssignPair>(VarAs), Body
+      );
+    return;
+  }
+  case PrototypeAST::Kind: {
+    Symbol                       Name = readString();
+    llvm::SmallVector<Symbol, 8> Args(readCount());
+    for (Symbol& Arg : Args) Arg = readString();
+    if (!failed())
+      S.Proto = Ctx.create<PrototypeAST>(Name, Ctx.copyArray<Symbol>(Args));
+    return;
+  }
+  case ProtoBinaryAST::Kind: {
+    char          Op   = readByte();
+    Symbol        LHS  = readString();
+    Symbol        RHS  = readString();
+    std::uint64_t Prec = readULEB();
+    if (Prec > std::numeric_limits<int>::max())
+      error("precedence out of range");
+    if (!failed())
+      S.Proto = Ctx.create<ProtoBinaryAST>(
+          Op,
+          Ctx.copyArray<Symbol>(std::array{LHS, RHS}),
+          static_cast<int>(Prec)
+      );
+    return;
+  }
+  case ProtoUnaryAST::Kind: {
+    char   Op  = readByte();
+    Symbol Arg = readString();
+    if (!failed())
+      S.Proto = Ctx.create<ProtoUnaryAST>(
+          Op, Ctx.copyArray<Symbol>(std::array{Arg})
+      );
+    return;
+  }
+  case FunctionAST::Kind: {
+    std::uint64_t Back = readULEB();
+    auto          Body = readExpr(Idx);
+    if (Back == 0 || Back > Idx || !Slots[Idx - Back].Proto)
+      error("expected a reference to a prototype");
+    if (!failed())
+      S.Fn = Ctx.create<FunctionAST>(Slots[Idx - Back].Proto, Body);
+    return;
+  }
+  default: error("unknown record kind");
+  }
+}
+
+auto ASTReader::readPastEnd() -> char {
+  error("unexpected end of input");
+  return 0;
+}
+
+auto ASTReader::readLongULEB() -> std::uint64_t {
+  unsigned    Size = 0;
+  const char* Msg  = nullptr;
+  auto        V    = llvm::decodeULEB128(Cur, &Size, End, &Msg);
+  if (Msg) {
+    error(Msg);
+    return 0;
+  }
+  Cur += Size;
+  return V;
+}
+
+auto ASTReader::readCount() -> std::uint32_t {
+  // Everything counted takes at least a byte, which bounds any count.
+  std::uint64_t Count = readULEB();
+  if (Count > remaining()) {
+    error("count larger than the input");
+    return 0;
+  }
+  return static_cast<std::uint32_t>(Count);
+}
+
+auto ASTReader::readNumber() -> double {
+  std::uint64_t V = readULEB();
+  if ((V & 1) == 0) return static_cast<double>(V >> 1);
+  if (remaining() < 8) {
+    error("unexpected end of input");
+    return 0;
+  }
+  V    = llvm::support::endian::read64le(Cur);
+  Cur += 8;
+  return std::bit_cast<double>(V);
+}
@@ -0,0 +1,197 @@
+#include "kaleidoscope/AST/Serialize/ASTWriter.h"
+
+#include "kaleidoscope/AST/Serialize/ASTFormat.h"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/LEB128.h>
+
+#include <bit>
+#include <cmath>
+#include <iterator>
+
+using namespace kaleidoscope;
+using namespace kaleidoscope::ast;
+
+namespace {
+
+void appendULEB(llvm::SmallVectorImpl<char>& Buf, std::uint64_t V) {
+  std::uint8_t Bytes[16];
+  unsigned     Size = llvm::encodeULEB128(V, Bytes);
+  Buf.append(Bytes, Bytes + Size);
+}
+
+} // namespace
+
+void ASTWriter::add(const ASTNode& Item) {
+  Records.clear();
+  NumRecords = 0;
+  Indices.clear();
+  traverse(Item);
+  Finished.clear();
+
+  appendULEB(Items, NumRecords);
+  Items.append(Records.begin(), Records.end());
+  ++NumItems;
+}
+
+void ASTWriter::write(llvm::raw_ostream& OS) const {
+  llvm::SmallVector<char, 0> Header;
+  Header.append(format::Magic.begin(), format::Magic.end());
+  char Version[4];
+  llvm::support::endian::write32le(Version, format::Version);
+  Header.append(std::begin(Version), std::end(Version));
+
+  appendULEB(Header, Strings.size());
+  for (Symbol S : Strings) {
+    appendULEB(Header, S.str().size());
+    Header.append(S.str().begin(), S.str().end());
+  }
+  appendULEB(Header, NumItems);
+
+  OS.write(Header.data(), Header.size());
+  OS.write(Items.data(), Items.size());
+}
+
+auto ASTWriter::preVisit(const ASTNode& A) -> bool {
+  const auto* E = llvm::dyn_cast<ExprAST>(&A);
+  if (!E) return true;
+  auto It = Indices.find(E);
+  if (It == Indices.end()) return true;
+  Finished.push_back(It->second);
+  return false;
+}
+
+void ASTWriter::postVisit(const ASTNode& A) {
+  std::size_t NumChildren = 0;
+  forEachChild(A, [&](const ASTNode&) { ++NumChildren; });
+  Children = llvm::ArrayRef<std::uint32_t>(Finished).take_back(NumChildren);
+
+  std::uint32_t Idx = visit(A);
+  Finished.truncate(Finished.size() - NumChildren);
+  Finished.push_back(Idx);
+  if (const auto* E = llvm::dyn_cast<ExprAST>(&A)) Indices.try_emplace(E, Idx);
+}
+
+auto ASTWriter::beginRecord(ASTNode::ASTNodeKind K) -> std::uint32_t {
+  writeByte(static_cast<char>(K));
+  return NumRecords++;
+}
+
+void ASTWriter::writeULEB(std::uint64_t V) { appendULEB(Records, V); }
+
+void ASTWriter::writeNumber(double V) {
+  // Literals are mostly small whole numbers, which fit in a byte or two.
+  constexpr double MaxExact = 0x1p53;
+  if (V >= 0 && V < MaxExact && std::trunc(V) == V && !std::signbit(V)) {
+    writeULEB(static_cast<std::uint64_t>(V) << 1);
+    return;
+  }
+  writeULEB(1);
+  char Bits[8];
+  llvm::support::endian::write64le(Bits, std::bit_cast<std::uint64_t>(V));
+  Records.append(std::begin(Bits), std::end(Bits));
+}
+
+void ASTWriter::writeString(Symbol S) {
+  auto [It, Inserted] = StringIDs.try_emplace(
+      S, static_cast<std::uint32_t>(Strings.size())
+  );
+  if (Inserted) Strings.push_back(S);
+  writeULEB(It->second);
+}
+
+auto ASTWriter::visitImpl(const BinaryExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeByte(A.getOp());
+  writeRef(Idx, Children[0]);
+  writeRef(Idx, Children[1]);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const UnaryExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeByte(A.getOpcode());
+  writeRef(Idx, Children[0]);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const CallExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeString(A.getCallee());
+  writeULEB(Children.size());
+  for (std::uint32_t Arg : Children) writeRef(Idx, Arg);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const ForExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeString(A.getVarName());
+  for (std::uint32_t Child : Children) writeRef(Idx, Child);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const IfExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  for (std::uint32_t Child : Children) writeRef(Idx, Child);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const NumberExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeNumber(A.getVal());
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const VariableExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeString(A.getName());
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const VarAssignExprAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeULEB(A.getVarAs().size());
+  for (auto [Var, Init] : llvm::zip(A.getVarAs(), Children.drop_back())) {
+    writeString(Var.first);
+    writeRef(Idx, Init);
+  }
+  writeRef(Idx, Children.back());
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const FunctionAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeRef(Idx, Children[0]);
+  writeRef(Idx, Children[1]);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const PrototypeAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeString(A.getName());
+  writeULEB(A.getArgs().size());
+  for (Symbol Arg : A.getArgs()) writeString(Arg);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const ProtoBinaryAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeByte(A.getOperator());
+  writeString(A.getArgs()[0]);
+  writeString(A.getArgs()[1]);
+  writeULEB(static_cast<std::uint32_t>(A.getPrecedence()));
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const ProtoUnaryAST& A) -> std::uint32_t {
+  std::uint32_t Idx = beginRecord(A.Kind);
+  writeByte(A.getOperator());
+  writeString(A.getArgs()[0]);
+  return Idx;
+}
+
+auto ASTWriter::visitImpl(const EndOfFileAST&) -> std::uint32_t {
+  llvm_unreachable("the end of the input is not an item");
+}
@@ -5,20 +5,19 @@
 #include <llvm/ADT/ScopeExit.h>
 #include <llvm/IR/Verifier.h>
 
-#include <fmt/compile.h>
 #include <fmt/core.h>
 
-#include <ranges>
+#include <cstddef>
 
 using namespace kaleidoscope;
 
 auto CodeGen::genAssignment(const BinaryExprAST& A) -> llvm::Value* {
   auto* AV = llvm::dyn_cast<VariableExprAST>(&A.getLHS());
   if (!AV) return logError("for assignment the lhs must be a variable");
+  auto* L = getSlot(*AV);
+  if (!L) return logError("unknown variable on LHS of assignment");
   auto* R = visit(A.getRHS());
   if (!R) return logError("failed to codegen RHS");
-  auto* L = NamedValues[AV->getName()];
-  if (!L) return logError("unknown variable on LHS of assignment");
   CGS->Builder.CreateStore(R, L);
   return R;
 }
@@ -55,7 +54,7 @@ auto CodeGen::visitImpl(const BinaryExprAST& A) -> llvm::Value* {
   }
 
   llvm::Function* BinFun =
-      getFunction(fmt::format(FMT_COMPILE("binary{}"), A.getOp()));
+      getFunction(ProtoBinaryAST::getFunctionName(A.getOp()));
   if (!BinFun) return logError("Unknown binary operator referenced");
 
   return CGS->Builder.CreateCall(BinFun, {L, R}, "binoptmp");
@@ -66,7 +65,7 @@ auto CodeGen::visitImpl(const UnaryExprAST& A) -> llvm::Value* {
   if (!V) return logError("failed to codegen operand");
 
   llvm::Function* UnFun =
-      getFunction(fmt::format(FMT_COMPILE("unary{}"), A.getOpcode()));
+      getFunction(ProtoUnaryAST::getFunctionName(A.getOpcode()));
   if (!UnFun) return logError("Unknown binary operator referenced");
 
   return CGS->Builder.CreateCall(UnFun, {V}, "unoptmp");
@@ -78,12 +77,12 @@ auto CodeGen::visitImpl(const CallExprAST& A) -> llvm::Value* {
   if (!CalleeF) return logError("Unknown function referenced");
 
   // If argument mismatch error.
-  auto& Args = A.getArgs();
+  auto Args = A.getArgs();
   if (CalleeF->arg_size() != Args.size())
     return logError("Incorrect # arguments passed");
 
   std::vector<llvm::Value*> ArgsV;
-  for (auto& Arg : Args) {
+  for (const auto& Arg : Args) {
     auto* ArgV = visit(*Arg);
     if (!ArgV) return logError("Could not codegen arg");
     ArgsV.push_back(ArgV);
@@ -95,13 +94,13 @@ auto CodeGen::visitImpl(const CallExprAST& A) -> llvm::Value* {
 auto CodeGen::visitImpl(const ForExprAST& A) -> llvm::Value* {
   auto& Builder = CGS->Builder;
   auto& Context = *CGS->Context;
-  auto& VarName = A.getVarName();
+  Symbol VarName = A.getVarName();
 
   // Make the new basic block for the loop header, inserting after current block
   llvm::Function* Func = Builder.GetInsertBlock()->getParent();
 
   // Create an alloca for the variable in the entry block.
-  llvm::AllocaInst* VarAlloca = createEntryBlockAlloca(Func, VarName);
+  llvm::AllocaInst* VarAlloca = createEntryBlockAlloca(Func, VarName.str());
   // Emit the start code first, without 'variable' in scope
   llvm::Value* StartV = visit(A.getStart());
   if (!StartV) return nullptr;
@@ -114,9 +113,9 @@ auto CodeGen::visitImpl(const ForExprAST& A) -> llvm::Value* {
   // Start insertion in LoopBB
   Builder.SetInsertPoint(LoopBB);
 
-  // Within the loop, the variable is defined equal to the PHI node. If it
-  // shadows an existing variable, we have to restore it, so save it now
-  auto* OldV = std::exchange(NamedValues[VarName], VarAlloca);
+  // Within the loop, the variable is in scope in the slot after the ones
+  // before it
+  Slots.push_back(VarAlloca);
 
   // Emit the body of the loop. This can change the current BB. Note that the
   // value computed by the body is ignored but don't allow an error
@@ -132,8 +131,9 @@ auto CodeGen::visitImpl(const ForExprAST& A) -> llvm::Value* {
 
   // Reload, increment, and restore the alloca.  This handles the case where
   // the body of the loop mutates the variable.
-  llvm::Value* CurVar =
-      Builder.CreateLoad(VarAlloca->getAllocatedType(), VarAlloca, VarName);
+  llvm::Value* CurVar = Builder.CreateLoad(
+      VarAlloca->getAllocatedType(), VarAlloca, VarName.str()
+  );
   llvm::Value* NextVar = Builder.CreateFAdd(CurVar, StepVal, "nextvar");
   Builder.CreateStore(NextVar, VarAlloca);
 
@@ -150,7 +150,7 @@ auto CodeGen::visitImpl(const ForExprAST& A) -> llvm::Value* {
   // Any new code will be inserted in AfterBB
   Builder.SetInsertPoint(AfterBB);
 
-  NamedValues[VarName] = OldV;
+  Slots.pop_back();
 
   // for expr always returns 0.0
   return llvm::Constant::getNullValue(llvm::Type::getDoubleTy(Context));
@@ -213,33 +213,30 @@ auto CodeGen::visitImpl(const NumberExprAST& A) const -> llvm::Value* {
 }
 
 auto CodeGen::visitImpl(const VariableExprAST& A) -> llvm::Value* {
-  auto&             S = A.getName();
-  llvm::AllocaInst* V = NamedValues[S];
+  llvm::AllocaInst* V = getSlot(A);
   if (!V) return logError("unknown variable name");
-  return CGS->Builder.CreateLoad(V->getAllocatedType(), V, S);
+  return CGS->Builder.CreateLoad(V->getAllocatedType(), V, A.getName().str());
 }
 
 auto CodeGen::visitImpl(const VarAssignExprAST& A) -> llvm::Value* {
-  std::vector<std::pair<const std::string&, llvm::AllocaInst*>> NameSave{};
-  NameSave.reserve(A.getVarAs().size());
-  auto& Builder = CGS->Builder;
+  std::size_t Outer   = Slots.size();
+  auto&       Builder = CGS->Builder;
   auto* Func    = Builder.GetInsertBlock()->getParent();
-  for (auto& [Name, Expr] : A.getVarAs()) {
-    auto* Arg = createEntryBlockAlloca(Func, Name);
+  for (const auto& [Name, Expr] : A.getVarAs()) {
+    auto* Arg = createEntryBlockAlloca(Func, Name.str());
     auto* E   = visit(*Expr);
     if (!E)
       return logError(
           fmt::format("failed to codegen assignment for argument {}", Name)
       );
     Builder.CreateStore(E, Arg);
-    NameSave.emplace_back(Name, std::exchange(NamedValues[Name], Arg));
+    Slots.push_back(Arg);
   }
 
   auto* Body = visit(A.getBody());
   if (!Body) return logError("failed to codegen the expression in var");
 
-  for (auto& [Name, Alloc] : NameSave | std::views::reverse)
-    NamedValues[Name] = Alloc;
+  Slots.resize(Outer);
 
   return Body;
 }
@@ -250,8 +247,8 @@ auto CodeGen::visitImpl(const FunctionAST& A) -> llvm::Function* {
       && "function with name has already been compiled"
   );
 
-  // transfer ownership of the prototype to the FunctionProtos map
-  auto P = addPrototype(std::make_unique<PrototypeAST>(A.getProto()));
+  // copy the prototype into the FunctionProtos map, as A dies with its item
+  const auto& P = addPrototype(A.getProto());
   llvm::Function* TheFunction = getFunction(P.getName());
   if (!TheFunction) return nullptr;
 
@@ -259,7 +256,7 @@ auto CodeGen::visitImpl(const FunctionAST& A) -> llvm::Function* {
   if (PArgs.size() != TheFunction->arg_size())
     return logError("arg names do not match length in prototype");
   for (unsigned Idx = 0; auto& Arg : TheFunction->args())
-    if (Arg.getName() != PArgs[Idx++])
+    if (Arg.getName() != PArgs[Idx++].str())
       return logError("arg names do not match prototype");
   if (!TheFunction->empty()) return logError("Function cannot be redefined");
 
@@ -268,13 +265,14 @@ auto CodeGen::visitImpl(const FunctionAST& A) -> llvm::Function* {
       llvm::BasicBlock::Create(*CGS->Context, "entry", TheFunction);
   CGS->Builder.SetInsertPoint(BB);
 
-  // record the function arguments in the NamedValues map
-  auto Exit = llvm::make_scope_exit([&] { NamedValues.clear(); });
-  for (auto& Arg : TheFunction->args()) {
-    std::string Name      = Arg.getName().str();
-    auto*       ArgAlloca = createEntryBlockAlloca(TheFunction, Name);
+  // the function arguments take the first slots
+  NextRef   = 0;
+  auto Exit = llvm::make_scope_exit([&] { Slots.clear(); });
+  for (unsigned Idx = 0; auto& Arg : TheFunction->args()) {
+    Symbol Name      = PArgs[Idx++];
+    auto*  ArgAlloca = createEntryBlockAlloca(TheFunction, Name.str());
     CGS->Builder.CreateStore(&Arg, ArgAlloca);
-    NamedValues[Name] = ArgAlloca;
+    Slots.push_back(ArgAlloca);
   }
 
   if (llvm::Value* RetVal = visit(A.getBody())) {
@@ -290,7 +288,7 @@ auto CodeGen::visitImpl(const FunctionAST& A) -> llvm::Function* {
 }
 
 auto CodeGen::visitImpl(const PrototypeAST& A) const -> llvm::Function* {
-  auto&                    Args = A.getArgs();
+  auto                     Args = A.getArgs();
   std::vector<llvm::Type*> Doubles(
       Args.size(), llvm::Type::getDoubleTy(*CGS->Context)
   );
@@ -298,21 +296,21 @@ auto CodeGen::visitImpl(const PrototypeAST& A) const -> llvm::Function* {
       llvm::Type::getDoubleTy(*CGS->Context), Doubles, false
   );
   llvm::Function* F = llvm::Function::Create(
-      FT, llvm::Function::ExternalLinkage, A.getName(), CGS->Module.get()
+      FT, llvm::Function::ExternalLinkage, A.getName().str(), CGS->Module.get()
   );
 
-  for (unsigned Idx = 0; auto& Arg : F->args()) Arg.setName(Args[Idx++]);
+  for (unsigned Idx = 0; auto& Arg : F->args()) Arg.setName(Args[Idx++].str());
 
   return F;
 }
 
-auto CodeGen::getFunction(llvm::StringRef Name) const -> llvm::Function* {
+auto CodeGen::getFunction(Symbol Name) const -> llvm::Function* {
   // first, see if the function has already been added to the current module
-  if (auto* F = CGS->Module->getFunction(Name)) return F;
+  if (auto* F = CGS->Module->getFunction(Name.str())) return F;
 
   // if not, check whether we can codegen the declaration from some existing
   // prototype
-  if (auto FI = FunctionProtos.find(Name.str()); FI != FunctionProtos.end())
+  if (auto FI = FunctionProtos.find(Name); FI != FunctionProtos.end())
     return visitImpl(*FI->second);
 
   // if no existing prototype exists, return null
@@ -332,7 +330,7 @@ auto CodeGen::createEntryBlockAlloca(
 
 auto CodeGen::handleAnonExpr(const ExprAST& A) -> llvm::Function* {
   // make an anonymous proto
-  PrototypeAST    Proto("__anon_expr", std::vector<std::string>());
+  PrototypeAST    Proto(Symbol::get("__anon_expr"), {});
   llvm::Function* TheFunction = visit(Proto);
   if (!TheFunction) return nullptr;
 
@@ -341,6 +339,9 @@ auto CodeGen::handleAnonExpr(const ExprAST& A) -> llvm::Function* {
       llvm::BasicBlock::Create(*CGS->Context, "entry", TheFunction);
   CGS->Builder.SetInsertPoint(BB);
 
+  // a failed item can leave variables behind, so drop them once it is done
+  NextRef   = 0;
+  auto Exit = llvm::make_scope_exit([&] { Slots.clear(); });
   if (llvm::Value* RetVal = visit(A)) {
     CGS->Builder.CreateRet(RetVal); // Finish off the function
     llvm::verifyFunction(*TheFunction);
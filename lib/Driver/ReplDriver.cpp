@@ -57,9 +57,17 @@ static void generateObjFile(
   Pass.run(Mod);
 }
 
-ReplDriver::ReplDriver()
-    : Lex()
+ReplDriver::ReplDriver(std::unique_ptr<SourceBuffer> Source)
+    : Lex(std::move(Source))
     , Parse(Lex)
+    , ItemCtx()
+    , ParseDiags()
+    , InlineCtx()
+    , Inline(InlineCtx)
+    , FoldCtx()
+    , Fold(FoldCtx)
+    , Resolve()
+    , Slots()
     , CG()
     , JIT(ExitOnErr(KaleidoscopeJIT::create())) {
   {
@@ -75,6 +83,8 @@ ReplDriver::ReplDriver()
     );
   }
 
+  Parse.setDiagnostics(&ParseDiags);
+  CG.setSlots(&Slots);
   resetSession();
 }
 
@@ -86,9 +96,33 @@ auto ReplDriver::resetSession() -> std::unique_ptr<CodeGen::Session> {
   return LastCGSess;
 }
 
+template<typename T>
+auto ReplDriver::simplify(const T& A) -> const T& {
+  const T* Inlined = Inline.expand(A);
+  if (std::size_t N = Inline.getNumInlined())
+    fmt::print(stderr, "Inlined {} calls\n", N);
+  const T* Folded = Fold.fold(*Inlined);
+  if (std::size_t N = Fold.getNumEliminated())
+    fmt::print(stderr, "Constant folding eliminated {} nodes\n", N);
+  return *Folded;
+}
+
+template<typename T>
+auto ReplDriver::prepare(const T& A) -> const T* {
+  // This pass only reports errors, as simplifying can drop the code they are
+  // in; its slots are overwritten below by those of the tree CodeGen emits.
+  if (!Resolve.resolve(A, Slots)) return nullptr;
+  const T& Simplified = simplify(A);
+  if (!Resolve.resolve(Simplified, Slots)) return nullptr;
+  return &Simplified;
+}
+
 auto ReplDriver::visitImpl(const FunctionAST& A) -> VisitRet {
-  auto* FnIR = CG.visit(A);
+  const auto* Prepared = prepare(A);
+  if (!Prepared) return VisitRet::Error;
+  auto* FnIR = CG.visit(*Prepared);
   if (!FnIR) return VisitRet::Error;
+  Inline.commit();
 
   FPM->run(*FnIR);
   fmt::print(stderr, "Read function definition:\n");
@@ -96,7 +130,9 @@ auto ReplDriver::visitImpl(const FunctionAST& A) -> VisitRet {
   fmt::print(stderr, "\n");
   auto CGSess = resetSession();
 
-  generateObjFile(A.getProto().getName(), *TargetMachine, *CGSess->Module);
+  generateObjFile(
+      A.getProto().getName().str(), *TargetMachine, *CGSess->Module
+  );
 
   ExitOnErr(JIT->addModule(llvm::orc::ThreadSafeModule(
       std::move(CGSess->Module), std::move(CGSess->Context)
@@ -111,12 +147,14 @@ auto ReplDriver::visitImpl(const PrototypeAST& A) -> VisitRet {
   fmt::print(stderr, "Read extern:\n");
   llvm::errs() << *FnIR;
   fmt::print(stderr, "\n");
-  CG.addPrototype(std::make_unique<PrototypeAST>(A));
+  CG.addPrototype(A);
   return VisitRet::Success;
 }
 
 auto ReplDriver::visitImpl(const ExprAST& A) -> VisitRet {
-  auto* FnIR = CG.handleAnonExpr(A);
+  const auto* Prepared = prepare(A);
+  if (!Prepared) return VisitRet::Error;
+  auto* FnIR = CG.handleAnonExpr(*Prepared);
   if (!FnIR) return VisitRet::Error;
 
   FPM->run(*FnIR);
@@ -153,11 +191,20 @@ void ReplDriver::mainLoop() {
   while (true) {
     fmt::print(stderr, "ready> ");
 
-    std::unique_ptr<ASTNode> AST = Parse.parse();
-    if (!AST) {
-      fmt::print(stderr, "parse failed in driver\n");
-      continue;
-    }
+    // Release the previous item's nodes; anything that must outlive an item,
+    // like prototypes, is copied out by CodeGen.
+    ItemCtx.reset();
+    InlineCtx.reset();
+    FoldCtx.reset();
+    // Likewise the lines before the one the last item ended on.
+    SourceManager::get().releaseChunksBefore(Parse.getCurLoc());
+    const ASTNode* AST = Parse.parse(ItemCtx);
+
+    // The parser has skipped to the next item already, so report the errors
+    // and carry on.
+    for (const Diagnostic& D : ParseDiags) D.print();
+    ParseDiags.clear();
+    if (!AST) continue;
 
     switch (visit(*AST)) {
     case VisitRet::Success: break;
@@ -0,0 +1,202 @@
+#include "kaleidoscope/Lexer/CharScan.h"
+
+#include <llvm/Support/MathExtras.h>
+
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64)
+# define KALEIDOSCOPE_SCAN_SSE2 1
+# include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# define KALEIDOSCOPE_SCAN_AVX2 1
+# define KALEIDOSCOPE_TARGET_AVX2 __attribute__((target("avx2")))
+# include <immintrin.h>
+#endif
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// ----------------------------------------------------------------------------
+/// Scalar classifiers - the reference definitions of each character class
+/// ----------------------------------------------------------------------------
+
+auto isSpace(char C) -> bool {
+  auto U = static_cast<unsigned char>(C);
+  return U == ' ' || static_cast<unsigned char>(U - '\t') <= 4;
+}
+
+auto isEndOfLine(char C) -> bool { return C == '\n' || C == '\r'; }
+
+auto isIdentifier(char C) -> bool {
+  auto U = static_cast<unsigned char>(C);
+  return static_cast<unsigned char>((U | 0x20) - 'a') <= 25
+      || static_cast<unsigned char>(U - '0') <= 9 || U == '_';
+}
+
+/// scanScalar - Returns the first character for which InClass(C) == StopOn.
+template<bool (*InClass)(char), bool StopOn>
+auto scanScalar(const char* Begin, const char* End) -> const char* {
+  while (Begin != End && InClass(*Begin) != StopOn) ++Begin;
+  return Begin;
+}
+
+/// ----------------------------------------------------------------------------
+/// SSE2 - 16 characters per step. Unsigned range checks are done with the
+/// (X - Lo) <= (Hi - Lo) trick, using min_epu8 for the unsigned compare.
+/// ----------------------------------------------------------------------------
+
+#ifdef KALEIDOSCOPE_SCAN_SSE2
+
+auto inRangeSSE2(__m128i V, char Lo, char Width) -> __m128i {
+  __m128i X = _mm_sub_epi8(V, _mm_set1_epi8(Lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(X, _mm_set1_epi8(Width)), X);
+}
+
+auto spaceSSE2(__m128i V) -> __m128i {
+  return _mm_or_si128(
+      inRangeSSE2(V, '\t', 4), _mm_cmpeq_epi8(V, _mm_set1_epi8(' '))
+  );
+}
+
+auto endOfLineSSE2(__m128i V) -> __m128i {
+  return _mm_or_si128(
+      _mm_cmpeq_epi8(V, _mm_set1_epi8('\n')),
+      _mm_cmpeq_epi8(V, _mm_set1_epi8('\r'))
+  );
+}
+
+auto identifierSSE2(__m128i V) -> __m128i {
+  __m128i Alpha = inRangeSSE2(_mm_or_si128(V, _mm_set1_epi8(0x20)), 'a', 25);
+  __m128i Digit = inRangeSSE2(V, '0', 9);
+  __m128i Under = _mm_cmpeq_epi8(V, _mm_set1_epi8('_'));
+  return _mm_or_si128(_mm_or_si128(Alpha, Digit), Under);
+}
+
+template<__m128i (*Classify)(__m128i), bool (*InClass)(char), bool StopOn>
+auto scanSSE2(const char* Begin, const char* End) -> const char* {
+  for (; End - Begin >= 16; Begin += 16) {
+    __m128i V    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Begin));
+    auto    Mask = static_cast<std::uint32_t>(_mm_movemask_epi8(Classify(V)));
+    if (!StopOn) Mask = ~Mask & 0xFFFF;
+    if (Mask) return Begin + llvm::countTrailingZeros(Mask);
+  }
+  return scanScalar<InClass, StopOn>(Begin, End);
+}
+
+#endif // KALEIDOSCOPE_SCAN_SSE2
+
+/// ----------------------------------------------------------------------------
+/// AVX2 - 32 characters per step, compiled for AVX2 regardless of the target
+/// flags and only selected when the CPU reports support at runtime.
+/// ----------------------------------------------------------------------------
+
+#ifdef KALEIDOSCOPE_SCAN_AVX2
+
+KALEIDOSCOPE_TARGET_AVX2 auto inRangeAVX2(__m256i V, char Lo, char Width)
+    -> __m256i {
+  __m256i X = _mm256_sub_epi8(V, _mm256_set1_epi8(Lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(X, _mm256_set1_epi8(Width)), X);
+}
+
+KALEIDOSCOPE_TARGET_AVX2 auto spaceAVX2(__m256i V) -> __m256i {
+  return _mm256_or_si256(
+      inRangeAVX2(V, '\t', 4), _mm256_cmpeq_epi8(V, _mm256_set1_epi8(' '))
+  );
+}
+
+KALEIDOSCOPE_TARGET_AVX2 auto endOfLineAVX2(__m256i V) -> __m256i {
+  return _mm256_or_si256(
+      _mm256_cmpeq_epi8(V, _mm256_set1_epi8('\n')),
+      _mm256_cmpeq_epi8(V, _mm256_set1_epi8('\r'))
+  );
+}
+
+KALEIDOSCOPE_TARGET_AVX2 auto identifierAVX2(__m256i V) -> __m256i {
+  __m256i Alpha =
+      inRangeAVX2(_mm256_or_si256(V, _mm256_set1_epi8(0x20)), 'a', 25);
+  __m256i Digit = inRangeAVX2(V, '0', 9);
+  __m256i Under = _mm256_cmpeq_epi8(V, _mm256_set1_epi8('_'));
+  return _mm256_or_si256(_mm256_or_si256(Alpha, Digit), Under);
+}
+
+/// scanAVX2 - Tails shorter than 32 characters are finished with SSE2.
+template<
+    __m256i (*Classify)(__m256i),
+    __m128i (*Classify128)(__m128i),
+    bool (*InClass)(char),
+    bool StopOn>
+KALEIDOSCOPE_TARGET_AVX2 auto scanAVX2(const char* Begin, const char* End)
+    -> const char* {
+  for (; End - Begin >= 32; Begin += 32) {
+    __m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Begin));
+    auto Mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(Classify(V)));
+    if (!StopOn) Mask = ~Mask;
+    if (Mask) return Begin + llvm::countTrailingZeros(Mask);
+  }
+  return scanSSE2<Classify128, InClass, StopOn>(Begin, End);
+}
+
+#endif // KALEIDOSCOPE_SCAN_AVX2
+
+constexpr CharScanner ScalarScanner{
+    scanScalar<isSpace, false>,
+    scanScalar<isEndOfLine, true>,
+    scanScalar<isIdentifier, false>,
+};
+
+#ifdef KALEIDOSCOPE_SCAN_SSE2
+constexpr CharScanner SSE2Scanner{
+    scanSSE2<spaceSSE2, isSpace, false>,
+    scanSSE2<endOfLineSSE2, isEndOfLine, true>,
+    scanSSE2<identifierSSE2, isIdentifier, false>,
+};
+#endif
+
+#ifdef KALEIDOSCOPE_SCAN_AVX2
+constexpr CharScanner AVX2Scanner{
+    scanAVX2<spaceAVX2, spaceSSE2, isSpace, false>,
+    scanAVX2<endOfLineAVX2, endOfLineSSE2, isEndOfLine, true>,
+    scanAVX2<identifierAVX2, identifierSSE2, isIdentifier, false>,
+};
+#endif
+
+} // namespace
+
+auto CharScanner::isSupported(ScanISA ISA) -> bool {
+  switch (ISA) {
+  case ScanISA::Scalar: return true;
+#ifdef KALEIDOSCOPE_SCAN_SSE2
+  case ScanISA::SSE2: return true;
+#endif
+#ifdef KALEIDOSCOPE_SCAN_AVX2
+  case ScanISA::AVX2: return __builtin_cpu_supports("avx2");
+#endif
+  default: return false;
+  }
+}
+
+auto CharScanner::get(ScanISA ISA) -> const CharScanner& {
+  switch (ISA) {
+#ifdef KALEIDOSCOPE_SCAN_AVX2
+  case ScanISA::AVX2: return AVX2Scanner;
+#endif
+#ifdef KALEIDOSCOPE_SCAN_SSE2
+  case ScanISA::SSE2: return SSE2Scanner;
+#endif
+  default: return ScalarScanner;
+  }
+}
+
+auto CharScanner::getBest() -> const CharScanner& {
+  // The widest instruction set the CPU supports wins.
+  static const CharScanner& Best = []() -> const CharScanner& {
+    for (ScanISA ISA : {ScanISA::AVX2, ScanISA::SSE2})
+      if (isSupported(ISA)) return get(ISA);
+    return get(ScanISA::Scalar);
+  }();
+  return Best;
+}
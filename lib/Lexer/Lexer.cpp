@@ -1,65 +1,358 @@
 #include "kaleidoscope/Lexer/Lexer.h"
 
-#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
 
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <cstdio>
+#include <iterator>
+#include <string>
 #include <utility>
+#include <vector>
 
 using namespace kaleidoscope;
 
+namespace {
+
+constexpr std::size_t MinKeywordLen = 2, MaxKeywordLen = 6;
+
+/// packKeyword - Packs a string of at most 8 characters into an integer, zero
+/// padded. Identifiers never contain '\0', so equal packings mean equal
+/// strings of equal length.
+constexpr auto packKeyword(std::string_view S) noexcept -> std::uint64_t {
+  std::uint64_t V = 0;
+  for (std::size_t I = 0; I < S.size(); ++I)
+    V |= static_cast<std::uint64_t>(static_cast<unsigned char>(S[I])) << 8 * I;
+  return V;
+}
+
+/// keywordHash - Perfect hash of the keywords into 16 slots keyed on the
+/// length and the first two characters. Needs S.size() >= MinKeywordLen.
+constexpr auto keywordHash(std::string_view S) noexcept -> std::size_t {
+  return (4 * (S.size() + static_cast<unsigned char>(S[0]))
+          + static_cast<unsigned char>(S[1]))
+       & 15;
+}
+
+struct Keyword {
+  std::uint64_t Packed = 0;
+  Lexer::Token  Tok    = Lexer::tok_identifier;
+};
+
+/// KeywordTable - Built at compile time; a collision fails the build.
+constexpr auto KeywordTable = [] {
+  constexpr std::pair<std::string_view, Lexer::Token> Keywords[] = {
+      {"def", Lexer::tok_def},
+      {"extern", Lexer::tok_extern},
+      {"if", Lexer::tok_if},
+      {"then", Lexer::tok_then},
+      {"else", Lexer::tok_else},
+      {"for", Lexer::tok_for},
+      {"in", Lexer::tok_in},
+      {"binary", Lexer::tok_binary},
+      {"unary", Lexer::tok_unary},
+      {"var", Lexer::tok_var},
+  };
+
+  std::array<Keyword, 16> Table{};
+  for (auto [Text, Tok] : Keywords) {
+    if (Text.size() < MinKeywordLen || Text.size() > MaxKeywordLen)
+      throw "keyword length outside [MinKeywordLen, MaxKeywordLen]";
+    Keyword& Slot = Table[keywordHash(Text)];
+    if (Slot.Packed != 0) throw "keyword hash collision";
+    Slot = {packKeyword(Text), Tok};
+  }
+  return Table;
+}();
+
+} // namespace
+
+auto Lexer::classifyIdentifier(std::string_view S) noexcept -> Token {
+  if (S.size() < MinKeywordLen || S.size() > MaxKeywordLen)
+    return tok_identifier;
+  const Keyword& K = KeywordTable[keywordHash(S)];
+  return packKeyword(S) == K.Packed ? K.Tok : tok_identifier;
+}
+
+/// skipNumber - Number characters: [0-9.]. Literals are short, so this is not
+/// worth vectorising.
+static auto skipNumber(const char* Begin, const char* End) -> const char* {
+  return std::find_if_not(Begin, End, [](char C) {
+    return static_cast<unsigned char>(C - '0') <= 9 || C == '.';
+  });
+}
+
+Lexer::Lexer(std::unique_ptr<SourceBuffer> Source)
+    : Source(std::move(Source))
+    , BufferID(SourceManager::get().createBuffer(
+          std::string(this->Source->getName()), this->Source
+      )) {}
+
+Lexer::Lexer(std::string_view Piece, SourceLocation PieceLoc)
+    : Source(SourceBuffer::getMemBuffer(Piece))
+    , BufferID(NoBufferID)
+    , ChunkLoc(PieceLoc) {}
+
+auto Lexer::refill() -> bool {
+  SourceChunk Chunk = Source->getNextChunk();
+  if (Chunk.Text.empty()) return false;
+  ChunkBegin = BufCur = Chunk.Text.data();
+  BufEnd              = Chunk.Text.data() + Chunk.Text.size();
+  if (BufferID == NoBufferID) return true;
+  // The SourceManager keeps the chunk alive until its lines are released.
+  ChunkLoc = SourceManager::get().addChunk(BufferID, Chunk.Text, Chunk.Owner);
+  if (!ChunkLoc.isValid() && Chunk.Owner)
+    Unregistered.push_back(std::move(Chunk.Owner));
+  return true;
+}
+
+template<typename ScanFn>
+auto Lexer::consumeWhile(ScanFn ScanRun) -> std::string_view {
+  const char* Start = BufCur;
+  BufCur            = ScanRun(BufCur, BufEnd);
+  std::string_view Run(Start, static_cast<std::size_t>(BufCur - Start));
+  if (BufCur != BufEnd) return Run;
+
+  // The run reaches the end of the chunk and may continue into the next one.
+  std::string Spill(Run);
+  while (refill()) {
+    Start  = BufCur;
+    BufCur = ScanRun(BufCur, BufEnd);
+    Spill.append(Start, BufCur);
+    if (BufCur != BufEnd) break;
+  }
+  if (Spill.size() == Run.size()) return Run;
+  return llvm::StringSaver(SpillAlloc).save(Spill);
+}
+
 auto Lexer::handleIdentifier() -> int {
-  IdentifierStr = static_cast<char>(LastChar);
-  while (std::isalnum((LastChar = GetChar())) || LastChar == '_')
-    IdentifierStr += static_cast<char>(LastChar);
-
-  return llvm::StringSwitch<int>(IdentifierStr)
-      .Case("def", tok_def)
-      .Case("extern", tok_extern)
-      .Case("if", tok_if)
-      .Case("then", tok_then)
-      .Case("else", tok_else)
-      .Case("for", tok_for)
-      .Case("in", tok_in)
-      .Case("binary", tok_binary)
-      .Case("unary", tok_unary)
-      .Case("var", tok_var)
-      .Default(tok_identifier);
+  IdentifierStr = consumeWhile(Scan.SkipIdentifier);
+
+  Token Tok = classifyIdentifier(IdentifierStr);
+  if (Tok == tok_identifier) Identifier = Symbol::get(IdentifierStr);
+  return Tok;
+}
+
+/// parseShortNumber - Fast path for literals with at most 15 significant
+/// digits. The digits are exact in a double, as is the power of ten, so one
+/// correctly rounded division gives the correctly rounded value.
+static auto parseShortNumber(std::string_view S, double& Val) -> bool {
+  static constexpr std::array<double, 16> Pow10{
+      1e0, 1e1, 1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+      1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+  std::uint64_t Mantissa = 0;
+  std::size_t   Digits = 0, FracDigits = 0;
+  bool          SeenDot = false;
+  for (char C : S) {
+    if (C == '.') {
+      if (std::exchange(SeenDot, true)) return false;
+      continue;
+    }
+    if (++Digits >= Pow10.size()) return false;
+    Mantissa = Mantissa * 10 + static_cast<std::uint64_t>(C - '0');
+    if (SeenDot) ++FracDigits;
+  }
+  if (Digits == 0) return false;
+
+  Val = static_cast<double>(Mantissa) / Pow10[FracDigits];
+  return true;
 }
 
 auto Lexer::handleNumber() -> int {
-  std::string NumStr;
-  do {
-    NumStr += static_cast<char>(LastChar);
-    LastChar = GetChar();
-  } while (std::isdigit(LastChar) || LastChar == '.');
+  std::string_view NumStr = consumeWhile(skipNumber);
+
+  if (parseShortNumber(NumStr, NumVal)) return tok_number;
 
-  std::size_t Len;
-  NumVal = std::stod(NumStr, &Len);
-  if (Len != NumStr.length()) return tok_err;
+  const char* End = NumStr.data() + NumStr.size();
+  auto [Ptr, EC]  = std::from_chars(NumStr.data(), End, NumVal);
+  if (EC == std::errc() && Ptr == End) return tok_number;
 
-  return tok_number;
+  if (EC == std::errc::result_out_of_range)
+    LastError = {
+        TokLoc, fmt::format("number literal '{}' is out of range", NumStr)};
+  else
+    LastError = {
+        TokLoc.getLocWithOffset(static_cast<std::uint32_t>(Ptr - NumStr.data())
+        ),
+        fmt::format(
+            "malformed number literal '{}': unexpected '{}'", NumStr, *Ptr
+        )};
+  return tok_err;
 }
 
-auto Lexer::handleComment() -> int {
+void Lexer::skipComment() {
   // Comment until end of line.
-  LastChar = GetChar();
-  while (LastChar != EOF && LastChar != '\n' && LastChar != '\r')
-    LastChar = GetChar();
+  do BufCur = Scan.FindEndOfLine(BufCur, BufEnd);
+  while (BufCur == BufEnd && refill());
+}
 
-  if (LastChar == EOF) return tok_eof;
-  return gettok();
+auto Lexer::lexToken() -> int {
+  while (true) {
+    // Skip any whitespace.
+    do BufCur = Scan.SkipSpace(BufCur, BufEnd);
+    while (BufCur == BufEnd && refill());
+
+    int C  = peekChar();
+    TokLoc = getCurrentLoc();
+    if (std::isalpha(C) || C == '_') return handleIdentifier();
+    if (std::isdigit(C) || C == '.') return handleNumber();
+    if (C == '#') {
+      skipComment();
+      continue;
+    }
+    if (C == EOF) // Check for end of file. Don't eat the EOF.
+      return tok_eof;
+
+    // Otherwise, just return the character as its ascii value.
+    ++BufCur;
+    return C;
+  }
 }
 
 auto Lexer::gettok() -> int {
-  // Skip any whitespace.
-  while (std::isspace(LastChar)) LastChar = GetChar();
+  int Tok = lexToken();
+  if (Tok == tok_err) error(LastError.Loc, LastError.Message);
+  return Tok;
+}
+
+auto Lexer::lex(std::span<LexedToken> Out) -> std::size_t {
+  std::size_t N = 0;
+  while (N != Out.size())
+    if ((Out[N++] = lex()).Kind == tok_eof) break;
+  return N;
+}
+
+auto Lexer::tokenize() -> TokenStream {
+  TokenStream TS;
+  // Guess from the first chunk; programs average a token per four bytes or
+  // so, and the arrays still grow if the guess is short.
+  peekChar();
+  TS.reserve(static_cast<std::size_t>(BufEnd - BufCur) / 4 + 1);
+  while (true) {
+    int Tok = lexToken();
+    if (Tok == tok_identifier) {
+      TS.push(Tok, TokLoc, static_cast<std::uint32_t>(TS.Identifiers.size()));
+      TS.Identifiers.push_back(Identifier);
+    } else if (Tok == tok_number) {
+      TS.push(Tok, TokLoc, static_cast<std::uint32_t>(TS.Numbers.size()));
+      TS.Numbers.push_back(NumVal);
+    } else if (Tok == tok_err) {
+      TS.push(Tok, TokLoc, static_cast<std::uint32_t>(TS.Errors.size()));
+      TS.Errors.push_back(std::move(LastError));
+    } else TS.push(Tok, TokLoc);
+    if (Tok == tok_eof) return TS;
+  }
+}
+
+namespace {
+
+/// ParallelInput - Keeps the source of a parallel tokenization alive for the
+/// SourceManager, along with its only chunk, or the concatenation of its
+/// chunks if it produced more than one.
+struct ParallelInput {
+  std::shared_ptr<SourceBuffer> Source;
+  SourceChunk                   First{};
+  std::string                   Joined{};
+};
+
+/// MinPieceSize - Below this a piece is not worth handing to another thread.
+constexpr std::size_t MinPieceSize = 256 * 1024;
+
+} // namespace
+
+auto Lexer::tokenizeParallel(
+    std::unique_ptr<SourceBuffer> Source, unsigned NumThreads
+) -> TokenStream {
+  auto Input =
+      std::make_shared<ParallelInput>(ParallelInput{std::move(Source)});
+
+  // Pieces are slices of one contiguous text, so join the chunks of sources
+  // which produce several. Memory and file buffers are a single chunk.
+  Input->First          = Input->Source->getNextChunk();
+  std::string_view Text = Input->First.Text;
+  if (SourceChunk Next = Input->Source->getNextChunk(); !Next.Text.empty()) {
+    Input->Joined.assign(Text);
+    do Input->Joined.append(Next.Text);
+    while (!(Next = Input->Source->getNextChunk()).Text.empty());
+    Input->First = {};
+    Text         = Input->Joined;
+  }
+
+  std::string    Name(Input->Source->getName());
+  SourceManager& SM   = SourceManager::get();
+  SourceLocation Base = SM.addChunk(SM.createBuffer(Name, Input), Text);
+
+  // Cut the text just after the first '\n' past every Target bytes, aiming
+  // for a few pieces per thread to even out the load.
+  llvm::ThreadPoolStrategy Strategy = llvm::hardware_concurrency(NumThreads);
+  std::size_t              Target   = std::max(
+      MinPieceSize, Text.size() / (4 * Strategy.compute_thread_count()) + 1
+  );
+  std::vector<std::string_view> Pieces;
+  for (std::size_t Begin = 0; Begin != Text.size();) {
+    std::size_t End = Text.size();
+    if (Text.size() - Begin > Target)
+      if (std::size_t NL = Text.find('\n', Begin + Target); NL != End)
+        End = NL + 1;
+    Pieces.push_back(Text.substr(Begin, End - Begin));
+    Begin = End;
+  }
+
+  if (Pieces.size() <= 1) return Lexer(Text, Base).tokenize();
+
+  auto PieceLoc = [&](std::string_view Piece) {
+    return Base.getLocWithOffset(
+        static_cast<std::uint32_t>(Piece.data() - Text.data())
+    );
+  };
 
-  if (std::isalpha(LastChar) || LastChar == '_') return handleIdentifier();
-  if (std::isdigit(LastChar) || LastChar == '.') return handleNumber();
-  if (LastChar == '#') return handleComment();
-  if (LastChar == EOF) // Check for end of file. Don't eat the EOF.
-    return tok_eof;
+  std::vector<TokenStream> Results(Pieces.size());
+  {
+    llvm::ThreadPool Pool(Strategy);
+    for (std::size_t I = 0; I != Pieces.size(); ++I)
+      Pool.async([&, I] {
+        Results[I] = Lexer(Pieces[I], PieceLoc(Pieces[I])).tokenize();
+      });
+    Pool.wait();
+  }
 
-  // Otherwise, just return the character as its ascii value.
-  return std::exchange(LastChar, GetChar());
+  // Stitch the pieces together, dropping the tok_eof ending all but the last
+  // and rebasing payload indices.
+  std::size_t NumTokens = 0;
+  for (const TokenStream& R : Results) NumTokens += R.size();
+  TokenStream TS;
+  TS.reserve(NumTokens);
+  std::uint32_t IdentBase = 0, NumBase = 0, ErrBase = 0;
+  for (std::size_t I = 0; I != Results.size(); ++I) {
+    TokenStream& R = Results[I];
+    std::size_t  N = I + 1 == Results.size() ? R.size() : R.size() - 1;
+    for (std::size_t T = 0; T != N; ++T) {
+      std::uint32_t Payload = R.Payloads[T];
+      if (R.Kinds[T] == tok_identifier) Payload += IdentBase;
+      else if (R.Kinds[T] == tok_number) Payload += NumBase;
+      else if (R.Kinds[T] == tok_err) Payload += ErrBase;
+      TS.push(R.Kinds[T], R.Locs[T], Payload);
+    }
+    TS.Identifiers.insert(
+        TS.Identifiers.end(), R.Identifiers.begin(), R.Identifiers.end()
+    );
+    TS.Numbers.insert(TS.Numbers.end(), R.Numbers.begin(), R.Numbers.end());
+    TS.Errors.insert(
+        TS.Errors.end(),
+        std::make_move_iterator(R.Errors.begin()),
+        std::make_move_iterator(R.Errors.end())
+    );
+    IdentBase += static_cast<std::uint32_t>(R.Identifiers.size());
+    NumBase   += static_cast<std::uint32_t>(R.Numbers.size());
+    ErrBase   += static_cast<std::uint32_t>(R.Errors.size());
+  }
+  return TS;
 }
@@ -0,0 +1,148 @@
+#include "kaleidoscope/Lexer/SourceBuffer.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// MemorySourceBuffer - The whole input is already in memory, so it is handed
+/// out as a single chunk.
+class MemorySourceBuffer : public SourceBuffer {
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  bool                                Consumed = false;
+
+ public:
+  explicit MemorySourceBuffer(std::unique_ptr<llvm::MemoryBuffer> Buffer
+  ) noexcept
+      : Buffer(std::move(Buffer)) {}
+
+  auto getNextChunk() -> SourceChunk override {
+    if (std::exchange(Consumed, true)) return {};
+    return {{Buffer->getBufferStart(), Buffer->getBufferSize()}};
+  }
+
+  [[nodiscard]] auto getName() const -> std::string_view override {
+    llvm::StringRef Name = Buffer->getBufferIdentifier();
+    return {Name.data(), Name.size()};
+  }
+};
+
+/// ChunkedSourceBuffer - Base for sources which produce text incrementally.
+/// Each chunk is read into a scratch buffer and copied once into an
+/// allocation of its own, which the chunk's Owner frees when the last
+/// reference to it, usually the SourceManager's, is dropped.
+class ChunkedSourceBuffer : public SourceBuffer {
+  std::string Scratch{};
+  bool        Exhausted = false;
+
+ protected:
+  static constexpr std::size_t ChunkSize = 64 * 1024;
+
+  /// readChunk - Appends the next piece of input to Buf. Returns false once
+  /// the underlying input is exhausted and nothing was appended.
+  virtual auto readChunk(std::string& Buf) -> bool = 0;
+
+ public:
+  auto getNextChunk() -> SourceChunk override {
+    Scratch.clear();
+    while (!Exhausted && Scratch.empty()) Exhausted = !readChunk(Scratch);
+    if (Scratch.empty()) return {};
+    auto Text = std::make_shared<char[]>(Scratch.size());
+    std::copy(Scratch.begin(), Scratch.end(), Text.get());
+    return {{Text.get(), Scratch.size()}, std::move(Text)};
+  }
+};
+
+/// StdinSourceBuffer - Reads standard input as it arrives. Each read returns
+/// whatever is available, up to ChunkSize, so a line typed at a terminal or
+/// written to a pipe reaches the REPL without waiting for more input, while
+/// a redirected file is still read in large blocks.
+class StdinSourceBuffer : public ChunkedSourceBuffer {
+  const llvm::sys::fs::file_t In = llvm::sys::fs::convertFDToNativeFile(0);
+
+  auto readChunk(std::string& Buf) -> bool override {
+    Buf.resize(ChunkSize);
+    auto LenOrErr =
+        llvm::sys::fs::readNativeFile(In, {Buf.data(), Buf.size()});
+    std::size_t Len = 0;
+    if (LenOrErr) Len = *LenOrErr;
+    // A read error ends the input like EOF does.
+    else llvm::consumeError(LenOrErr.takeError());
+    Buf.resize(Len);
+    return Len != 0;
+  }
+
+ public:
+  [[nodiscard]] auto getName() const -> std::string_view override {
+    return "<stdin>";
+  }
+};
+
+/// CallbackSourceBuffer - Pulls characters from a callback until a newline,
+/// EOF or ChunkSize characters have been read. GetChar is never called again
+/// after it has returned EOF.
+class CallbackSourceBuffer : public ChunkedSourceBuffer {
+  std::function<int()> GetChar;
+  bool                 ReachedEOF = false;
+
+  auto readChunk(std::string& Buf) -> bool override {
+    while (!ReachedEOF && Buf.size() < ChunkSize) {
+      int C = GetChar();
+      if (C == EOF) ReachedEOF = true;
+      else if (Buf.push_back(static_cast<char>(C)); C == '\n') break;
+    }
+    return !Buf.empty();
+  }
+
+ public:
+  explicit CallbackSourceBuffer(std::function<int()> GetChar) noexcept
+      : GetChar(std::move(GetChar)) {}
+
+  [[nodiscard]] auto getName() const -> std::string_view override {
+    return "<callback>";
+  }
+};
+
+} // namespace
+
+auto SourceBuffer::getFile(llvm::StringRef Path)
+    -> llvm::ErrorOr<std::unique_ptr<SourceBuffer>> {
+  auto BufOrErr = llvm::MemoryBuffer::getFile(
+      Path, /*IsText=*/false, /*RequiresNullTerminator=*/false
+  );
+  if (!BufOrErr) return BufOrErr.getError();
+  return std::make_unique<MemorySourceBuffer>(std::move(*BufOrErr));
+}
+
+auto SourceBuffer::getMemBuffer(std::string_view Text)
+    -> std::unique_ptr<SourceBuffer> {
+  return std::make_unique<MemorySourceBuffer>(llvm::MemoryBuffer::getMemBuffer(
+      llvm::StringRef(Text.data(), Text.size()),
+      "<memory>",
+      /*RequiresNullTerminator=*/false
+  ));
+}
+
+auto SourceBuffer::getMemBufferCopy(std::string_view Text)
+    -> std::unique_ptr<SourceBuffer> {
+  return std::make_unique<MemorySourceBuffer>(
+      llvm::MemoryBuffer::getMemBufferCopy(
+          llvm::StringRef(Text.data(), Text.size()), "<memory>"
+      )
+  );
+}
+
+auto SourceBuffer::getSTDIN() -> std::unique_ptr<SourceBuffer> {
+  return std::make_unique<StdinSourceBuffer>();
+}
+
+auto SourceBuffer::getCallback(std::function<int()> GetChar)
+    -> std::unique_ptr<SourceBuffer> {
+  return std::make_unique<CallbackSourceBuffer>(std::move(GetChar));
+}
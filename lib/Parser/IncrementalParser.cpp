@@ -0,0 +1,111 @@
+#include "kaleidoscope/Parser/IncrementalParser.h"
+
+#include "kaleidoscope/Util/Hashing.h"
+
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <utility>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// appendBytes - Appends the object representation of V to Buf.
+template<typename T>
+void appendBytes(llvm::SmallVectorImpl<char>& Buf, const T& V) {
+  const auto* Bytes = reinterpret_cast<const char*>(&V);
+  Buf.append(Bytes, Bytes + sizeof(T));
+}
+
+} // namespace
+
+auto IncrementalParser::parse(const TokenStream& Tokens) -> ParsedModule {
+  ParsedModule                      M;
+  llvm::SmallPtrSet<ASTContext*, 8> Seen;
+  ASTContext*                       LastCtx = nullptr;
+  std::shared_ptr<ASTContext>       NewCtx;
+  llvm::SmallVector<char, 512>      Buf;
+  NumReused = NumParsed = 0;
+  ++Version;
+
+  auto HashOps = [&](const Parser::OperatorTable& Ops) {
+    Buf.clear();
+    appendBytes(Buf, Ops);
+    return hashKey(llvm::StringRef(Buf.data(), Buf.size()));
+  };
+
+  Parser::OperatorTable Ops        = Parser::DefaultOperators;
+  std::uint64_t         OpsHash    = HashOps(Ops);
+  bool                  Splittable = !Parser::definesSemicolon(Tokens);
+  std::size_t           Eof        = Tokens.size() - 1;
+
+  // use - Adds the items of R, which starts at Loc in this version, to the
+  // module and moves past it.
+  auto Use = [&](const Run& R, SourceLocation Loc) {
+    M.Items.insert(M.Items.end(), R.Items.begin(), R.Items.end());
+    M.LocOffsets.insert(
+        M.LocOffsets.end(), R.Items.size(), Loc.getRaw() - R.Loc.getRaw()
+    );
+    if (R.Ctx.get() != LastCtx && Seen.insert(R.Ctx.get()).second)
+      M.Contexts.push_back(R.Ctx);
+    LastCtx = R.Ctx.get();
+    if (R.EndOps) {
+      Ops     = *R.EndOps;
+      OpsHash = HashOps(Ops);
+    }
+  };
+
+  for (std::size_t Begin = 0, End;; Begin = End + 1) {
+    // Key the run on its tokens, up to the ';' ending it, and the operators
+    // before it. Token positions are taken relative to the first, so moving
+    // an item does not matter, and a reused one is moved by a single offset.
+    SourceLocation Loc = Tokens.getLoc(Begin);
+    Buf.clear();
+    appendBytes(Buf, OpsHash);
+    for (End = Begin;; ++End) {
+      auto Kind = static_cast<std::int16_t>(Tokens.getKind(End));
+      appendBytes(Buf, Kind);
+      appendBytes(Buf, Tokens.getLoc(End).getRaw() - Loc.getRaw());
+      if (Kind == Lexer::tok_identifier)
+        appendBytes(Buf, Tokens.getIdentifier(End).getOpaqueValue());
+      else if (Kind == Lexer::tok_number)
+        appendBytes(Buf, Tokens.getNumVal(End));
+      if (End == Eof || (Splittable && Kind == ';')) break;
+    }
+    llvm::StringRef Key(Buf.data(), Buf.size());
+    std::uint64_t   Hash = hashKey(Key);
+
+    auto It = Runs.find(Hash);
+    if (It != Runs.end() && It->second.Key == Key) {
+      It->second.LastVersion = Version;
+      ++NumReused;
+      Use(It->second, Loc);
+    } else {
+      if (!NewCtx) NewCtx = std::make_shared<ASTContext>();
+      Run Fresh{{}, nullptr, NewCtx, Loc, Version, Key.str()};
+      std::vector<Diagnostic> Diags;
+      Parser                  Parse{Tokens, Begin, Ops};
+      Parse.setDiagnostics(&Diags);
+      Parse.parseItems(*NewCtx, End, Fresh.Items);
+      if (Parse.Operators != Ops)
+        Fresh.EndOps =
+            std::make_unique<Parser::OperatorTable>(Parse.Operators);
+      ++NumParsed;
+
+      // Runs with errors are not kept, so that their diagnostics always
+      // point at the current text. Neither is a run whose hash another run
+      // already has.
+      M.Diags.insert(M.Diags.end(), Diags.begin(), Diags.end());
+      if (!Diags.empty() || It != Runs.end()) Use(Fresh, Loc);
+      else Use(Runs.try_emplace(Hash, std::move(Fresh)).first->second, Loc);
+    }
+
+    if (End == Eof) break;
+  }
+
+  // Forget the runs this version did without.
+  for (auto It = Runs.begin(), E = Runs.end(); It != E; ++It)
+    if (It->second.LastVersion != Version) Runs.erase(It);
+  return M;
+}
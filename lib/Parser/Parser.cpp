@@ -2,87 +2,123 @@
 
 #include "kaleidoscope/Util/Error/Log.h"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+
 using namespace kaleidoscope;
 
-static const std::unordered_map<char, int> DefaultBinOpPrec{
-    {':',  1},
-    {'=',  2},
-    {'<', 10},
-    {'>', 10},
-    {'+', 20},
-    {'-', 20},
-    {'*', 40},
-    {'/', 40}
-};
-
-auto Parser::getTokPrecedence(int Tok) const -> int {
-  if (!isascii(Tok)) return -1;
-  char C = static_cast<char>(Tok);
-  if (UserBinOpPrec.contains(C)) return UserBinOpPrec.at(C);
-  if (DefaultBinOpPrec.contains(C)) return DefaultBinOpPrec.at(C);
-  return -1;
+namespace {
+
+/// MinChunkTokens - Below this a run of items is not worth handing to another
+/// thread.
+constexpr std::size_t MinChunkTokens = 16 * 1024;
+
+} // namespace
+
+const Parser::OperatorTable Parser::DefaultOperators = [] {
+  // Filled explicitly: GCC 12 drops the default member initializers of
+  // value-initialized elements when it constant-folds `Ops{}`.
+  OperatorTable Ops;
+  Ops.fill({});
+  Ops[':'].BinaryPrec = 1;
+  Ops['='].BinaryPrec = 2;
+  Ops['<'].BinaryPrec = 10;
+  Ops['>'].BinaryPrec = 10;
+  Ops['+'].BinaryPrec = 20;
+  Ops['-'].BinaryPrec = 20;
+  Ops['*'].BinaryPrec = 40;
+  Ops['/'].BinaryPrec = 40;
+  return Ops;
+}();
+
+void Parser::fillAhead(std::size_t N) {
+  assert(N <= LookaheadSize && "lookahead past the end of the ring buffer");
+  while (AheadCount < N) {
+    // Lex into the free slots up to the physical end of the ring buffer, all
+    // of them when lexing ahead, otherwise just the ones needed.
+    std::size_t Tail = (AheadBegin + AheadCount) % LookaheadSize;
+    std::size_t Free =
+        std::min(LookaheadSize - AheadCount, LookaheadSize - Tail);
+    if (!LexAhead) Free = std::min(Free, N - AheadCount);
+    AheadCount += Lex->lex(std::span(Ahead).subspan(Tail, Free));
+  }
 }
 
-auto Parser::parseNumberExpr() -> std::unique_ptr<NumberExprAST> {
-  auto Res = std::make_unique<NumberExprAST>(Lex.getNumVal());
+auto Parser::parseNumberExpr() -> ASTHandle<NumberExprAST> {
+  auto Res = Ctx->create<NumberExprAST>(Cur.NumVal, Cur.Loc);
   getNextToken();
   return Res;
 }
 
-auto Parser::parseParenExpr() -> std::unique_ptr<ExprAST> {
+auto Parser::parseParenExpr() -> ASTHandle<ExprAST> {
   getNextToken(); // eat (
   auto V = parseExpression();
   if (!V) return nullptr;
-  if (CurTok != ')') return logError("expected ')'");
+  if (Cur.Kind != ')') return error(Cur.Loc, "expected ')'");
   getNextToken(); // eat )
   return V;
 }
 
-auto Parser::parseIdentifierOrCallExpr() -> std::unique_ptr<ExprAST> {
-  std::string IdName = Lex.getIdentifierStr();
+auto Parser::parseIdentifierOrCallExpr() -> ASTHandle<ExprAST> {
+  Symbol         IdName = Cur.Identifier;
+  SourceLocation IdLoc  = Cur.Loc;
   getNextToken(); // eat identifier
 
-  if (CurTok != '(') // simple variable ref
-    return std::make_unique<VariableExprAST>(std::move(IdName));
+  if (Cur.Kind != '(') // simple variable ref
+    return Ctx->create<VariableExprAST>(IdName, IdLoc);
 
   // call
   getNextToken(); // eat (
-  if (CurTok == ')') {
+  if (Cur.Kind == ')') {
     getNextToken(); // eat )
-    return std::make_unique<CallExprAST>(
-        std::move(IdName), std::vector<std::unique_ptr<ExprAST>>()
+    return Ctx->create<CallExprAST>(
+        IdName, ASTArrayHandle<ASTRef<ExprAST>>(), IdLoc
     );
   }
 
-  std::vector<std::unique_ptr<ExprAST>> Args;
+  llvm::SmallVector<ASTHandle<ExprAST>, 8> Args;
   while (true) {
-    if (auto Arg = parseExpression()) Args.push_back(std::move(Arg));
+    if (auto Arg = parseExpression()) Args.push_back(Arg);
     else return nullptr;
 
-    if (CurTok == ')') break;
+    if (Cur.Kind == ')') break;
 
-    if (CurTok != ',') return logError("Expected ')' or ',' in argument list");
+    if (Cur.Kind != ',')
+      return error(Cur.Loc, "Expected ')' or ',' in argument list");
     getNextToken();
   }
   getNextToken(); // eat )
-  return std::make_unique<CallExprAST>(std::move(IdName), std::move(Args));
+  return Ctx->create<CallExprAST>(
+      IdName, Ctx->copyArray<ASTRef<ExprAST>>(Args), IdLoc
+  );
 }
 
-auto Parser::parseUnaryExpr() -> std::unique_ptr<UnaryExprAST> {
-  if (!isascii(CurTok) || !UserUnaryOps.contains(static_cast<char>(CurTok)))
-    return logError("Unknown unary expression.");
+auto Parser::parseUnaryExpr() -> ASTHandle<UnaryExprAST> {
+  if (!isascii(Cur.Kind)
+      || !Operators[static_cast<std::size_t>(Cur.Kind)].IsUnary)
+    return error(Cur.Loc, "Unknown unary expression.");
 
-  char Opcode = static_cast<char>(CurTok);
+  char           Opcode = static_cast<char>(Cur.Kind);
+  SourceLocation OpLoc  = Cur.Loc;
   getNextToken(); // Eat the unary operator
 
   if (auto A = parseExpression())
-    return std::make_unique<UnaryExprAST>(Opcode, std::move(A));
+    return Ctx->create<UnaryExprAST>(Opcode, A, OpLoc);
 
-  return logError("Failed to parse operand expression for unary op");
+  return error(Cur.Loc, "Failed to parse operand expression for unary op");
 }
 
-auto Parser::parsePrimary() -> std::unique_ptr<ExprAST> {
-  switch (CurTok) {
+auto Parser::parsePrimary() -> ASTHandle<ExprAST> {
+  switch (Cur.Kind) {
   default: return parseUnaryExpr();
   case Lexer::tok_identifier: return parseIdentifierOrCallExpr();
   case Lexer::tok_number: return parseNumberExpr();
@@ -90,21 +126,23 @@ auto Parser::parsePrimary() -> std::unique_ptr<ExprAST> {
   case Lexer::tok_if: return parseIfExpr();
   case Lexer::tok_for: return parseForExpr();
   case Lexer::tok_var: return parseVarAssignExpr();
+  case Lexer::tok_err: return nullptr;
   }
 }
 
-auto Parser::parseBinOpRHS(int ExprPrec, std::unique_ptr<ExprAST> LHS)
-    -> std::unique_ptr<ExprAST> {
+auto Parser::parseBinOpRHS(int ExprPrec, ASTHandle<ExprAST> LHS)
+    -> ASTHandle<ExprAST> {
   // if this is a binop, find its precedence
-  while (CurTok != Lexer::tok_eof && CurTok != ';') {
-    int TokPrec = getTokPrecedence(CurTok);
+  while (Cur.Kind != Lexer::tok_eof && Cur.Kind != ';') {
+    int TokPrec = getTokPrecedence(Cur.Kind);
 
     // if this is a binop that binds at least as tightly as the current binop,
     // consume it, otherwise we are done
     if (TokPrec < ExprPrec) return LHS;
 
     // we know this is a binop
-    int BinOp = CurTok;
+    char           BinOp = static_cast<char>(Cur.Kind);
+    SourceLocation OpLoc = Cur.Loc;
     getNextToken(); // eat binop
 
     // parse the primary expression after the binary operator
@@ -113,221 +151,469 @@ auto Parser::parseBinOpRHS(int ExprPrec, std::unique_ptr<ExprAST> LHS)
 
     // if BinOp binds less tightly with RHS than the operator after RHS, let the
     // pending operator take RHS as its LHS
-    int NextPrec = getTokPrecedence(CurTok);
+    int NextPrec = getTokPrecedence(Cur.Kind);
     if (TokPrec < NextPrec
-        && (!(RHS = parseBinOpRHS(TokPrec + 1, std::move(RHS)))))
+        && (!(RHS = parseBinOpRHS(TokPrec + 1, RHS))))
       return nullptr;
 
     // merge LHS/RHS
-    LHS =
-        std::make_unique<BinaryExprAST>(BinOp, std::move(LHS), std::move(RHS));
+    LHS = Ctx->create<BinaryExprAST>(BinOp, LHS, RHS, OpLoc);
   } // loop around to top of the while loop
   return LHS;
 }
 
-auto Parser::parseIfExpr() -> std::unique_ptr<IfExprAST> {
+auto Parser::parseIfExpr() -> ASTHandle<IfExprAST> {
+  SourceLocation IfLoc = Cur.Loc;
   getNextToken(); // eat the "if"
 
   auto Cond = parseExpression();
   if (!Cond) return nullptr;
 
-  if (CurTok != Lexer::tok_then) return logError("expected \"then\" token");
+  if (Cur.Kind != Lexer::tok_then)
+    return error(Cur.Loc, "expected \"then\" token");
   getNextToken(); // eat the "then"
 
   auto Then = parseExpression();
   if (!Then) return nullptr;
 
-  if (CurTok != Lexer::tok_else) return logError("expected \"else\" token");
+  if (Cur.Kind != Lexer::tok_else)
+    return error(Cur.Loc, "expected \"else\" token");
   getNextToken(); // eat the "else"
 
   auto Else = parseExpression();
   if (!Else) return nullptr;
 
-  return std::make_unique<IfExprAST>(
-      std::move(Cond), std::move(Then), std::move(Else)
-  );
+  return Ctx->create<IfExprAST>(Cond, Then, Else, IfLoc);
 }
 
-auto Parser::parseForExpr() -> std::unique_ptr<ForExprAST> {
+auto Parser::parseForExpr() -> ASTHandle<ForExprAST> {
+  SourceLocation ForLoc = Cur.Loc;
   getNextToken(); // eat "for"
 
-  if (CurTok != Lexer::tok_identifier)
-    return logError("expected identifier after \"for\"");
-  std::string IdName = Lex.getIdentifierStr();
+  if (Cur.Kind != Lexer::tok_identifier)
+    return error(Cur.Loc, "expected identifier after \"for\"");
+  Symbol IdName = Cur.Identifier;
   getNextToken(); // eat identifier
 
-  if (CurTok != '=') return logError("expected '=' after \"for\"");
+  if (Cur.Kind != '=') return error(Cur.Loc, "expected '=' after \"for\"");
   getNextToken(); // eat '='
 
   auto Start = parseExpression();
   if (!Start) return nullptr;
-  if (CurTok != ',') return logError("expected ',' after for-loop start value");
+  if (Cur.Kind != ',')
+    return error(Cur.Loc, "expected ',' after for-loop start value");
   getNextToken(); // eat ','
 
   auto End = parseExpression();
   if (!End) return nullptr;
 
   // The step value is optional.
-  std::unique_ptr<ExprAST> Step;
-  if (CurTok == ',') {
+  ASTHandle<ExprAST> Step;
+  if (Cur.Kind == ',') {
     getNextToken(); // eat ','
     Step = parseExpression();
     if (!Step) return nullptr;
-  } else Step = std::make_unique<NumberExprAST>(1.0); // default to 1.0
+  } else Step = Ctx->create<NumberExprAST>(1.0, ForLoc); // default 1.0
 
-  if (CurTok != Lexer::tok_in) return logError("expected 'in' after for");
+  if (Cur.Kind != Lexer::tok_in)
+    return error(Cur.Loc, "expected 'in' after for");
   getNextToken(); // eat "in"
 
   auto Body = parseExpression();
   if (!Body) return nullptr;
 
-  return std::make_unique<ForExprAST>(
-      IdName, std::move(Start), std::move(End), std::move(Step), std::move(Body)
-  );
+  return Ctx->create<ForExprAST>(IdName, Start, End, Step, Body, ForLoc);
 }
 
-auto Parser::parseVarAssignExpr() -> std::unique_ptr<VarAssignExprAST> {
-  std::vector<VarAssignExprAST::VarAssignPair> VarAssigns{};
+auto Parser::parseVarAssignExpr() -> ASTHandle<VarAssignExprAST> {
+  SourceLocation VarLoc = Cur.Loc;
+  llvm::SmallVector<std::pair<Symbol, ASTHandle<ExprAST>>, 4> VarAssigns{};
   while (true) {
     if (getNextToken() != Lexer::tok_identifier)
-      return logError("expected identifier after \"var\"");
-    std::string IdName = Lex.getIdentifierStr();
+      return error(Cur.Loc, "expected identifier after \"var\"");
+    Symbol IdName = Cur.Identifier;
 
-    if (getNextToken() != '=') return logError("expected '=' after \"var\"");
+    if (getNextToken() != '=')
+      return error(Cur.Loc, "expected '=' after \"var\"");
     getNextToken(); // eat '='
 
     auto Right = parseExpression();
     if (!Right) return nullptr;
 
-    VarAssigns.emplace_back(std::move(IdName), std::move(Right));
+    VarAssigns.emplace_back(IdName, Right);
 
-    if (CurTok == Lexer::tok_in) break;
+    if (Cur.Kind == Lexer::tok_in) break;
 
-    if (CurTok != ',')
-      return logError("expected ',' or 'in' after var identifiers list");
+    if (Cur.Kind != ',')
+      return error(Cur.Loc, "expected ',' or 'in' after var identifiers list");
   }
   getNextToken(); // eat 'in'
 
   auto Expr = parseExpression();
-  if (!Expr) return logError("failed to parse expression for \"var\"");
+  if (!Expr) return error(Cur.Loc, "failed to parse expression for \"var\"");
 
-  return std::make_unique<VarAssignExprAST>(
-      std::move(VarAssigns), std::move(Expr)
+  return Ctx->create<VarAssignExprAST>(
+      Ctx->copyArray<VarAssignExprAST::VarAssignPair>(VarAssigns), Expr, VarLoc
   );
 }
 
-auto Parser::parseExpression() -> std::unique_ptr<ExprAST> {
+auto Parser::parseExpression() -> ASTHandle<ExprAST> {
+  if (IterativeExprs) return parseExpressionIterative();
   auto LHS = parsePrimary();
   if (!LHS) return nullptr;
-  return parseBinOpRHS(0, std::move(LHS));
+  return parseBinOpRHS(0, LHS);
 }
 
-auto Parser::parseProtoBinary() -> std::unique_ptr<ProtoBinaryAST> {
-  if (!isascii(getNextToken())) return logError("Expected binary operator");
-  char Op = static_cast<char>(CurTok);
+auto Parser::parseExpressionIterative() -> ASTHandle<ExprAST> {
+  /// Frame - An expression still being parsed: the whole one, one inside
+  /// parentheses, or the operand of a unary operator. Its pending binary
+  /// operators are those on Ops from index FirstOp up.
+  struct Frame {
+    enum class FrameKind { Top, Paren, Unary } Kind;
+    std::size_t    FirstOp;
+    char           Opcode = 0;
+    SourceLocation OpLoc{};
+  };
+
+  struct PendingOp {
+    char           Op;
+    int            Prec;
+    SourceLocation Loc;
+  };
+
+  using FrameKind = Frame::FrameKind;
+  llvm::SmallVector<Frame, 8>                Frames{{FrameKind::Top, 0}};
+  llvm::SmallVector<ASTHandle<ExprAST>, 16> Operands{};
+  llvm::SmallVector<PendingOp, 16>          Ops{};
+
+  // reduce - Merges the top two operands with the top operator.
+  auto Reduce = [&] {
+    PendingOp Op  = Ops.pop_back_val();
+    auto      RHS = Operands.pop_back_val();
+    Operands.back() =
+        Ctx->create<BinaryExprAST>(Op.Op, Operands.back(), RHS, Op.Loc);
+  };
+
+  // fail - Unwinds the open frames, reporting them as the recursive parser
+  // would on its way out.
+  auto Fail = [&]() -> ASTHandle<ExprAST> {
+    for (const Frame& F : llvm::reverse(Frames))
+      if (F.Kind == FrameKind::Unary)
+        error(Cur.Loc, "Failed to parse operand expression for unary op");
+    return nullptr;
+  };
+
+  while (true) {
+    // open any parentheses and unary operators in front of the next primary
+    if (Cur.Kind == '(') {
+      getNextToken(); // eat (
+      Frames.push_back({FrameKind::Paren, Ops.size()});
+      continue;
+    }
+    if (isascii(Cur.Kind)
+        && Operators[static_cast<std::size_t>(Cur.Kind)].IsUnary) {
+      Frames.push_back(
+          {FrameKind::Unary, Ops.size(), static_cast<char>(Cur.Kind), Cur.Loc}
+      );
+      getNextToken(); // Eat the unary operator
+      continue;
+    }
+
+    auto Primary = parsePrimary();
+    if (!Primary) return Fail();
+    Operands.push_back(Primary);
+
+    // fold binary operators, and close frames, until one wants a new primary
+    while (true) {
+      int TokPrec = getTokPrecedence(Cur.Kind);
+      if (Cur.Kind != Lexer::tok_eof && Cur.Kind != ';' && TokPrec >= 0) {
+        // operators binding at least as tightly to the left take LHS first
+        while (Ops.size() > Frames.back().FirstOp && Ops.back().Prec >= TokPrec)
+          Reduce();
+        Ops.push_back({static_cast<char>(Cur.Kind), TokPrec, Cur.Loc});
+        getNextToken(); // eat binop
+        break;
+      }
+
+      // the innermost open expression ends here
+      while (Ops.size() > Frames.back().FirstOp) Reduce();
+      Frame F = Frames.pop_back_val();
+      switch (F.Kind) {
+      case FrameKind::Top: return Operands.pop_back_val();
+      case FrameKind::Paren:
+        if (Cur.Kind != ')') {
+          error(Cur.Loc, "expected ')'");
+          return Fail();
+        }
+        getNextToken(); // eat )
+        break;
+      case FrameKind::Unary:
+        Operands.back() =
+            Ctx->create<UnaryExprAST>(F.Opcode, Operands.back(), F.OpLoc);
+        break;
+      }
+    }
+  }
+}
+
+auto Parser::parseProtoBinary() -> ASTHandle<ProtoBinaryAST> {
+  SourceLocation BinaryLoc = Cur.Loc;
+  if (!isascii(getNextToken()))
+    return error(Cur.Loc, "Expected binary operator");
+  char Op = static_cast<char>(Cur.Kind);
 
   if (getNextToken() != Lexer::tok_number)
-    return logError("Binary prototype requires precedence number");
+    return error(Cur.Loc, "Binary prototype requires precedence number");
 
-  if (double V = Lex.getNumVal(); V < 1 || V > 100)
-    return logError("Precedence should be in range [1,100]");
-  int Prec = static_cast<int>(Lex.getNumVal());
+  if (double V = Cur.NumVal; V < 1 || V > 100)
+    return error(Cur.Loc, "Precedence should be in range [1,100]");
+  int Prec = static_cast<int>(Cur.NumVal);
 
   if (getNextToken() != '(')
-    return logError("expected '(' in binary prototype");
+    return error(Cur.Loc, "expected '(' in binary prototype");
 
   if (getNextToken() != Lexer::tok_identifier)
-    return logError(
+    return error(
+        Cur.Loc,
         "Expecting left side identifier in binary operator parameter list"
     );
-  std::string LHS = Lex.getIdentifierStr();
+  Symbol LHS = Cur.Identifier;
 
   if (getNextToken() != Lexer::tok_identifier)
-    return logError(
+    return error(
+        Cur.Loc,
         "Expecting right side identifier in binary operator parameter list"
     );
-  std::string RHS = Lex.getIdentifierStr();
+  Symbol RHS = Cur.Identifier;
 
   if (getNextToken() != ')')
-    return logError("expected ')' in binary prototype");
+    return error(Cur.Loc, "expected ')' in binary prototype");
   getNextToken(); // eat )
 
   // Install the new operator once the prototype is successfully parsed
-  UserBinOpPrec[Op] = Prec;
+  Operators[static_cast<std::size_t>(Op)].BinaryPrec =
+      static_cast<std::int8_t>(Prec);
 
-  return std::make_unique<ProtoBinaryAST>(
-      Op, std::array{std::move(LHS), std::move(RHS)}, Prec
+  return Ctx->create<ProtoBinaryAST>(
+      Op, Ctx->copyArray<Symbol>(std::array{LHS, RHS}), Prec, BinaryLoc
   );
 }
 
-auto Parser::parseProtoUnary() -> std::unique_ptr<ProtoUnaryAST> {
-  if (!isascii(getNextToken())) return logError("Expected unary operator");
-  char Op = static_cast<char>(CurTok);
+auto Parser::parseProtoUnary() -> ASTHandle<ProtoUnaryAST> {
+  SourceLocation UnaryLoc = Cur.Loc;
+  if (!isascii(getNextToken()))
+    return error(Cur.Loc, "Expected unary operator");
+  char Op = static_cast<char>(Cur.Kind);
 
-  if (getNextToken() != '(') return logError("expected '(' in unary prototype");
+  if (getNextToken() != '(')
+    return error(Cur.Loc, "expected '(' in unary prototype");
 
   if (getNextToken() != Lexer::tok_identifier)
-    return logError(
-        "Expecting single identifier in unary operator parameter list"
+    return error(
+        Cur.Loc, "Expecting single identifier in unary operator parameter list"
     );
-  std::string Arg = Lex.getIdentifierStr();
+  Symbol Arg = Cur.Identifier;
 
-  if (getNextToken() != ')') return logError("expected ')' in unary prototype");
+  if (getNextToken() != ')')
+    return error(Cur.Loc, "expected ')' in unary prototype");
   getNextToken(); // eat )
 
   // Install the new operator once the prototype is successfully parsed
-  UserUnaryOps.insert(Op);
+  Operators[static_cast<std::size_t>(Op)].IsUnary = true;
 
-  return std::make_unique<ProtoUnaryAST>(Op, std::array{std::move(Arg)});
+  return Ctx->create<ProtoUnaryAST>(
+      Op, Ctx->copyArray<Symbol>(std::array{Arg}), UnaryLoc
+  );
 }
 
-auto Parser::parsePrototype() -> std::unique_ptr<PrototypeAST> {
-  switch (CurTok) {
-  default: return logError("expected function name or operator in prototype");
+auto Parser::parsePrototype() -> ASTHandle<PrototypeAST> {
+  switch (Cur.Kind) {
+  default:
+    return error(Cur.Loc, "expected function name or operator in prototype");
   case Lexer::tok_binary: return parseProtoBinary();
   case Lexer::tok_unary: return parseProtoUnary();
   case Lexer::tok_identifier: break; // Keep doing the default behavior
   }
 
-  std::string FnName = Lex.getIdentifierStr();
+  Symbol         FnName = Cur.Identifier;
+  SourceLocation FnLoc  = Cur.Loc;
   getNextToken();
 
-  if (CurTok != '(') return logError("expected '(' in prototype");
+  if (Cur.Kind != '(') return error(Cur.Loc, "expected '(' in prototype");
 
   // read the list of argument names
-  std::vector<std::string> ArgNames;
+  llvm::SmallVector<Symbol, 8> ArgNames;
   while (getNextToken() == Lexer::tok_identifier)
-    ArgNames.push_back(Lex.getIdentifierStr());
-  if (CurTok != ')') return logError("expected ')' in prototype");
+    ArgNames.push_back(Cur.Identifier);
+  if (Cur.Kind != ')') return error(Cur.Loc, "expected ')' in prototype");
 
   getNextToken(); // eat )
-  return std::make_unique<PrototypeAST>(std::move(FnName), std::move(ArgNames));
+  return Ctx->create<PrototypeAST>(
+      FnName, Ctx->copyArray<Symbol>(ArgNames), FnLoc
+  );
 }
 
-auto Parser::parseDefinition() -> std::unique_ptr<FunctionAST> {
+auto Parser::parseDefinition() -> ASTHandle<FunctionAST> {
+  SourceLocation DefLoc = Cur.Loc;
   getNextToken(); // eat def
   auto Proto = parsePrototype();
   if (!Proto) return nullptr;
   auto E = parseExpression();
   if (!E) return nullptr;
-  if (CurTok != ';') return nullptr;
-  return std::make_unique<FunctionAST>(std::move(Proto), std::move(E));
+  if (Cur.Kind != ';') return error(Cur.Loc, "expected ; at end of definition");
+  return Ctx->create<FunctionAST>(Proto, E, DefLoc);
 }
 
-auto Parser::parseExtern() -> std::unique_ptr<PrototypeAST> {
+auto Parser::parseExtern() -> ASTHandle<PrototypeAST> {
   getNextToken(); // eat extern
   auto P = parsePrototype();
-  if (!P) return logError("failed to parse prototype for extern");
-  if (CurTok != ';') return logError("expected ; at end of extern declaration");
+  if (!P) return error(Cur.Loc, "failed to parse prototype for extern");
+  if (Cur.Kind != ';')
+    return error(Cur.Loc, "expected ; at end of extern declaration");
   return P;
 }
 
-auto Parser::parse() -> std::unique_ptr<ASTNode> {
-  switch (getNextToken()) {
-  case ';': return logError("given semicolon where expression should start");
-  case Lexer::tok_eof: return std::make_unique<EndOfFileAST>();
+void Parser::synchronize() {
+  while (Cur.Kind != ';' && Cur.Kind != Lexer::tok_eof) {
+    if (Cur.Kind == Lexer::tok_def || Cur.Kind == Lexer::tok_extern) {
+      HoldCur = true;
+      return;
+    }
+    getNextToken();
+  }
+}
+
+auto Parser::parseTopLevel() -> ASTHandle<ASTNode> {
+  int Tok = HoldCur ? Cur.Kind : getNextToken();
+  HoldCur = false;
+  switch (Tok) {
+  case ';':
+    return error(Cur.Loc, "given semicolon where expression should start");
+  case Lexer::tok_eof: return Ctx->create<EndOfFileAST>(Cur.Loc);
   case Lexer::tok_def: return parseDefinition();
   case Lexer::tok_extern: return parseExtern();
   default: return parseExpression();
   }
 }
+
+auto Parser::parse(ASTContext& C) -> const ASTNode* {
+  Ctx = &C;
+  Ctx->beginItem();
+  const ASTNode* Item = Ctx->get(parseTopLevel());
+  if (!Item) synchronize();
+  return Item;
+}
+
+void Parser::parseItems(
+    ASTContext&                            C,
+    std::size_t                            End,
+    llvm::SmallVectorImpl<const ASTNode*>& Items
+) {
+  while (true) {
+    const ASTNode* Item = parse(C);
+    if (Item && llvm::isa<EndOfFileAST>(Item)) return;
+    Items.push_back(Item);
+    if (NextTok > End) return; // Cur is the ';' at End
+  }
+}
+
+auto Parser::definesSemicolon(const TokenStream& Tokens) -> bool {
+  for (std::size_t I = 0; I + 1 < Tokens.size(); ++I)
+    if ((Tokens.getKind(I) == Lexer::tok_binary
+         || Tokens.getKind(I) == Lexer::tok_unary)
+        && Tokens.getKind(I + 1) == ';')
+      return true;
+  return false;
+}
+
+auto Parser::parseParallel(const TokenStream& Tokens, unsigned NumThreads)
+    -> ParsedModule {
+  /// Chunk - A run of items ending at the ';' at End, or at tok_eof.
+  struct Chunk {
+    std::size_t                          Begin, End;
+    OperatorTable                        StartOps, EndOps{};
+    std::shared_ptr<ASTContext>          Ctx{};
+    llvm::SmallVector<const ASTNode*, 0> Items{};
+    std::vector<Diagnostic>              Diags{};
+  };
+
+  auto ParseChunk = [&Tokens](Chunk& C) {
+    C.Ctx = std::make_shared<ASTContext>();
+    C.Items.clear();
+    C.Diags.clear();
+    Parser Parse{Tokens, C.Begin, C.StartOps};
+    Parse.setDiagnostics(&C.Diags);
+    Parse.parseItems(*C.Ctx, C.End, C.Items);
+    C.EndOps = Parse.Operators;
+  };
+
+  auto KindAt = [&Tokens](std::size_t I) {
+    return I < Tokens.size() ? Tokens.getKind(I) : Lexer::tok_eof;
+  };
+
+  // installDefinition - Installs the operator defined by the item starting at
+  // I, if it is an operator definition whose prototype will parse.
+  auto InstallDefinition = [&](std::size_t I, OperatorTable& Ops) {
+    if (KindAt(I) != Lexer::tok_def && KindAt(I) != Lexer::tok_extern) return;
+    int Op = KindAt(I + 2);
+    if (!isascii(Op)) return;
+    auto& Info = Ops[static_cast<std::size_t>(Op)];
+    if (KindAt(I + 1) == Lexer::tok_unary) {
+      if (KindAt(I + 3) == '(' && KindAt(I + 4) == Lexer::tok_identifier
+          && KindAt(I + 5) == ')')
+        Info.IsUnary = true;
+    } else if (KindAt(I + 1) == Lexer::tok_binary
+               && KindAt(I + 3) == Lexer::tok_number) {
+      double Prec = Tokens.getNumVal(I + 3);
+      if (Prec >= 1 && Prec <= 100 && KindAt(I + 4) == '('
+          && KindAt(I + 5) == Lexer::tok_identifier
+          && KindAt(I + 6) == Lexer::tok_identifier && KindAt(I + 7) == ')')
+        Info.BinaryPrec = static_cast<std::int8_t>(static_cast<int>(Prec));
+    }
+  };
+
+  // Pre-scan for operator definitions, cutting the stream at the first ';'
+  // past every Target tokens and noting the operators in effect there.
+  llvm::ThreadPoolStrategy Strategy = llvm::hardware_concurrency(NumThreads);
+  std::size_t              Target   = std::max(
+      MinChunkTokens, Tokens.size() / (4 * Strategy.compute_thread_count()) + 1
+  );
+  std::size_t        Eof        = Tokens.size() - 1;
+  bool               Splittable = !definesSemicolon(Tokens);
+  std::vector<Chunk> Chunks;
+  OperatorTable      Ops        = DefaultOperators;
+  std::size_t        ChunkBegin = 0;
+  OperatorTable      ChunkOps   = Ops;
+  for (std::size_t I = 0; I != Eof && Splittable; ++I) {
+    if (I == 0 || Tokens.getKind(I - 1) == ';') InstallDefinition(I, Ops);
+    if (Tokens.getKind(I) == ';' && I + 1 - ChunkBegin >= Target) {
+      Chunks.push_back({ChunkBegin, I, ChunkOps});
+      ChunkBegin = I + 1;
+      ChunkOps   = Ops;
+    }
+  }
+  Chunks.push_back({ChunkBegin, Eof, ChunkOps});
+
+  if (Chunks.size() == 1) ParseChunk(Chunks.front());
+  else {
+    llvm::ThreadPool Pool(Strategy);
+    for (Chunk& C : Chunks) Pool.async([&] { ParseChunk(C); });
+    Pool.wait();
+  }
+
+  // The pre-scan only sees definitions right after a ';'. Should it have
+  // missed one, reparse what follows with the operators really in effect.
+  for (std::size_t I = 1; I < Chunks.size(); ++I)
+    if (Chunks[I].StartOps != Chunks[I - 1].EndOps) {
+      Chunks[I].StartOps = Chunks[I - 1].EndOps;
+      ParseChunk(Chunks[I]);
+    }
+
+  ParsedModule M;
+  for (Chunk& C : Chunks) {
+    M.Items.insert(M.Items.end(), C.Items.begin(), C.Items.end());
+    M.Diags.insert(M.Diags.end(), C.Diags.begin(), C.Diags.end());
+    M.Contexts.push_back(std::move(C.Ctx));
+  }
+  return M;
+}
@@ -0,0 +1,84 @@
+#include "kaleidoscope/Sema/Resolver.h"
+
+#include <fmt/core.h>
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace kaleidoscope;
+
+auto Resolver::resolve(const FunctionAST& F, SlotTable& S) -> bool {
+  auto Args = F.getProto().getArgs();
+  Scope.assign(Args.begin(), Args.end());
+  return resolveItem(F.getBody(), S);
+}
+
+auto Resolver::resolve(const ExprAST& E, SlotTable& S) -> bool {
+  Scope.clear();
+  return resolveItem(E, S);
+}
+
+auto Resolver::resolveItem(const ExprAST& Body, SlotTable& S) -> bool {
+  S.clear();
+  Slots  = &S;
+  Failed = false;
+  visit(Body);
+  Slots = nullptr;
+  return !Failed;
+}
+
+void Resolver::visitImpl(const BinaryExprAST& A) {
+  // CodeGen looks up the variable an assignment stores to before it emits
+  // the value, so the LHS comes first here too.
+  visit(A.getLHS());
+  visit(A.getRHS());
+}
+
+void Resolver::visitImpl(const UnaryExprAST& A) { visit(A.getOperand()); }
+
+void Resolver::visitImpl(const CallExprAST& A) {
+  for (const auto& Arg : A.getArgs()) visit(*Arg);
+}
+
+void Resolver::visitImpl(const ForExprAST& A) {
+  // The start is evaluated before the loop variable comes into scope, and the
+  // rest in the order CodeGen emits it.
+  visit(A.getStart());
+  Scope.push_back(A.getVarName());
+  visit(A.getBody());
+  visit(A.getStep());
+  visit(A.getEnd());
+  Scope.pop_back();
+}
+
+void Resolver::visitImpl(const IfExprAST& A) {
+  visit(A.getCond());
+  visit(A.getThen());
+  visit(A.getElse());
+}
+
+void Resolver::visitImpl(const NumberExprAST&) {}
+
+void Resolver::visitImpl(const VariableExprAST& A) {
+  Symbol Name = A.getName();
+  for (auto Slot = static_cast<std::uint32_t>(Scope.size()); Slot-- > 0;) {
+    if (Scope[Slot] == Name) {
+      Slots->Entries.push_back({&A, Slot});
+      return;
+    }
+  }
+  Slots->Entries.push_back({&A, SlotTable::NoSlot});
+  Failed = true;
+  error(A.getLoc(), fmt::format("unknown variable name '{}'", Name));
+}
+
+void Resolver::visitImpl(const VarAssignExprAST& A) {
+  // Each initializer sees the variables bound before it.
+  std::size_t Outer = Scope.size();
+  for (const auto& [Name, Init] : A.getVarAs()) {
+    visit(*Init);
+    Scope.push_back(Name);
+  }
+  visit(A.getBody());
+  Scope.resize(Outer);
+}
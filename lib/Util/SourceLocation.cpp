@@ -0,0 +1,155 @@
+#include "kaleidoscope/Util/SourceLocation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+using namespace kaleidoscope;
+
+auto SourceManager::get() -> SourceManager& {
+  static SourceManager SM;
+  return SM;
+}
+
+auto SourceManager::createBuffer(
+    std::string Name, std::shared_ptr<const void> Owner
+) -> unsigned {
+  std::scoped_lock Guard(Lock);
+  Buffers.push_back({std::move(Name), std::move(Owner)});
+  return static_cast<unsigned>(Buffers.size() - 1);
+}
+
+auto SourceManager::addChunk(
+    unsigned                    BufferID,
+    std::string_view            Text,
+    std::shared_ptr<const void> Owner
+) -> SourceLocation {
+  std::scoped_lock Guard(Lock);
+  constexpr auto   Max = std::numeric_limits<std::uint32_t>::max();
+  if (Text.size() >= Max - NextBase) return {};
+
+  // Continue the previous chunk's range if it belongs to the same buffer.
+  std::uint32_t Base = NextBase;
+  if (!Chunks.empty() && Chunks.back().BufferID == BufferID) --Base;
+
+  auto& Buf = Buffers[BufferID];
+  assert(!Buf.Released && "adding to a released buffer");
+  std::size_t Index = FirstChunk + Chunks.size();
+  Chunks.push_back({Text, BufferID, Base, Buf.Size});
+  Chunks.back().Owner = std::move(Owner);
+  if (Buf.LastChunk != NoChunk) getChunk(Buf.LastChunk).NextInBuffer = Index;
+  if (Buf.FirstChunk == NoChunk) Buf.FirstChunk = Index;
+  if (Buf.Uncounted == NoChunk) Buf.Uncounted = Index;
+  Buf.LastChunk = Index;
+
+  auto Size = static_cast<std::uint32_t>(Text.size());
+  Buf.Size += Size;
+  NextBase = Base + Size + 1;
+  return SourceLocation::fromRaw(Base);
+}
+
+auto SourceManager::findChunk(SourceLocation Loc) const -> std::size_t {
+  if (!Loc.isValid()) return NoChunk;
+
+  // Find the chunk whose range [Base, Base + size] contains Loc.
+  auto It = std::upper_bound(
+      Chunks.begin(),
+      Chunks.end(),
+      Loc.getRaw(),
+      [](std::uint32_t Raw, const Chunk& C) { return Raw < C.Base; }
+  );
+  if (It == Chunks.begin()) return NoChunk;
+  const Chunk& C = *std::prev(It);
+  if (C.Released || Loc.getRaw() - C.Base > C.Text.size()) return NoChunk;
+  return FirstChunk + static_cast<std::size_t>(It - Chunks.begin()) - 1;
+}
+
+auto SourceManager::getLineStarts(Chunk& C)
+    -> const std::vector<std::uint32_t>& {
+  if (!C.LineStarts) {
+    C.LineStarts = std::make_unique<std::vector<std::uint32_t>>();
+    for (std::uint32_t I = 0; I < C.Text.size(); ++I)
+      if (C.Text[I] == '\n') C.LineStarts->push_back(C.OffsetInBuffer + I + 1);
+  }
+  return *C.LineStarts;
+}
+
+void SourceManager::countLines(Buffer& Buf, std::size_t Index) {
+  // Chunk indices grow along a buffer, so this picks up where the last call
+  // stopped and every chunk is counted once.
+  while (Buf.Uncounted != NoChunk && Buf.Uncounted <= Index) {
+    Chunk& C         = getChunk(Buf.Uncounted);
+    C.FirstLine      = Buf.NextLine;
+    C.FirstLineStart = Buf.NextLineStart;
+    if (Buf.Uncounted == Index) return;
+    const auto& Starts = getLineStarts(C);
+    Buf.NextLine += static_cast<unsigned>(Starts.size());
+    if (!Starts.empty()) Buf.NextLineStart = Starts.back();
+    Buf.Uncounted = C.NextInBuffer;
+  }
+}
+
+void SourceManager::releaseChunk(Chunk& C) {
+  C.Released = true;
+  C.Text     = {};
+  C.Owner.reset();
+  C.LineStarts.reset();
+  while (!Chunks.empty() && Chunks.front().Released) {
+    Chunks.pop_front();
+    ++FirstChunk;
+  }
+}
+
+auto SourceManager::getPresumedLoc(SourceLocation Loc) -> PresumedLoc {
+  std::scoped_lock Guard(Lock);
+  std::size_t      Index = findChunk(Loc);
+  if (Index == NoChunk) return {};
+  Chunk&        C      = getChunk(Index);
+  Buffer&       Buf    = Buffers[C.BufferID];
+  std::uint32_t Offset = C.OffsetInBuffer + (Loc.getRaw() - C.Base);
+
+  // The line the chunk starts in, and the start of that line, in case Loc's
+  // line began in an earlier chunk.
+  countLines(Buf, Index);
+  unsigned      Line      = C.FirstLine;
+  std::uint32_t LineStart = C.FirstLineStart;
+
+  const auto& Starts = getLineStarts(C);
+  auto        LineIt = std::upper_bound(Starts.begin(), Starts.end(), Offset);
+  Line += static_cast<unsigned>(LineIt - Starts.begin());
+  if (LineIt != Starts.begin()) LineStart = *std::prev(LineIt);
+
+  return {Buf.Name, Offset, Line, Offset - LineStart + 1};
+}
+
+void SourceManager::releaseBuffer(SourceLocation Loc) {
+  std::scoped_lock Guard(Lock);
+  std::size_t      Index = findChunk(Loc);
+  if (Index == NoChunk) return;
+  Buffer& Buf = Buffers[getChunk(Index).BufferID];
+  // Read the links first, as releasing a chunk may drop it from the table.
+  for (std::size_t I = Buf.FirstChunk; I != NoChunk;) {
+    Chunk& C = getChunk(I);
+    I        = C.NextInBuffer;
+    releaseChunk(C);
+  }
+  Buf.Released   = true;
+  Buf.FirstChunk = Buf.LastChunk = Buf.Uncounted = NoChunk;
+  Buf.Owner.reset();
+  std::string().swap(Buf.Name);
+}
+
+void SourceManager::releaseChunksBefore(SourceLocation Loc) {
+  std::scoped_lock Guard(Lock);
+  std::size_t      Index = findChunk(Loc);
+  if (Index == NoChunk) return;
+  Buffer& Buf = Buffers[getChunk(Index).BufferID];
+  // Count the lines first so the chunks that stay keep their numbers.
+  countLines(Buf, Index);
+  while (Buf.FirstChunk != Index) {
+    Chunk& C       = getChunk(Buf.FirstChunk);
+    Buf.FirstChunk = C.NextInBuffer;
+    releaseChunk(C);
+  }
+}
@@ -0,0 +1,45 @@
+#include "kaleidoscope/Util/Symbol.h"
+
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/DJB.h>
+
+#include <array>
+#include <mutex>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// SymbolTable - Owns the characters of every interned name. Entries are never
+/// removed, so Symbols stay valid for the lifetime of the process. Names are
+/// sharded by hash so lexers on different threads rarely contend for a lock.
+class SymbolTable {
+  struct alignas(64) Shard {
+    std::mutex                              Lock{};
+    llvm::StringSet<llvm::BumpPtrAllocator> Names{};
+  };
+
+  static constexpr std::size_t NumShards = 16;
+  std::array<Shard, NumShards> Shards{};
+
+ public:
+  static auto global() -> SymbolTable& {
+    static SymbolTable Table;
+    return Table;
+  }
+
+  auto intern(std::string_view Name) -> llvm::StringRef {
+    llvm::StringRef  Key(Name.data(), Name.size());
+    Shard&           S = Shards[llvm::djbHash(Key) % NumShards];
+    std::scoped_lock Guard(S.Lock);
+    return S.Names.insert(Key).first->getKey();
+  }
+};
+
+} // namespace
+
+auto Symbol::get(std::string_view Name) -> Symbol {
+  llvm::StringRef Key = SymbolTable::global().intern(Name);
+  return {Key.data(), Key.size()};
+}
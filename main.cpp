@@ -22,10 +22,26 @@ extern "C" DLLEXPORT [[maybe_unused]] auto printd(double X) -> double {
   return X;
 }
 
-auto main() -> int {
+auto main(int Argc, char** Argv) -> int {
   llvm::InitializeNativeTarget();
   llvm::InitializeNativeTargetAsmPrinter();
   llvm::InitializeNativeTargetAsmParser();
 
-  kaleidoscope::ReplDriver().mainLoop();
+  if (Argc < 2) {
+    kaleidoscope::ReplDriver().mainLoop();
+    return 0;
+  }
+
+  // Read the program from a file instead of standard input
+  auto SourceOrErr = kaleidoscope::SourceBuffer::getFile(Argv[1]);
+  if (!SourceOrErr) {
+    fmt::print(
+        stderr,
+        "Could not open {}: {}\n",
+        Argv[1],
+        SourceOrErr.getError().message()
+    );
+    return 1;
+  }
+  kaleidoscope::ReplDriver(std::move(*SourceOrErr)).mainLoop();
 }
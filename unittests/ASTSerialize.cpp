@@ -0,0 +1,247 @@
+#include "kaleidoscope/AST/Serialize/ASTReader.h"
+#include "kaleidoscope/AST/Serialize/ASTWriter.h"
+
+#include "kaleidoscope/AST/HashCons.h"
+
+#include "TestUtil.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+
+#include <fmt/core.h>
+#include <gtest/gtest.h>
+
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// writeItems - The binary form of Items.
+auto writeItems(llvm::ArrayRef<const ASTNode*> Items) -> std::string {
+  ast::ASTWriter Writer;
+  for (const ASTNode* Item : Items) Writer.add(*Item);
+  std::string              Out;
+  llvm::raw_string_ostream OS{Out};
+  Writer.write(OS);
+  return Out;
+}
+
+/// readItems - Reads Data back, failing the test if it does not load.
+auto readItems(ASTContext& Ctx, const std::string& Data)
+    -> std::vector<const ASTNode*> {
+  auto ItemsOrErr = ast::ASTReader::read({Data, "<test>"}, Ctx);
+  if (!ItemsOrErr) {
+    ADD_FAILURE() << llvm::toString(ItemsOrErr.takeError());
+    return {};
+  }
+  return *ItemsOrErr;
+}
+
+/// readError - The error reading Data gives, or "" if it loads.
+auto readError(const std::string& Data) -> std::string {
+  ASTContext Ctx;
+  auto       ItemsOrErr = ast::ASTReader::read({Data, "<test>"}, Ctx);
+  if (ItemsOrErr) return "";
+  return llvm::toString(ItemsOrErr.takeError());
+}
+
+const std::string Program = "extern sin(angle);\n"
+                            "extern nothing();\n"
+                            "def unary!(v) if v then 0 else 1;\n"
+                            "def binary| 5 (a b) !!a + !!b;\n"
+                            "def f(x y) x*x + y*y + f(x, 1) | !(x*0.25);\n"
+                            "def g(n) var a = n*2, b = 3 in\n"
+                            "  for i = 0, i < n*2, 2 in a + b + g(a, b, i);\n"
+                            "f(1, 2) + nothing() * 4294967296;\n";
+
+} // namespace
+
+TEST(ASTSerialize, RoundTrip) {
+  // Arrange
+  ASTContext Ctx;
+  auto       Items = parseItems(Ctx, Program);
+  ASSERT_EQ(7U, Items.size());
+
+  // Act
+  ASTContext Loaded;
+  auto       Read = readItems(Loaded, writeItems(Items));
+
+  // Assert
+  ASSERT_EQ(Items.size(), Read.size());
+  for (std::size_t I = 0; I < Items.size(); ++I) {
+    EXPECT_EQ(dump(*Items[I]), dump(*Read[I]));
+    EXPECT_FALSE(Read[I]->getLoc().isValid());
+  }
+}
+
+TEST(ASTSerialize, Numbers) {
+  // Arrange
+  const double Vals[] = {
+      0.0,
+      -0.0,
+      1.0,
+      0.5,
+      -3.0,
+      0x1p53,
+      0x1p53 - 1,
+      1e300,
+      std::numeric_limits<double>::infinity(),
+      std::numeric_limits<double>::quiet_NaN(),
+  };
+  ASTContext                  Ctx;
+  std::vector<const ASTNode*> Items;
+  for (double Val : Vals) {
+    Ctx.beginItem();
+    Items.push_back(Ctx.get(Ctx.create<NumberExprAST>(Val)));
+  }
+
+  // Act
+  ASTContext Loaded;
+  auto       Read = readItems(Loaded, writeItems(Items));
+
+  // Assert
+  ASSERT_EQ(std::size(Vals), Read.size());
+  for (std::size_t I = 0; I < Read.size(); ++I)
+    EXPECT_EQ(
+        std::bit_cast<std::uint64_t>(Vals[I]),
+        std::bit_cast<std::uint64_t>(
+            llvm::cast<NumberExprAST>(Read[I])->getVal()
+        )
+    );
+}
+
+TEST(ASTSerialize, SharedSubtreesStayShared) {
+  // Arrange
+  ASTContext     Ctx;
+  ast::HashCons  C{Ctx};
+  auto           Items = parseItems(Ctx, "def f(x) (x*x + 1) * (x*x + 1);");
+  const ASTNode* Shared = C.intern(*llvm::cast<FunctionAST>(Items[0]));
+
+  // Act
+  std::string SharedData = writeItems(Shared);
+  ASTContext  Loaded;
+  auto        Read = readItems(Loaded, SharedData);
+
+  // Assert
+  ASSERT_EQ(1U, Read.size());
+  const auto& Body = llvm::cast<BinaryExprAST>(
+      llvm::cast<FunctionAST>(Read[0])->getBody()
+  );
+  EXPECT_EQ(&Body.getLHS(), &Body.getRHS());
+  EXPECT_EQ(dump(*Items[0]), dump(*Read[0]));
+  EXPECT_LT(SharedData.size(), writeItems(Items).size());
+}
+
+TEST(ASTSerialize, LoadFile) {
+  // Arrange
+  ASTContext             Ctx;
+  auto                   Items = parseItems(Ctx, Program);
+  llvm::SmallString<128> Path;
+  int                    FD = -1;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("ast", "kast", FD, Path));
+  llvm::FileRemover Remover{Path};
+  {
+    llvm::raw_fd_ostream OS{FD, /*shouldClose=*/true};
+    OS << writeItems(Items);
+  }
+
+  // Act
+  ASTContext Loaded;
+  auto       ItemsOrErr = ast::ASTReader::load(Path, Loaded);
+
+  // Assert
+  ASSERT_TRUE(static_cast<bool>(ItemsOrErr));
+  ASSERT_EQ(Items.size(), ItemsOrErr->size());
+  for (std::size_t I = 0; I < Items.size(); ++I)
+    EXPECT_EQ(dump(*Items[I]), dump(*(*ItemsOrErr)[I]));
+}
+
+TEST(ASTSerialize, LoadMissingFile) {
+  // Arrange
+  ASTContext Ctx;
+
+  // Act
+  auto ItemsOrErr = ast::ASTReader::load("/nonexistent/lib.kast", Ctx);
+
+  // Assert
+  ASSERT_FALSE(static_cast<bool>(ItemsOrErr));
+  EXPECT_NE(
+      std::string::npos,
+      llvm::toString(ItemsOrErr.takeError()).find("/nonexistent/lib.kast")
+  );
+}
+
+TEST(ASTSerialize, RejectsDamage) {
+  // Arrange
+  ASTContext  Ctx;
+  std::string Data = writeItems(parseItems(Ctx, Program));
+
+  std::string BadMagic   = Data;
+  BadMagic[0]            = 'X';
+  std::string BadVersion = Data;
+  BadVersion[4]          = 2;
+  std::string Trailing   = Data + '\0';
+
+  // Act & Assert
+  EXPECT_EQ("", readError(Data));
+  EXPECT_EQ("<test>: not a binary AST file at byte 0", readError(BadMagic));
+  EXPECT_EQ(
+      "<test>: unsupported binary AST version at byte 4", readError(BadVersion)
+  );
+  EXPECT_EQ(
+      fmt::format(
+          "<test>: unexpected data after the last item at byte {}", Data.size()
+      ),
+      readError(Trailing)
+  );
+  for (std::size_t Size = 0; Size < Data.size(); ++Size)
+    EXPECT_NE("", readError(Data.substr(0, Size))) << Size;
+}
+
+TEST(ASTSerialize, RejectsBadReferences) {
+  // Arrange
+  ASTContext Ctx;
+  Ctx.beginItem();
+  const ASTNode* Item = Ctx.get(Ctx.create<UnaryExprAST>(
+      '-', Ctx.create<NumberExprAST>(1.0)
+  ));
+  std::string Data = writeItems(Item);
+
+  // The file ends with the unary record's reference to the number, which is
+  // 1 record back.
+  std::string TooFar = Data;
+  TooFar.back()      = 2;
+  std::string Self   = Data;
+  Self.back()        = 0;
+
+  // Act & Assert
+  EXPECT_EQ("", readError(Data));
+  EXPECT_NE(std::string::npos, readError(TooFar).find("out of range"));
+  EXPECT_NE(std::string::npos, readError(Self).find("out of range"));
+}
+
+TEST(ASTSerialize, DeepTree) {
+  // Arrange
+  constexpr std::size_t Depth = 1 << 20;
+  ASTContext            Ctx;
+  Ctx.beginItem();
+  ASTHandle<ExprAST> E = Ctx.create<NumberExprAST>(7.0);
+  for (std::size_t I = 0; I < Depth; ++I) E = Ctx.create<UnaryExprAST>('-', E);
+
+  // Act
+  ASTContext Loaded;
+  auto       Read = readItems(Loaded, writeItems(Ctx.get(E)));
+
+  // Assert
+  ASSERT_EQ(1U, Read.size());
+  const ExprAST* Node = llvm::cast<ExprAST>(Read[0]);
+  for (std::size_t I = 0; I < Depth; ++I)
+    Node = &llvm::cast<UnaryExprAST>(Node)->getOperand();
+  EXPECT_EQ(7.0, llvm::cast<NumberExprAST>(Node)->getVal());
+}
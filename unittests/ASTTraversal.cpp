@@ -0,0 +1,132 @@
+#include "kaleidoscope/AST/ASTTraversal.h"
+
+#include "kaleidoscope/AST/ASTContext.h"
+
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace kaleidoscope;
+
+namespace {
+
+using Kinds = std::vector<ASTNode::ASTNodeKind>;
+
+/// Recorder - Records the kinds of the nodes it is called on, skipping the
+/// arguments of calls if asked to.
+class Recorder : public ASTTraversal<Recorder> {
+  friend ASTTraversal<Recorder>;
+
+  std::size_t Depth = 0;
+
+  auto preVisit(const ASTNode& A) -> bool {
+    Pre.push_back(A.getKind());
+    if (SkipCalls && llvm::isa<CallExprAST>(A)) return false;
+    MaxDepth = std::max(MaxDepth, ++Depth);
+    return true;
+  }
+
+  void postVisit(const ASTNode& A) {
+    Post.push_back(A.getKind());
+    --Depth;
+  }
+
+ public:
+  bool        SkipCalls = false;
+  Kinds       Pre{};
+  Kinds       Post{};
+  std::size_t MaxDepth = 0;
+};
+
+const std::string Function = "def f(x) if x < 1 then g(x, 2) else var a = x "
+                             "in a;";
+
+} // namespace
+
+TEST(ASTTraversal, PreAndPostOrder) {
+  // Arrange
+  ASTContext Ctx;
+  Recorder   R;
+
+  // Act
+  R.traverse(parseItem(Ctx, Function));
+
+  // Assert
+  EXPECT_EQ(
+      (Kinds{
+          ASTNode::ANK_FunctionAST,
+          ASTNode::ANK_PrototypeAST,
+          ASTNode::ANK_IfExprAST,
+          ASTNode::ANK_BinaryExprAST,
+          ASTNode::ANK_VariableExprAST,
+          ASTNode::ANK_NumberExprAST,
+          ASTNode::ANK_CallExprAST,
+          ASTNode::ANK_VariableExprAST,
+          ASTNode::ANK_NumberExprAST,
+          ASTNode::ANK_VarAssignExprAST,
+          ASTNode::ANK_VariableExprAST,
+          ASTNode::ANK_VariableExprAST,
+      }),
+      R.Pre
+  );
+  EXPECT_EQ(
+      (Kinds{
+          ASTNode::ANK_PrototypeAST,
+          ASTNode::ANK_VariableExprAST,
+          ASTNode::ANK_NumberExprAST,
+          ASTNode::ANK_BinaryExprAST,
+          ASTNode::ANK_VariableExprAST,
+          ASTNode::ANK_NumberExprAST,
+          ASTNode::ANK_CallExprAST,
+          ASTNode::ANK_VariableExprAST,
+          ASTNode::ANK_VariableExprAST,
+          ASTNode::ANK_VarAssignExprAST,
+          ASTNode::ANK_IfExprAST,
+          ASTNode::ANK_FunctionAST,
+      }),
+      R.Post
+  );
+  EXPECT_EQ(4U, R.MaxDepth);
+}
+
+TEST(ASTTraversal, SkipsChildren) {
+  // Arrange
+  ASTContext Ctx;
+  Recorder   R;
+  R.SkipCalls = true;
+
+  // Act
+  R.traverse(parseItem(Ctx, Function));
+
+  // Assert
+  EXPECT_EQ(10U, R.Pre.size());
+  EXPECT_EQ(9U, R.Post.size());
+  EXPECT_EQ(
+      R.Post.end(),
+      std::find(R.Post.begin(), R.Post.end(), ASTNode::ANK_CallExprAST)
+  );
+}
+
+TEST(ASTTraversal, DeepTree) {
+  // Arrange
+  constexpr std::size_t Depth = 1 << 20;
+  ASTContext            Ctx;
+  Ctx.beginItem();
+  ASTHandle<ExprAST> E = Ctx.create<NumberExprAST>(1.0);
+  for (std::size_t I = 0; I < Depth; ++I) E = Ctx.create<UnaryExprAST>('-', E);
+  Recorder R;
+
+  // Act
+  R.traverse(*Ctx.get(E));
+
+  // Assert
+  EXPECT_EQ(Depth + 1, R.Pre.size());
+  EXPECT_EQ(Depth + 1, R.Post.size());
+  EXPECT_EQ(Depth + 1, R.MaxDepth);
+  EXPECT_EQ(ASTNode::ANK_NumberExprAST, R.Post.front());
+}
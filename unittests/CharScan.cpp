@@ -0,0 +1,91 @@
+#include "kaleidoscope/Lexer/CharScan.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+using namespace kaleidoscope;
+
+namespace {
+
+class CharScanTest : public testing::TestWithParam<ScanISA> {
+ protected:
+  const CharScanner& Scalar = CharScanner::get(ScanISA::Scalar);
+
+  void SetUp() override {
+    if (!CharScanner::isSupported(GetParam()))
+      GTEST_SKIP() << "ISA not supported on this CPU";
+  }
+
+  /// expectAgrees - Checks every scanner against the scalar reference for
+  /// every start position in S.
+  void expectAgrees(const std::string& S) {
+    const CharScanner& Scan = CharScanner::get(GetParam());
+    const char*        End  = S.data() + S.size();
+    for (const char* B = S.data(); B <= End; ++B) {
+      ASSERT_EQ(Scalar.SkipSpace(B, End), Scan.SkipSpace(B, End));
+      ASSERT_EQ(Scalar.FindEndOfLine(B, End), Scan.FindEndOfLine(B, End));
+      ASSERT_EQ(Scalar.SkipIdentifier(B, End), Scan.SkipIdentifier(B, End));
+    }
+  }
+};
+
+TEST(CharScan, ScalarClasses) {
+  // Arrange
+  const CharScanner& Scan = CharScanner::get(ScanISA::Scalar);
+  std::string        S    = " \t\n\v\f\rfoo_Bar9# comment\r\nx";
+  const char*        End  = S.data() + S.size();
+
+  // Act
+  const char* Ident   = Scan.SkipSpace(S.data(), End);
+  const char* Comment = Scan.SkipIdentifier(Ident, End);
+  const char* EOL     = Scan.FindEndOfLine(Comment, End);
+
+  // Assert
+  ASSERT_EQ(6, Ident - S.data());
+  ASSERT_EQ('#', *Comment);
+  ASSERT_EQ('\r', *EOL);
+}
+
+TEST_P(CharScanTest, AllBytes) {
+  // Arrange
+  std::string S;
+  for (int C = 0; C < 256; ++C) S += std::string(40, static_cast<char>(C));
+
+  // Act Assert
+  expectAgrees(S);
+}
+
+TEST_P(CharScanTest, LongRuns) {
+  // Arrange
+  std::string S = std::string(100, ' ') + std::string(70, 'a') + "\n"
+                + std::string(65, '_') + "#" + std::string(90, '-') + "\r";
+
+  // Act Assert
+  expectAgrees(S);
+}
+
+TEST_P(CharScanTest, Random) {
+  // Arrange
+  std::mt19937                       Gen(42);
+  std::uniform_int_distribution<int> Pick(0, 7);
+  constexpr std::string_view         Alphabet = " \tx_9\n\r#";
+  std::string                        S;
+  for (int I = 0; I < 2000; ++I)
+    S += Alphabet[static_cast<std::size_t>(Pick(Gen))];
+
+  // Act Assert
+  expectAgrees(S);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ISAs,
+    CharScanTest,
+    testing::Values(ScanISA::SSE2, ScanISA::AVX2),
+    [](const auto& Info) {
+      return Info.param == ScanISA::SSE2 ? "SSE2" : "AVX2";
+    }
+);
+
+} // namespace
@@ -0,0 +1,132 @@
+#include "kaleidoscope/AST/ConstantFold.h"
+
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// fold - Folds a function definition or top-level expression with F.
+auto fold(ast::ConstantFold& F, const ASTNode& AST) -> const ASTNode& {
+  if (const auto* Fn = llvm::dyn_cast<FunctionAST>(&AST)) return *F.fold(*Fn);
+  return *F.fold(llvm::cast<ExprAST>(AST));
+}
+
+/// expectFolds - Expects Source to fold to what Expected parses to.
+void expectFolds(const std::string& Source, const std::string& Expected) {
+  ASTContext        Ctx;
+  ASTContext        FoldCtx;
+  ast::ConstantFold F{FoldCtx};
+
+  const ASTNode& Folded = fold(F, parseItem(Ctx, Source));
+
+  EXPECT_EQ(dump(parseItem(Ctx, Expected)), dump(Folded)) << Source;
+}
+
+} // namespace
+
+TEST(ConstantFold, Arithmetic) {
+  // Arrange
+  ASTContext        Ctx;
+  ASTContext        FoldCtx;
+  ast::ConstantFold F{FoldCtx};
+  const ASTNode&    AST = parseItem(Ctx, "2*3.5 + 1;");
+
+  // Act
+  const ASTNode& Folded = fold(F, AST);
+
+  // Assert
+  EXPECT_EQ(dump(parseItem(Ctx, "8;")), dump(Folded));
+  EXPECT_EQ(4U, F.getNumEliminated());
+}
+
+TEST(ConstantFold, Comparisons) {
+  // Arrange, Act and Assert
+  expectFolds("1 < 2;", "1;");
+  expectFolds("2 < 1;", "0;");
+  expectFolds("2 > 1;", "1;");
+  expectFolds("(1 < 2) + (2 < 1) * 4;", "1;");
+  // Comparisons with a NaN are unordered, so they hold.
+  expectFolds("0/0 < 1;", "1;");
+  expectFolds("0/0 > 1;", "1;");
+}
+
+TEST(ConstantFold, Identities) {
+  // Arrange, Act and Assert
+  expectFolds("def f(x) x*1;", "def f(x) x;");
+  expectFolds("def f(x) 1*x;", "def f(x) x;");
+  expectFolds("def f(x) x/1;", "def f(x) x;");
+  expectFolds("def f(x) x - (2-2);", "def f(x) x;");
+  expectFolds("def f(x) x + 0*(0-1);", "def f(x) x;");
+  expectFolds("def f(x) 0*(0-1) + x;", "def f(x) x;");
+  // +0 is not the identity of addition, as -0 + +0 is +0.
+  expectFolds("def f(x) x + 0;", "def f(x) x + 0;");
+  expectFolds("def f(x) 1/x;", "def f(x) 1/x;");
+  expectFolds("def f(x) 0 - x;", "def f(x) 0 - x;");
+  expectFolds("def f(x) x*0;", "def f(x) x*0;");
+}
+
+TEST(ConstantFold, Sequences) {
+  // Arrange, Act and Assert
+  expectFolds("def f(x) 1 : x;", "def f(x) x;");
+  expectFolds("def f(x) (1 : 2) : x*(2+2);", "def f(x) x*4;");
+  expectFolds("def f(x) x : 1;", "def f(x) x : 1;");
+}
+
+TEST(ConstantFold, DeadBranches) {
+  // Arrange
+  ASTContext        Ctx;
+  ASTContext        FoldCtx;
+  ast::ConstantFold F{FoldCtx};
+  const ASTNode&    AST = parseItem(
+      Ctx, "def f(x) if 1 < 2 then x*(1+1) else g(x, x+1);"
+  );
+
+  // Act
+  const ASTNode& Folded = fold(F, AST);
+
+  // Assert
+  EXPECT_EQ(dump(parseItem(Ctx, "def f(x) x*2;")), dump(Folded));
+  // The if, its condition's 3 nodes, the else's 5 and the 1+1 folded to 2.
+  EXPECT_EQ(11U, F.getNumEliminated());
+  expectFolds("def f(x) if 0 then g(x) else x;", "def f(x) x;");
+  expectFolds("def f(x) if 0/0 then g(x) else x;", "def f(x) x;");
+  expectFolds(
+      "def f(x) if x then 1+1 else 2*2;", "def f(x) if x then 2 else 4;"
+  );
+}
+
+TEST(ConstantFold, KeepsEffects) {
+  // Arrange, Act and Assert
+  expectFolds(
+      "def f(x) var a = 1+1 in a = 2*3;", "def f(x) var a = 2 in a = 6;"
+  );
+  expectFolds(
+      "def f(x) for i = 0, i < 2*5, 1 in g(i + 0*(0-1));",
+      "def f(x) for i = 0, i < 10, 1 in g(i);"
+  );
+  expectFolds("f(1+2, 3*4);", "f(3, 12);");
+}
+
+TEST(ConstantFold, NothingToFold) {
+  // Arrange
+  ASTContext        Ctx;
+  ASTContext        FoldCtx;
+  ast::ConstantFold F{FoldCtx};
+  const ASTNode&    AST = parseItem(
+      Ctx,
+      "def f(x y) var a = x in\n"
+      "  for i = 0, i < y in if a < i then f(a, i) else a = a*x + y;"
+  );
+
+  // Act
+  const ASTNode& Folded = fold(F, AST);
+
+  // Assert
+  EXPECT_EQ(dump(AST), dump(Folded));
+  EXPECT_EQ(0U, F.getNumEliminated());
+}
@@ -0,0 +1,201 @@
+#include "kaleidoscope/AST/Dump/JSONDump.h"
+
+#include "kaleidoscope/Lexer/Lexer.h"
+#include "kaleidoscope/Parser/Parser.h"
+
+#include "../TestUtil.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace kaleidoscope;
+using namespace std::string_view_literals;
+
+namespace {
+
+/// parseAST - Parses S into a context shared by the whole test binary, so
+/// the returned node outlives the parser.
+auto parseAST(std::string_view S, int Skip = 0) -> const ASTNode* {
+  static ASTContext Ctx;
+  Lexer             Lex = makeGetCharWithString(std::string(S));
+  Parser            Parse{Lex};
+  for (int I = 0; I < Skip; ++I) Parse.parse(Ctx);
+  return Parse.parse(Ctx);
+}
+
+} // namespace
+
+TEST(JSONDumpTest, BinaryExprAST_0) {
+  // Arrange
+  auto              AST = parseAST("5.5 < x;");
+  std::stringstream SS{};
+
+  // Act
+  ast::JSONDump(SS).visit(*AST);
+
+  // Assert
+  ASSERT_EQ(
+      "{\n"
+      "  \"Kind\": \"BinaryExprAST\",\n"
+      "  \"Op\": \"<\",\n"
+      "  \"LHS\": {\n"
+      "    \"Kind\": \"NumberExprAST\",\n"
+      "    \"Val\": 5.5\n"
+      "  },\n"
+      "  \"RHS\": {\n"
+      "    \"Kind\": \"VariableExprAST\",\n"
+      "    \"Name\": \"x\"\n"
+      "  }\n"
+      "}\n"sv,
+      SS.view()
+  );
+}
+
+TEST(JSONDumpTest, CallExprAST_0) {
+  // Arrange
+  auto              AST = parseAST("f(g(), 2);");
+  std::stringstream SS{};
+
+  // Act
+  ast::JSONDump(SS).visit(*AST);
+
+  // Assert
+  ASSERT_EQ(
+      "{\n"
+      "  \"Kind\": \"CallExprAST\",\n"
+      "  \"Callee\": \"f\",\n"
+      "  \"Args\": [\n"
+      "    {\n"
+      "      \"Kind\": \"CallExprAST\",\n"
+      "      \"Callee\": \"g\",\n"
+      "      \"Args\": []\n"
+      "    },\n"
+      "    {\n"
+      "      \"Kind\": \"NumberExprAST\",\n"
+      "      \"Val\": 2\n"
+      "    }\n"
+      "  ]\n"
+      "}\n"sv,
+      SS.view()
+  );
+}
+
+TEST(JSONDumpTest, VarAssignExprAST_0) {
+  // Arrange
+  auto              AST = parseAST("var a = 1 in a;");
+  std::stringstream SS{};
+
+  // Act
+  ast::JSONDump(SS).visit(*AST);
+
+  // Assert
+  ASSERT_EQ(
+      "{\n"
+      "  \"Kind\": \"VarAssignExprAST\",\n"
+      "  \"Vars\": [\n"
+      "    {\n"
+      "      \"Name\": \"a\",\n"
+      "      \"Init\": {\n"
+      "        \"Kind\": \"NumberExprAST\",\n"
+      "        \"Val\": 1\n"
+      "      }\n"
+      "    }\n"
+      "  ],\n"
+      "  \"Body\": {\n"
+      "    \"Kind\": \"VariableExprAST\",\n"
+      "    \"Name\": \"a\"\n"
+      "  }\n"
+      "}\n"sv,
+      SS.view()
+  );
+}
+
+TEST(JSONDumpTest, FuncBinaryAST_0) {
+  // Arrange
+  auto              AST = parseAST("def binary : 1 (x y) y;");
+  std::stringstream SS{};
+
+  // Act
+  ast::JSONDump(SS).visit(*AST);
+
+  // Assert
+  ASSERT_EQ(
+      "{\n"
+      "  \"Kind\": \"FunctionAST\",\n"
+      "  \"Proto\": {\n"
+      "    \"Kind\": \"ProtoBinaryAST\",\n"
+      "    \"Name\": \"binary:\",\n"
+      "    \"Args\": [\n"
+      "      \"x\",\n"
+      "      \"y\"\n"
+      "    ],\n"
+      "    \"Operator\": \":\",\n"
+      "    \"Precedence\": 1\n"
+      "  },\n"
+      "  \"Body\": {\n"
+      "    \"Kind\": \"VariableExprAST\",\n"
+      "    \"Name\": \"y\"\n"
+      "  }\n"
+      "}\n"sv,
+      SS.view()
+  );
+}
+
+TEST(JSONDumpTest, EndOfFileAST_0) {
+  // Arrange
+  auto              AST = parseAST("");
+  std::stringstream SS{};
+
+  // Act
+  ast::JSONDump(SS).visit(*AST);
+
+  // Assert
+  ASSERT_EQ(
+      "{\n"
+      "  \"Kind\": \"EndOfFileAST\"\n"
+      "}\n"sv,
+      SS.view()
+  );
+}
+
+TEST(JSONDumpTest, Escaping_0) {
+  // Arrange
+  const double NaN = std::numeric_limits<double>::quiet_NaN();
+  const double Inf = std::numeric_limits<double>::infinity();
+  ASTContext   Ctx;
+  Ctx.beginItem();
+  const ASTNode* AST = Ctx.get(Ctx.create<BinaryExprAST>(
+      '"',
+      Ctx.create<UnaryExprAST>('\\', Ctx.create<NumberExprAST>(NaN)),
+      Ctx.create<NumberExprAST>(-Inf)
+  ));
+  std::stringstream SS{};
+
+  // Act
+  ast::JSONDump(SS).visit(*AST);
+
+  // Assert
+  ASSERT_EQ(
+      "{\n"
+      "  \"Kind\": \"BinaryExprAST\",\n"
+      "  \"Op\": \"\\\"\",\n"
+      "  \"LHS\": {\n"
+      "    \"Kind\": \"UnaryExprAST\",\n"
+      "    \"Opcode\": \"\\\\\",\n"
+      "    \"Operand\": {\n"
+      "      \"Kind\": \"NumberExprAST\",\n"
+      "      \"Val\": \"nan\"\n"
+      "    }\n"
+      "  },\n"
+      "  \"RHS\": {\n"
+      "    \"Kind\": \"NumberExprAST\",\n"
+      "    \"Val\": \"-inf\"\n"
+      "  }\n"
+      "}\n"sv,
+      SS.view()
+  );
+}
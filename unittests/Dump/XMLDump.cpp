@@ -5,16 +5,24 @@
 
 #include "../TestUtil.h"
 
+#include <fmt/core.h>
 #include <gtest/gtest.h>
 
+#include <sstream>
+#include <string>
+#include <string_view>
+
 using namespace kaleidoscope;
 using namespace std::string_view_literals;
 
-auto convertAST(std::string_view S, int Skip = 0) -> std::unique_ptr<ASTNode> {
-  Lexer  Lex = makeGetCharWithString(std::string(S));
-  Parser Parse{Lex};
-  for (int I = 0; I < Skip; ++I) Parse.parse();
-  return Parse.parse();
+/// convertAST - Parses S into a context shared by the whole test binary, so
+/// the returned node outlives the parser.
+auto convertAST(std::string_view S, int Skip = 0) -> const ASTNode* {
+  static ASTContext Ctx;
+  Lexer             Lex = makeGetCharWithString(std::string(S));
+  Parser            Parse{Lex};
+  for (int I = 0; I < Skip; ++I) Parse.parse(Ctx);
+  return Parse.parse(Ctx);
 }
 
 using namespace kaleidoscope;
@@ -57,14 +65,14 @@ TEST(XMLDumpTest, BinaryExprAST_1) {
   // Assert
   ASSERT_EQ(
       "<BinaryExprAST>\n"
-      "  <Op><</Op>\n"
+      "  <Op>&lt;</Op>\n"
       "  <LHS>\n"
       "    <CallExprAST>\n"
       "      <Callee>func</Callee>\n"
       "      <Args>\n"
       "        <Arg[0]>\n"
       "          <BinaryExprAST>\n"
-      "            <Op>></Op>\n"
+      "            <Op>&gt;</Op>\n"
       "            <LHS>\n"
       "              <VariableExprAST>\n"
       "                <Name>x</Name>\n"
@@ -202,7 +210,7 @@ TEST(XMLDumpTest, BinaryExprAST_3) {
   // Assert
   ASSERT_EQ(
       "<BinaryExprAST>\n"
-      "  <Op><</Op>\n"
+      "  <Op>&lt;</Op>\n"
       "  <LHS>\n"
       "    <BinaryExprAST>\n"
       "      <Op>-</Op>\n"
@@ -382,7 +390,7 @@ TEST(XMLDumpTest, CallExprAST_3) {
       "      <IfExprAST>\n"
       "        <Cond>\n"
       "          <BinaryExprAST>\n"
-      "            <Op>></Op>\n"
+      "            <Op>&gt;</Op>\n"
       "            <LHS>\n"
       "              <NumberExprAST>\n"
       "                <Val>1</Val>\n"
@@ -432,7 +440,7 @@ TEST(XMLDumpTest, ForExprAST_0) {
       "  </Start>\n"
       "  <End>\n"
       "    <BinaryExprAST>\n"
-      "      <Op><</Op>\n"
+      "      <Op>&lt;</Op>\n"
       "      <LHS>\n"
       "        <VariableExprAST>\n"
       "          <Name>i</Name>\n"
@@ -491,7 +499,7 @@ TEST(XMLDumpTest, ForExprAST_1) {
       "  </Start>\n"
       "  <End>\n"
       "    <BinaryExprAST>\n"
-      "      <Op><</Op>\n"
+      "      <Op>&lt;</Op>\n"
       "      <LHS>\n"
       "        <VariableExprAST>\n"
       "          <Name>idx</Name>\n"
@@ -611,7 +619,7 @@ TEST(XMLDumpTest, IfExprAST_1) {
       "<IfExprAST>\n"
       "  <Cond>\n"
       "    <BinaryExprAST>\n"
-      "      <Op><</Op>\n"
+      "      <Op>&lt;</Op>\n"
       "      <LHS>\n"
       "        <NumberExprAST>\n"
       "          <Val>32</Val>\n"
@@ -953,7 +961,7 @@ TEST(XMLDumpTest, FunctionExprAST_2) {
       "    <IfExprAST>\n"
       "      <Cond>\n"
       "        <BinaryExprAST>\n"
-      "          <Op><</Op>\n"
+      "          <Op>&lt;</Op>\n"
       "          <LHS>\n"
       "            <VariableExprAST>\n"
       "              <Name>x</Name>\n"
@@ -1231,3 +1239,66 @@ TEST(XMLDumpTest, EndOfFileAST_0) {
       SS.view()
   );
 }
+
+TEST(XMLDumpTest, Escaping_0) {
+  // Arrange
+  auto              AST = convertAST("extern binary& 5 (a b);");
+  std::stringstream SS{};
+
+  // Act
+  ast::XMLDump(SS).visit(*AST);
+
+  // Assert
+  ASSERT_EQ(
+      "<ProtoBinaryAST>\n"
+      "  <PrototypeAST>\n"
+      "    <Name>binary&amp;</Name>\n"
+      "    <Args>\n"
+      "      <Arg[0]>a</Arg[0]>\n"
+      "      <Arg[1]>b</Arg[1]>\n"
+      "    </Args>\n"
+      "  </PrototypeAST>\n"
+      "  <Operator>&amp;</Operator>\n"
+      "  <Precedence>5</Precedence>\n"
+      "</ProtoBinaryAST>\n"sv,
+      SS.view()
+  );
+}
+
+TEST(XMLDumpTest, WrittenOutByVisit) {
+  // Arrange
+  auto              AST = convertAST("x;");
+  std::stringstream SS{};
+  ast::XMLDump      Dump(SS);
+  const auto        Expected = "<VariableExprAST>\n"
+                               "  <Name>x</Name>\n"
+                               "</VariableExprAST>\n"sv;
+
+  // Act
+  Dump.visit(*AST);
+  std::string First{SS.view()};
+  Dump.visit(*AST);
+
+  // Assert
+  ASSERT_EQ(Expected, First);
+  ASSERT_EQ(std::string(Expected) + std::string(Expected), SS.view());
+}
+
+TEST(XMLDumpTest, LargeAST) {
+  // Arrange
+  constexpr int Args = 5000;
+  std::string   Source = "f(0";
+  for (int I = 1; I < Args; ++I) Source += fmt::format(", {}", I);
+  auto              AST = convertAST(Source + ");");
+  std::stringstream SS{};
+
+  // Act
+  ast::XMLDump(SS).visit(*AST);
+
+  // Assert
+  std::string_view Out = SS.view();
+  ASSERT_TRUE(Out.starts_with("<CallExprAST>\n"));
+  ASSERT_TRUE(Out.ends_with("  </Args>\n</CallExprAST>\n"));
+  ASSERT_NE(std::string_view::npos, Out.find("<Arg[4999]>\n"));
+  ASSERT_NE(std::string_view::npos, Out.find("<Val>4999</Val>\n"));
+}
@@ -0,0 +1,155 @@
+#include "kaleidoscope/AST/HashCons.h"
+
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// intern - Copies a function definition or top-level expression with C.
+auto intern(ast::HashCons& C, const ASTNode& AST) -> const ASTNode* {
+  if (const auto* F = llvm::dyn_cast<FunctionAST>(&AST)) return C.intern(*F);
+  return C.intern(llvm::cast<ExprAST>(AST));
+}
+
+auto bodyOf(const ASTNode* AST) -> const BinaryExprAST& {
+  return llvm::cast<BinaryExprAST>(llvm::cast<FunctionAST>(AST)->getBody());
+}
+
+} // namespace
+
+TEST(HashCons, SameDump) {
+  // Arrange
+  ASTContext    Ctx;
+  ast::HashCons C{Ctx};
+  auto          Items = parseItems(
+      Ctx,
+      "def unary!(v) if v then 0 else 1;\n"
+      "def binary| 5 (a b) !!a + !!b;\n"
+      "def f(x y) x*x + y*y + f(x*x + y*y, 1) | !(x*x);\n"
+      "def g(n) var a = n*2, b = n*2 in\n"
+      "  for i = 0, i < n*2 in a + b + g(a, b, i) + g(a, b, i);\n"
+      "f(1, 2) + f(1, 2) * f(2, 1);\n"
+      "if 1 < 2 then 1 < 2 else 2 < 1;\n"
+  );
+  ASSERT_EQ(6U, Items.size());
+
+  for (const ASTNode* AST : Items) {
+    // Act
+    const ASTNode* Interned = intern(C, *AST);
+
+    // Assert
+    EXPECT_EQ(dump(*AST), dump(*Interned));
+  }
+}
+
+TEST(HashCons, SharesRepeats) {
+  // Arrange
+  ASTContext    Ctx;
+  ast::HashCons C{Ctx};
+  auto          Items = parseItems(Ctx, "def f(x) (x*x + 1) * (x*x + 1);");
+
+  // Act
+  const auto& Body = bodyOf(C.intern(*llvm::cast<FunctionAST>(Items[0])));
+
+  // Assert
+  EXPECT_EQ(11U, C.getNumVisited());
+  EXPECT_EQ(5U, C.getNumUnique());
+  EXPECT_EQ(&Body.getLHS(), &Body.getRHS());
+  EXPECT_EQ(1U, C.getOccurrences(Body));
+  EXPECT_EQ(2U, C.getOccurrences(Body.getLHS()));
+  const auto& Square = llvm::cast<BinaryExprAST>(
+      llvm::cast<BinaryExprAST>(Body.getLHS()).getLHS()
+  );
+  EXPECT_EQ(2U, C.getOccurrences(Square));
+  EXPECT_EQ(4U, C.getOccurrences(Square.getLHS()));
+  EXPECT_EQ(&Square.getLHS(), &Square.getRHS());
+}
+
+TEST(HashCons, OtherNodes) {
+  // Arrange
+  ASTContext    Ctx;
+  ast::HashCons C{Ctx};
+  auto          Items = parseItems(Ctx, "def f(x) x*x;\nx + 1;");
+  const auto&   Original = bodyOf(Items[0]);
+
+  // Act
+  C.intern(llvm::cast<ExprAST>(*Items[1]));
+
+  // Assert
+  EXPECT_EQ(std::nullopt, C.getHash(Original));
+  EXPECT_EQ(0U, C.getOccurrences(Original));
+}
+
+TEST(HashCons, KeepsDifferences) {
+  // Arrange
+  ASTContext    Ctx;
+  ast::HashCons C{Ctx};
+  auto          Items = parseItems(
+      Ctx,
+      "def f(x y) x*y + y*x;\n"
+      "def g(x y) g(x, y) + g(y, x);\n"
+      "def h(x y) (var a = x in a) + (var b = x in b);\n"
+  );
+
+  for (const ASTNode* AST : Items) {
+    // Act
+    const auto& Body = bodyOf(intern(C, *AST));
+
+    // Assert
+    EXPECT_NE(&Body.getLHS(), &Body.getRHS());
+    EXPECT_NE(C.getHash(Body.getLHS()), C.getHash(Body.getRHS()));
+    EXPECT_EQ(1U, C.getOccurrences(Body.getLHS()));
+  }
+}
+
+TEST(HashCons, HashIsStructural) {
+  // Arrange
+  ASTContext    Ctx;
+  ast::HashCons C{Ctx};
+  auto          Items = parseItems(Ctx, "x*x + 1;\n2 * (x*x);\n2 * (y*y);");
+  auto          HashOfSquare = [&](const ASTNode* AST, bool Left) {
+    const auto& E = llvm::cast<BinaryExprAST>(
+        *C.intern(llvm::cast<ExprAST>(*AST))
+    );
+    return C.getHash(Left ? E.getLHS() : E.getRHS());
+  };
+
+  // Act
+  auto First  = HashOfSquare(Items[0], true);
+  auto Second = HashOfSquare(Items[1], false);
+  auto Third  = HashOfSquare(Items[2], false);
+
+  // Assert
+  ASSERT_TRUE(First && Second && Third);
+  EXPECT_EQ(First, Second);
+  EXPECT_NE(First, Third);
+}
+
+TEST(HashCons, KeysVariablesOnBindings) {
+  // Arrange
+  ASTContext    Ctx;
+  ast::HashCons C{Ctx};
+  auto          Items = parseItems(
+      Ctx,
+      "def f(x) (var x = 2 in x) + x;\n"
+      "def g(x) x*x + (var y = 1 in x*x);\n"
+  );
+
+  // Act
+  const auto& F     = bodyOf(intern(C, *Items[0]));
+  const auto& Inner = llvm::cast<VarAssignExprAST>(F.getLHS()).getBody();
+  bool        SharedShadowed = &Inner == &F.getRHS();
+  const auto& G      = bodyOf(intern(C, *Items[1]));
+  const auto& Square = llvm::cast<VarAssignExprAST>(G.getRHS()).getBody();
+  bool        SharedSquare = &G.getLHS() == &Square;
+
+  // Assert
+  // The inner x of f is the var, not the argument; g's y does not shadow x.
+  EXPECT_FALSE(SharedShadowed);
+  EXPECT_TRUE(SharedSquare);
+}
@@ -0,0 +1,240 @@
+#include "kaleidoscope/AST/Inliner.h"
+
+#include "kaleidoscope/AST/ASTTraversal.h"
+
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// expandAll - Expands the items of Source in order with I, committing
+/// each definition, and returns the last one.
+auto expandAll(ASTContext& Ctx, ast::Inliner& I, const std::string& Source)
+    -> const ASTNode& {
+  const ASTNode* Last = nullptr;
+  for (const ASTNode* AST : parseItems(Ctx, Source)) {
+    if (const auto* F = llvm::dyn_cast<FunctionAST>(AST)) {
+      Last = I.expand(*F);
+      I.commit();
+    } else if (const auto* E = llvm::dyn_cast<ExprAST>(AST)) {
+      Last = I.expand(*E);
+    } else {
+      Last = AST;
+    }
+  }
+  return *Last;
+}
+
+/// dumpRenamed - Dumps the item Source parses to, with the underscores in
+/// its names turned into the dots the Inliner renames variables with.
+auto dumpRenamed(const std::string& Source) -> std::string {
+  ASTContext  Ctx;
+  std::string Dump = dump(*parseItems(Ctx, Source).front());
+  std::replace(Dump.begin(), Dump.end(), '_', '.');
+  return Dump;
+}
+
+/// CallCounter - Counts the calls left in a tree, including user operators.
+class CallCounter : public ASTTraversal<CallCounter> {
+  friend ASTTraversal<CallCounter>;
+
+  void postVisit(const ASTNode& A) {
+    if (llvm::isa<CallExprAST>(A) || llvm::isa<UnaryExprAST>(A)) ++Count;
+    if (const auto* B = llvm::dyn_cast<BinaryExprAST>(&A))
+      if (B->getOp() == '|') ++Count;
+  }
+
+ public:
+  std::size_t Count = 0;
+};
+
+auto countCalls(const ASTNode& AST) -> std::size_t {
+  CallCounter C;
+  C.traverse(AST);
+  return C.Count;
+}
+
+} // namespace
+
+TEST(Inliner, InlinesSmallFunction) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx};
+
+  // Act
+  const ASTNode& Expanded = expandAll(
+      Ctx, I, "def sq(x) x*x;\ndef f(a) sq(a + 1) + a;"
+  );
+
+  // Assert
+  EXPECT_EQ(
+      dumpRenamed("def f(a) (var x_sq = a + 1 in x_sq*x_sq) + a;"),
+      dump(Expanded)
+  );
+  EXPECT_EQ(1U, I.getNumInlined());
+  EXPECT_TRUE(I.isInlinable(Symbol::get("sq")));
+}
+
+TEST(Inliner, DoesNotCapture) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx};
+
+  // Act
+  const ASTNode& Expanded = expandAll(
+      Ctx,
+      I,
+      "def f(a b) var a = a - b in a;\n"
+      "def g(b a) f(b, a) + f(a, b);"
+  );
+
+  // Assert
+  EXPECT_EQ(
+      dumpRenamed(
+          "def g(b a) (var a_f = b, b_f = a in var a_f = a_f - b_f in a_f)\n"
+          "  + (var a_f = a, b_f = b in var a_f = a_f - b_f in a_f);"
+      ),
+      dump(Expanded)
+  );
+}
+
+TEST(Inliner, InlinesOperators) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx};
+
+  // Act
+  const ASTNode& Expanded = expandAll(
+      Ctx,
+      I,
+      "def binary| 5 (a b) if a then 1 else if b then 1 else 0;\n"
+      "def unary!(v) if v then 0 else 1;\n"
+      "def f(x y) (!x) | (y < 2) | x;"
+  );
+
+  // Assert
+  EXPECT_EQ(3U, I.getNumInlined());
+  EXPECT_EQ(0U, countCalls(Expanded));
+}
+
+TEST(Inliner, BottomUp) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx};
+
+  // Act
+  const ASTNode& Expanded = expandAll(
+      Ctx,
+      I,
+      "def sq(x) x*x;\n"
+      "def quad(x) sq(sq(x));\n"
+      "def f(y) quad(y) + quad(y + 1);"
+  );
+
+  // Assert
+  // quad was kept with sq already inlined into it, so only quad is inlined.
+  EXPECT_EQ(2U, I.getNumInlined());
+  EXPECT_EQ(0U, countCalls(Expanded));
+  const auto& Body = llvm::cast<BinaryExprAST>(
+      llvm::cast<FunctionAST>(Expanded).getBody()
+  );
+  EXPECT_EQ(
+      dumpRenamed(
+          "var x_quad = y in var x_sq_quad = (var x_sq_quad = x_quad in\n"
+          "  x_sq_quad*x_sq_quad) in x_sq_quad*x_sq_quad;"
+      ),
+      dump(Body.getLHS())
+  );
+}
+
+TEST(Inliner, Recursion) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx};
+
+  // Act
+  const ASTNode& Expanded = expandAll(
+      Ctx,
+      I,
+      "def fib(n) if n < 2 then n else fib(n-1) + fib(n-2);\n"
+      "extern g(x);\n"
+      "def f(x) g(x) + 1;\n"
+      "def g(x) f(x) * 2;\n"
+      "fib(3) + g(1) + f(2);"
+  );
+
+  // Assert
+  // g only calls itself once f is inlined into it.
+  EXPECT_FALSE(I.isInlinable(Symbol::get("fib")));
+  EXPECT_TRUE(I.isInlinable(Symbol::get("f")));
+  EXPECT_FALSE(I.isInlinable(Symbol::get("g")));
+  EXPECT_EQ(1U, I.getNumInlined());
+  EXPECT_EQ(3U, countCalls(Expanded));
+}
+
+TEST(Inliner, Threshold) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx, 3};
+
+  // Act
+  const ASTNode& Expanded = expandAll(
+      Ctx, I, "def sq(x) x*x;\ndef cube(x) x*x*x;\nsq(2) + cube(2);"
+  );
+
+  // Assert
+  EXPECT_TRUE(I.isInlinable(Symbol::get("sq")));
+  EXPECT_FALSE(I.isInlinable(Symbol::get("cube")));
+  EXPECT_EQ(1U, I.getNumInlined());
+  EXPECT_EQ(1U, countCalls(Expanded));
+}
+
+TEST(Inliner, KeepsBadCalls) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx};
+
+  // Act
+  const ASTNode& Expanded = expandAll(
+      Ctx, I, "def sq(x) x*x;\ndef sq(x) x;\nsq(1, 2) + h(3) + sq(4);"
+  );
+
+  // Assert
+  // The redefinition is CodeGen's to reject, so the first definition stays.
+  EXPECT_EQ(
+      dumpRenamed("sq(1, 2) + h(3) + (var x_sq = 4 in x_sq*x_sq);"),
+      dump(Expanded)
+  );
+  EXPECT_EQ(1U, I.getNumInlined());
+}
+
+TEST(Inliner, OnlyCommitted) {
+  // Arrange
+  ASTContext   Ctx;
+  ASTContext   InlineCtx;
+  ast::Inliner I{InlineCtx};
+  auto         Items = parseItems(Ctx, "def sq(x) x*x;\nsq(2);");
+
+  // Act
+  I.expand(llvm::cast<FunctionAST>(*Items[0]));
+  const ExprAST* Expanded = I.expand(llvm::cast<ExprAST>(*Items[1]));
+
+  // Assert
+  // sq was never committed, as if CodeGen had rejected it.
+  EXPECT_FALSE(I.isInlinable(Symbol::get("sq")));
+  EXPECT_EQ(0U, I.getNumInlined());
+  EXPECT_EQ(1U, countCalls(*Expanded));
+}
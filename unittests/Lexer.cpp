@@ -2,12 +2,70 @@
 
 #include "TestUtil.h"
 
+#include <fmt/core.h>
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
 using namespace kaleidoscope;
 
 namespace {
 
+/// SplitSourceBuffer - Hands out each given piece as its own chunk so tokens
+/// spanning chunk boundaries can be exercised.
+class SplitSourceBuffer : public SourceBuffer {
+  std::vector<std::string_view> Chunks;
+  std::size_t                   Idx = 0;
+
+ public:
+  SplitSourceBuffer(std::vector<std::string_view> Chunks)
+      : Chunks(std::move(Chunks)) {}
+
+  auto getNextChunk() -> SourceChunk override {
+    if (Idx == Chunks.size()) return {};
+    return {Chunks[Idx++]};
+  }
+
+  [[nodiscard]] auto getName() const -> std::string_view override {
+    return "<split>";
+  }
+};
+
+/// OwningSourceBuffer - Like SplitSourceBuffer, but copies each piece into a
+/// chunk with an owner of its own, and lets the test watch the owners.
+class OwningSourceBuffer : public SourceBuffer {
+  std::vector<std::string_view>            Pieces;
+  std::vector<std::weak_ptr<std::string>>& Owners;
+
+ public:
+  OwningSourceBuffer(
+      std::vector<std::string_view>            Pieces,
+      std::vector<std::weak_ptr<std::string>>& Owners
+  )
+      : Pieces(std::move(Pieces))
+      , Owners(Owners) {}
+
+  auto getNextChunk() -> SourceChunk override {
+    if (Owners.size() == Pieces.size()) return {};
+    auto Text = std::make_shared<std::string>(Pieces[Owners.size()]);
+    Owners.push_back(Text);
+    return {*Text, std::move(Text)};
+  }
+
+  [[nodiscard]] auto getName() const -> std::string_view override {
+    return "<owning>";
+  }
+};
+
+/// decode - Decodes Loc into "name:line:col" for compact assertions.
+auto decode(SourceLocation Loc) -> std::string {
+  PresumedLoc P = SourceManager::get().getPresumedLoc(Loc);
+  return fmt::format("{}:{}:{}", P.BufferName, P.Line, P.Column);
+}
+
 TEST(LexerTest, Def) {
   // Arrange
   Lexer Lex{makeGetCharWithString("def")};
@@ -219,4 +277,411 @@ TEST(LexerTest, MultipleTokens_0) {
   ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
   ASSERT_EQ("x", Lex.getIdentifierStr());
 }
-} // namespace
\ No newline at end of file
+
+TEST(LexerTest, MemBuffer) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBuffer("extern sin(x);")};
+
+  // Act Assert
+  ASSERT_EQ(Lexer::tok_extern, Lex.gettok());
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("sin", Lex.getIdentifierStr());
+  ASSERT_EQ('(', Lex.gettok());
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("x", Lex.getIdentifierStr());
+  ASSERT_EQ(')', Lex.gettok());
+  ASSERT_EQ(';', Lex.gettok());
+  ASSERT_EQ(Lexer::tok_eof, Lex.gettok());
+  ASSERT_EQ(Lexer::tok_eof, Lex.gettok());
+}
+
+TEST(LexerTest, Comment) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy("# banner\n#\n  # more\r\nx # y"
+  )};
+
+  // Act Assert
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("x", Lex.getIdentifierStr());
+  ASSERT_EQ(Lexer::tok_eof, Lex.gettok());
+}
+
+TEST(LexerTest, ChunkBoundaries) {
+  // Arrange
+  Lexer Lex{std::make_unique<SplitSourceBuffer>(std::vector<std::string_view>{
+      "de", "f lon", "gname(x) 3.", "14 # co", "mment\n", "  "})};
+
+  // Act Assert
+  ASSERT_EQ(Lexer::tok_def, Lex.gettok());
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("longname", Lex.getIdentifierStr());
+  ASSERT_EQ('(', Lex.gettok());
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("x", Lex.getIdentifierStr());
+  ASSERT_EQ(')', Lex.gettok());
+  ASSERT_EQ(Lexer::tok_number, Lex.gettok());
+  ASSERT_EQ(3.14, Lex.getNumVal());
+  ASSERT_EQ(Lexer::tok_eof, Lex.gettok());
+}
+
+TEST(LexerTest, IdentifierViewsAreStable) {
+  // Arrange
+  std::string_view Src = "alpha beta";
+  Lexer            Lex{SourceBuffer::getMemBuffer(Src)};
+
+  // Act
+  Lex.gettok();
+  std::string_view First = Lex.getIdentifierStr();
+  Lex.gettok();
+  std::string_view Second = Lex.getIdentifierStr();
+
+  // Assert
+  ASSERT_EQ("alpha", First);
+  ASSERT_EQ("beta", Second);
+  ASSERT_EQ(Src.data(), First.data());
+  ASSERT_EQ(Src.data() + 6, Second.data());
+}
+
+TEST(LexerTest, SpilledIdentifierViewsAreStable) {
+  // Arrange
+  Lexer Lex{std::make_unique<SplitSourceBuffer>(
+      std::vector<std::string_view>{"al", "pha be", "ta"}
+  )};
+
+  // Act
+  Lex.gettok();
+  std::string_view First = Lex.getIdentifierStr();
+  Lex.gettok();
+  std::string_view Second = Lex.getIdentifierStr();
+
+  // Assert
+  ASSERT_EQ("alpha", First);
+  ASSERT_EQ("beta", Second);
+}
+
+TEST(LexerTest, IdentifiersAreInterned) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy("foo bar foo")};
+
+  // Act
+  Lex.gettok();
+  Symbol First = Lex.getIdentifier();
+  Lex.gettok();
+  Symbol Second = Lex.getIdentifier();
+  Lex.gettok();
+  Symbol Third = Lex.getIdentifier();
+
+  // Assert
+  ASSERT_EQ("foo", First);
+  ASSERT_EQ("bar", Second);
+  ASSERT_EQ(First, Third);
+  ASSERT_NE(First, Second);
+  ASSERT_EQ(First.str().data(), Third.str().data());
+  ASSERT_EQ(Symbol::get("foo"), First);
+}
+
+TEST(LexerTest, Number_Fraction) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy(".5 5. 0.1 123456789012345")};
+
+  // Act Assert
+  ASSERT_EQ(Lexer::tok_number, Lex.gettok());
+  ASSERT_EQ(0.5, Lex.getNumVal());
+  ASSERT_EQ(Lexer::tok_number, Lex.gettok());
+  ASSERT_EQ(5.0, Lex.getNumVal());
+  ASSERT_EQ(Lexer::tok_number, Lex.gettok());
+  ASSERT_EQ(0.1, Lex.getNumVal());
+  ASSERT_EQ(Lexer::tok_number, Lex.gettok());
+  ASSERT_EQ(123456789012345.0, Lex.getNumVal());
+}
+
+TEST(LexerTest, Number_ManyDigits) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy("3.14159265358979323846")};
+
+  // Act
+  int Tok = Lex.gettok();
+
+  // Assert
+  ASSERT_EQ(Lexer::tok_number, Tok);
+  ASSERT_EQ(3.14159265358979323846, Lex.getNumVal());
+}
+
+TEST(LexerTest, Number_Malformed) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy("x 1.2.3 . y")};
+
+  // Act Assert
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  testing::internal::CaptureStderr();
+  ASSERT_EQ(Lexer::tok_err, Lex.gettok());
+  ASSERT_EQ(
+      "<memory>:1:6: Error: malformed number literal '1.2.3': unexpected "
+      "'.'\n",
+      testing::internal::GetCapturedStderr()
+  );
+  testing::internal::CaptureStderr();
+  ASSERT_EQ(Lexer::tok_err, Lex.gettok());
+  ASSERT_EQ(
+      "<memory>:1:9: Error: malformed number literal '.': unexpected '.'\n",
+      testing::internal::GetCapturedStderr()
+  );
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("y", Lex.getIdentifierStr());
+}
+
+TEST(LexerTest, TokLoc) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy("def f(x)\n  # c\n\tx + 1;\n")};
+
+  // Act Assert
+  ASSERT_FALSE(Lex.getTokLoc().isValid());
+  ASSERT_EQ(Lexer::tok_def, Lex.gettok());
+  ASSERT_EQ("<memory>:1:1", decode(Lex.getTokLoc()));
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("<memory>:1:5", decode(Lex.getTokLoc()));
+  ASSERT_EQ('(', Lex.gettok());
+  ASSERT_EQ("<memory>:1:6", decode(Lex.getTokLoc()));
+  Lex.gettok();
+  Lex.gettok();
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("<memory>:3:2", decode(Lex.getTokLoc()));
+  ASSERT_EQ('+', Lex.gettok());
+  ASSERT_EQ("<memory>:3:4", decode(Lex.getTokLoc()));
+  Lex.gettok();
+  Lex.gettok();
+  ASSERT_EQ(Lexer::tok_eof, Lex.gettok());
+  ASSERT_EQ("<memory>:4:1", decode(Lex.getTokLoc()));
+}
+
+TEST(LexerTest, TokLoc_ChunkBoundaries) {
+  // Arrange
+  Lexer Lex{std::make_unique<SplitSourceBuffer>(
+      std::vector<std::string_view>{"ab\nc", "d e\n", "\n  f", "g 1.", "2.3"}
+  )};
+
+  // Act Assert
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("<split>:1:1", decode(Lex.getTokLoc()));
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("cd", Lex.getIdentifierStr());
+  ASSERT_EQ("<split>:2:1", decode(Lex.getTokLoc()));
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("<split>:2:4", decode(Lex.getTokLoc()));
+  ASSERT_EQ(Lexer::tok_identifier, Lex.gettok());
+  ASSERT_EQ("fg", Lex.getIdentifierStr());
+  ASSERT_EQ("<split>:4:3", decode(Lex.getTokLoc()));
+  testing::internal::CaptureStderr();
+  ASSERT_EQ(Lexer::tok_err, Lex.gettok());
+  ASSERT_EQ(
+      "<split>:4:9: Error: malformed number literal '1.2.3': unexpected '.'\n",
+      testing::internal::GetCapturedStderr()
+  );
+  ASSERT_EQ(Lexer::tok_eof, Lex.gettok());
+  ASSERT_EQ("<split>:4:11", decode(Lex.getTokLoc()));
+}
+
+TEST(LexerTest, ReleaseChunksBefore) {
+  // Arrange
+  Lexer Lex{std::make_unique<SplitSourceBuffer>(
+      std::vector<std::string_view>{"a\nb\n", "c\n", "d e\n", "f"}
+  )};
+  std::vector<SourceLocation> Locs;
+  while (Lex.gettok() != Lexer::tok_eof) Locs.push_back(Lex.getTokLoc());
+
+  // Act
+  SourceManager::get().releaseChunksBefore(Locs[3]);
+
+  // Assert
+  ASSERT_EQ(6U, Locs.size());
+  ASSERT_EQ(":0:0", decode(Locs[0]));
+  ASSERT_EQ(":0:0", decode(Locs[2]));
+  ASSERT_EQ("<split>:4:1", decode(Locs[3]));
+  ASSERT_EQ("<split>:4:3", decode(Locs[4]));
+  ASSERT_EQ("<split>:5:1", decode(Locs[5]));
+}
+
+TEST(LexerTest, ReleaseChunksFreesText) {
+  // Arrange
+  std::vector<std::weak_ptr<std::string>> Owners;
+  Lexer Lex{std::make_unique<OwningSourceBuffer>(
+      std::vector<std::string_view>{"a\n", "b\n", "c"}, Owners
+  )};
+  std::vector<SourceLocation> Locs;
+  while (Lex.gettok() != Lexer::tok_eof) Locs.push_back(Lex.getTokLoc());
+
+  // Act
+  SourceManager::get().releaseChunksBefore(Locs[2]);
+
+  // Assert
+  ASSERT_EQ(3U, Owners.size());
+  EXPECT_TRUE(Owners[0].expired());
+  EXPECT_TRUE(Owners[1].expired());
+  EXPECT_FALSE(Owners[2].expired());
+  EXPECT_EQ("<owning>:3:1", decode(Locs[2]));
+}
+
+TEST(LexerTest, ReleaseBuffer) {
+  // Arrange
+  Lexer Old{SourceBuffer::getMemBufferCopy("def f(x)\n  x;")};
+  Lexer New{SourceBuffer::getMemBufferCopy("def f(x)\n  x + 1;")};
+  TokenStream OldTokens = Old.tokenize();
+  TokenStream NewTokens = New.tokenize();
+
+  // Act
+  SourceManager::get().releaseBuffer(OldTokens.getLoc(0));
+
+  // Assert
+  ASSERT_EQ(":0:0", decode(OldTokens.getLoc(0)));
+  ASSERT_EQ(":0:0", decode(OldTokens.getLoc(5)));
+  ASSERT_EQ("<memory>:2:3", decode(NewTokens.getLoc(5)));
+}
+
+TEST(LexerTest, LexBatch) {
+  // Arrange
+  Lexer      Lex{SourceBuffer::getMemBufferCopy("x 2 def ;")};
+  LexedToken Toks[4];
+  LexedToken Rest[4];
+
+  // Act
+  std::size_t N    = Lex.lex(Toks);
+  std::size_t More = Lex.lex(Rest);
+
+  // Assert
+  ASSERT_EQ(4, N);
+  ASSERT_EQ(Lexer::tok_identifier, Toks[0].Kind);
+  ASSERT_EQ("x", Toks[0].Identifier);
+  ASSERT_EQ(Lexer::tok_number, Toks[1].Kind);
+  ASSERT_EQ(2.0, Toks[1].NumVal);
+  ASSERT_EQ(Lexer::tok_def, Toks[2].Kind);
+  ASSERT_EQ(';', Toks[3].Kind);
+  ASSERT_EQ("<memory>:1:9", decode(Toks[3].Loc));
+  ASSERT_EQ(1, More);
+  ASSERT_EQ(Lexer::tok_eof, Rest[0].Kind);
+}
+
+TEST(LexerTest, Tokenize) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy("def f(x) x * 2.5;\nf(y)")};
+
+  // Act
+  TokenStream TS = Lex.tokenize();
+
+  // Assert
+  ASSERT_EQ(14, TS.size());
+  ASSERT_EQ(Lexer::tok_def, TS.getKind(0));
+  ASSERT_EQ(Lexer::tok_identifier, TS.getKind(1));
+  ASSERT_EQ("f", TS.getIdentifier(1));
+  ASSERT_EQ("x", TS.getIdentifier(5));
+  ASSERT_EQ('*', TS.getKind(6));
+  ASSERT_EQ(Lexer::tok_number, TS.getKind(7));
+  ASSERT_EQ(2.5, TS.getNumVal(7));
+  ASSERT_EQ("<memory>:2:1", decode(TS.getLoc(9)));
+  ASSERT_EQ("y", TS.getToken(11).Identifier);
+  ASSERT_EQ(Lexer::tok_eof, TS.getKind(13));
+  ASSERT_EQ(Lexer::tok_eof, Lex.gettok());
+}
+
+/// expectSameTokens - Checks two token streams agree on every token, with
+/// locations compared after decoding.
+void expectSameTokens(const TokenStream& Expected, const TokenStream& Actual) {
+  ASSERT_EQ(Expected.size(), Actual.size());
+  for (std::size_t I = 0; I != Expected.size(); ++I) {
+    LexedToken E = Expected.getToken(I), A = Actual.getToken(I);
+    ASSERT_EQ(E.Kind, A.Kind) << "token " << I;
+    ASSERT_EQ(E.Identifier, A.Identifier) << "token " << I;
+    ASSERT_EQ(E.NumVal, A.NumVal) << "token " << I;
+    PresumedLoc EL = SourceManager::get().getPresumedLoc(E.Loc);
+    PresumedLoc AL = SourceManager::get().getPresumedLoc(A.Loc);
+    ASSERT_EQ(EL.Offset, AL.Offset) << "token " << I;
+    ASSERT_EQ(EL.Line, AL.Line) << "token " << I;
+    ASSERT_EQ(EL.Column, AL.Column) << "token " << I;
+  }
+}
+
+/// makeLargeProgram - About 600KiB of source, enough for several pieces, with
+/// comments containing the characters a naive splitter might cut at.
+auto makeLargeProgram() -> std::string {
+  std::string S;
+  for (int I = 0; I < 6000; ++I)
+    S += fmt::format(
+        "def f{0}(x y) # f{0}; returns x\n"
+        "  if x < {0}.25 then y * .5 else f{0}(y, x - 1);\n"
+        "extern g{0}(a);\r\n",
+        I
+    );
+  return S;
+}
+
+TEST(LexerTest, TokenizeParallel) {
+  // Arrange
+  std::string Program = makeLargeProgram();
+  TokenStream Expected =
+      Lexer(SourceBuffer::getMemBuffer(Program)).tokenize();
+
+  // Act
+  TokenStream Actual =
+      Lexer::tokenizeParallel(SourceBuffer::getMemBuffer(Program), 4);
+
+  // Assert
+  expectSameTokens(Expected, Actual);
+}
+
+TEST(LexerTest, TokenizeParallel_Chunked) {
+  // Arrange
+  std::string                   Program = makeLargeProgram();
+  std::vector<std::string_view> Chunks;
+  for (std::size_t I = 0; I < Program.size(); I += 1000)
+    Chunks.push_back(std::string_view(Program).substr(I, 1000));
+  TokenStream Expected =
+      Lexer(SourceBuffer::getMemBuffer(Program)).tokenize();
+
+  // Act
+  TokenStream Actual = Lexer::tokenizeParallel(
+      std::make_unique<SplitSourceBuffer>(std::move(Chunks))
+  );
+
+  // Assert
+  expectSameTokens(Expected, Actual);
+  ASSERT_EQ("<split>:18001:1", decode(Actual.getLoc(Actual.size() - 1)));
+}
+
+TEST(LexerTest, TokenizeParallel_Small) {
+  // Arrange
+  std::string_view Program = "def f(x) x;\n1.2.3";
+
+  // Act
+  testing::internal::CaptureStderr();
+  TokenStream Actual =
+      Lexer::tokenizeParallel(SourceBuffer::getMemBuffer(Program));
+
+  // Assert
+  ASSERT_EQ("", testing::internal::GetCapturedStderr());
+  ASSERT_EQ(9, Actual.size());
+  ASSERT_EQ(Lexer::tok_err, Actual.getKind(7));
+  ASSERT_EQ("<memory>:2:4", decode(Actual.getError(7).Loc));
+  ASSERT_EQ(
+      "malformed number literal '1.2.3': unexpected '.'",
+      Actual.getError(7).Message
+  );
+  ASSERT_EQ("<memory>:2:6", decode(Actual.getLoc(8)));
+}
+
+TEST(LexerTest, ClassifyIdentifier) {
+  // Act Assert
+  ASSERT_EQ(Lexer::tok_def, Lexer::classifyIdentifier("def"));
+  ASSERT_EQ(Lexer::tok_extern, Lexer::classifyIdentifier("extern"));
+  ASSERT_EQ(Lexer::tok_if, Lexer::classifyIdentifier("if"));
+  ASSERT_EQ(Lexer::tok_then, Lexer::classifyIdentifier("then"));
+  ASSERT_EQ(Lexer::tok_else, Lexer::classifyIdentifier("else"));
+  ASSERT_EQ(Lexer::tok_for, Lexer::classifyIdentifier("for"));
+  ASSERT_EQ(Lexer::tok_in, Lexer::classifyIdentifier("in"));
+  ASSERT_EQ(Lexer::tok_binary, Lexer::classifyIdentifier("binary"));
+  ASSERT_EQ(Lexer::tok_unary, Lexer::classifyIdentifier("unary"));
+  ASSERT_EQ(Lexer::tok_var, Lexer::classifyIdentifier("var"));
+
+  for (std::string_view S :
+       {"x", "de", "defx", "iff", "els", "varr", "Def", "binaryy", "unar"})
+    ASSERT_EQ(Lexer::tok_identifier, Lexer::classifyIdentifier(S)) << S;
+}
+} // namespace
@@ -1,14 +1,20 @@
 #include "kaleidoscope/Parser/Parser.h"
+#include "kaleidoscope/Parser/IncrementalParser.h"
 
 #include "kaleidoscope/AST/AST.h"
 #include "kaleidoscope/Lexer/Lexer.h"
+#include "kaleidoscope/Sema/Resolver.h"
+#include "kaleidoscope/Util/SourceLocation.h"
 
 #include "TestUtil.h"
 
+#include <fmt/core.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include <functional>
+#include <string>
+#include <vector>
 
 using namespace kaleidoscope;
 
@@ -21,6 +27,74 @@ auto Isa() { // NOLINT(readability-identifier-naming)
   return Truly([](const auto& A) { return llvm::isa<AstType>(A); });
 }
 
+/// printExpr - E as an s-expression with every node's location, so two parses
+/// print the same only when they built the same tree.
+auto printExpr(const ExprAST& E) -> std::string {
+  std::string Loc = fmt::format(
+      "@{}", SourceManager::get().getPresumedLoc(E.getLoc()).Offset
+  );
+  if (const auto* N = llvm::dyn_cast<NumberExprAST>(&E))
+    return fmt::format("{}{}", N->getVal(), Loc);
+  if (const auto* V = llvm::dyn_cast<VariableExprAST>(&E))
+    return fmt::format("{}{}", V->getName().str(), Loc);
+  if (const auto* B = llvm::dyn_cast<BinaryExprAST>(&E))
+    return fmt::format(
+        "({}{} {} {})",
+        B->getOp(),
+        Loc,
+        printExpr(B->getLHS()),
+        printExpr(B->getRHS())
+    );
+  if (const auto* U = llvm::dyn_cast<UnaryExprAST>(&E))
+    return fmt::format(
+        "({}{} {})", U->getOpcode(), Loc, printExpr(U->getOperand())
+    );
+  if (const auto* C = llvm::dyn_cast<CallExprAST>(&E)) {
+    std::string S = fmt::format("({}{}", C->getCallee().str(), Loc);
+    for (const auto& Arg : C->getArgs()) S += " " + printExpr(*Arg);
+    return S + ")";
+  }
+  if (const auto* I = llvm::dyn_cast<IfExprAST>(&E))
+    return fmt::format(
+        "(if{} {} {} {})",
+        Loc,
+        printExpr(I->getCond()),
+        printExpr(I->getThen()),
+        printExpr(I->getElse())
+    );
+  return "?";
+}
+
+/// printItem - A top-level item, printed like printExpr.
+auto printItem(const ASTNode* AST) -> std::string {
+  if (!AST) return "error";
+  if (const auto* F = llvm::dyn_cast<FunctionAST>(AST))
+    return fmt::format(
+        "(def {} {})", F->getProto().getName().str(), printExpr(F->getBody())
+    );
+  if (const auto* P = llvm::dyn_cast<PrototypeAST>(AST))
+    return fmt::format("(extern {})", P->getName().str());
+  return printExpr(llvm::cast<ExprAST>(*AST));
+}
+
+/// parseAll - Parses Source to the end in the given expression mode, printing
+/// each item and any errors logged along the way.
+auto parseAll(const std::string& Source, bool Iterative)
+    -> std::vector<std::string> {
+  Lexer  Lex{SourceBuffer::getMemBufferCopy(Source)};
+  Parser Parse{Lex};
+  Parse.setIterativeExprs(Iterative);
+  std::vector<std::string> Items;
+  testing::internal::CaptureStderr();
+  while (true) {
+    const ASTNode* AST = Parse.parse();
+    if (AST && llvm::isa<EndOfFileAST>(AST)) break;
+    Items.push_back(printItem(AST));
+  }
+  Items.push_back(testing::internal::GetCapturedStderr());
+  return Items;
+}
+
 TEST(Parser, BinaryExprAST_0) {
   // Arrange
   Lexer  Lex{makeGetCharWithString("5.0 + x;")};
@@ -803,4 +877,629 @@ TEST(Parser, ProtoUnaryAST_1) {
   ASSERT_THAT(C.getArgs(), ElementsAre("arg"));
   ASSERT_EQ(';', Parse.getCurToken());
 }
-} // namespace
\ No newline at end of file
+
+TEST(Parser, SourceLocations) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBufferCopy(
+      "def f(x)\n"
+      "  if x then x - 1\n"
+      "  else x * 2;"
+  )};
+  Parser Parse{Lex};
+  auto   Decode = [](SourceLocation Loc) {
+    PresumedLoc P = SourceManager::get().getPresumedLoc(Loc);
+    return std::pair{P.Line, P.Column};
+  };
+
+  // Act
+  auto AST = Parse.parse();
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<FunctionAST>(AST));
+  auto& F = llvm::cast<FunctionAST>(*AST);
+  ASSERT_EQ(std::pair(1U, 1U), Decode(F.getLoc()));
+  ASSERT_EQ(std::pair(1U, 5U), Decode(F.getProto().getLoc()));
+  auto& If = llvm::cast<IfExprAST>(F.getBody());
+  ASSERT_EQ(std::pair(2U, 3U), Decode(If.getLoc()));
+  ASSERT_EQ(std::pair(2U, 6U), Decode(If.getCond().getLoc()));
+  auto& Sub = llvm::cast<BinaryExprAST>(If.getThen());
+  ASSERT_EQ(std::pair(2U, 15U), Decode(Sub.getLoc()));
+  auto& Mul = llvm::cast<BinaryExprAST>(If.getElse());
+  ASSERT_EQ(std::pair(3U, 10U), Decode(Mul.getLoc()));
+  ASSERT_EQ(std::pair(3U, 12U), Decode(Mul.getRHS().getLoc()));
+}
+
+TEST(Parser, PeekToken) {
+  // Arrange
+  Lexer  Lex{makeGetCharWithString("foo(1, bar) + 2;")};
+  Parser Parse{Lex};
+
+  // Act
+  Parse.getNextToken();
+  const LexedToken& Paren  = Parse.peekToken();
+  const LexedToken& Number = Parse.peekToken(2);
+  const LexedToken& Bar    = Parse.peekToken(4);
+
+  // Assert
+  ASSERT_EQ(Lexer::tok_identifier, Parse.getCurToken());
+  ASSERT_EQ('(', Paren.Kind);
+  ASSERT_EQ(Lexer::tok_number, Number.Kind);
+  ASSERT_EQ(1.0, Number.NumVal);
+  ASSERT_EQ(Lexer::tok_identifier, Bar.Kind);
+  ASSERT_EQ("bar", Bar.Identifier);
+  ASSERT_EQ('(', Parse.getNextToken());
+  ASSERT_EQ(Lexer::tok_number, Parse.getNextToken());
+}
+
+TEST(Parser, LexAhead) {
+  // Arrange
+  std::string Source;
+  for (int I = 0; I < 20; ++I)
+    Source += fmt::format("def f{0}(x) x + {0};\n", I);
+  Lexer  Lex{makeGetCharWithString(Source)};
+  Parser Parse{Lex, /*LexAhead=*/true};
+
+  // Act Assert
+  for (int I = 0; I < 20; ++I) {
+    auto AST = Parse.parse();
+    ASSERT_TRUE(llvm::isa<FunctionAST>(AST));
+    auto& F = llvm::cast<FunctionAST>(*AST);
+    ASSERT_EQ(fmt::format("f{}", I), F.getProto().getName());
+    auto& Add = llvm::cast<BinaryExprAST>(F.getBody());
+    ASSERT_EQ(I, llvm::cast<NumberExprAST>(Add.getRHS()).getVal());
+  }
+  ASSERT_TRUE(llvm::isa<EndOfFileAST>(Parse.parse()));
+}
+
+TEST(Parser, TokenStream) {
+  // Arrange
+  Lexer       Lex{makeGetCharWithString("def binary| 5 (a b) a + b;\n1 | 2;")};
+  TokenStream Tokens = Lex.tokenize();
+  Parser      Parse{Tokens};
+
+  // Act
+  auto Def  = Parse.parse();
+  auto Expr = Parse.parse();
+  auto End  = Parse.parse();
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<FunctionAST>(Def));
+  ASSERT_TRUE(llvm::isa<BinaryExprAST>(Expr));
+  ASSERT_EQ('|', llvm::cast<BinaryExprAST>(*Expr).getOp());
+  ASSERT_TRUE(llvm::isa<EndOfFileAST>(End));
+  ASSERT_TRUE(llvm::isa<EndOfFileAST>(Parse.parse()));
+  ASSERT_EQ(Lexer::tok_eof, Parse.peekToken(3).Kind);
+}
+
+TEST(Parser, ASTContext_Reset) {
+  // Arrange
+  Lexer      Lex{makeGetCharWithString("foo(1, 2, 3) + bar(4);\nx * y;")};
+  Parser     Parse{Lex};
+  ASTContext Ctx;
+
+  // Act
+  auto Call = Parse.parse(Ctx);
+  auto Used = Ctx.getBytesAllocated();
+  Ctx.reset();
+  auto Freed = Ctx.getBytesAllocated();
+  auto Next  = Parse.parse(Ctx);
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<BinaryExprAST>(Call));
+  ASSERT_LT(0U, Used);
+  ASSERT_EQ(0U, Freed);
+  ASSERT_TRUE(llvm::isa<BinaryExprAST>(Next));
+  ASSERT_EQ('*', llvm::cast<BinaryExprAST>(*Next).getOp());
+}
+
+TEST(Parser, ASTContext_ItemMoves) {
+  // Arrange
+  std::string Args;
+  for (int I = 0; I < 1000; ++I) Args += fmt::format("{}a{}", I ? ", " : "", I);
+  Lexer      Lex{makeGetCharWithString(fmt::format("1;\nf({});", Args))};
+  Parser     Parse{Lex};
+  ASTContext Ctx;
+
+  // Act
+  auto First = Parse.parse(Ctx);
+  auto Call  = Parse.parse(Ctx);
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<NumberExprAST>(First));
+  ASSERT_EQ(1, llvm::cast<NumberExprAST>(*First).getVal());
+  ASSERT_TRUE(llvm::isa<CallExprAST>(Call));
+  auto CallArgs = llvm::cast<CallExprAST>(*Call).getArgs();
+  ASSERT_EQ(1000U, CallArgs.size());
+  for (int I = 0; I < 1000; ++I)
+    ASSERT_EQ(
+        fmt::format("a{}", I),
+        llvm::cast<VariableExprAST>(*CallArgs[I]).getName().str()
+    );
+}
+
+TEST(Parser, ASTContext_Clone) {
+  // Arrange
+  Lexer      Lex{makeGetCharWithString("def binary% 30 (a b) a;")};
+  Parser     Parse{Lex};
+  ASTContext ItemCtx, LongCtx;
+
+  // Act
+  auto& F     = llvm::cast<FunctionAST>(*Parse.parse(ItemCtx));
+  auto  Clone = LongCtx.clone(F.getProto());
+  ItemCtx.reset();
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<ProtoBinaryAST>(Clone));
+  auto& B = llvm::cast<ProtoBinaryAST>(*Clone);
+  ASSERT_EQ("binary%", B.getName());
+  ASSERT_EQ('%', B.getOperator());
+  ASSERT_EQ(30, B.getPrecedence());
+  ASSERT_THAT(B.getArgs(), ElementsAre(Symbol::get("a"), Symbol::get("b")));
+}
+
+TEST(Parser, Iterative_SameAST) {
+  // Arrange
+  std::string Source = "def binary| 5 (a b) a;\n"
+                       "def binary^ 50 (a b) a;\n"
+                       "def unary!(v) v;\n"
+                       "def unary-(v) 0 - v;\n"
+                       "1 + 2 * 3 - 4 / 5 < 6 : x = 7;\n"
+                       "a = b = c | d ^ e ^ f * g;\n"
+                       "!a + b * -(c - d) ^ !!e;\n"
+                       "((1)) * (2 + (3 * (4 - 5)));\n"
+                       "f(a + b, !c, g((d))) * if x < 1 then -y else z + 1;\n"
+                       "def h(x) !(x - 1) * 2 + -x;\n"
+                       "extern k(a);\n"
+                       "a * !b + c < d;";
+
+  // Act
+  auto Recursive = parseAll(Source, false);
+  auto Iterative = parseAll(Source, true);
+
+  // Assert
+  ASSERT_EQ(13U, Recursive.size());
+  ASSERT_EQ("(extern k)", Recursive[10]);
+  ASSERT_EQ("", Recursive.back());
+  ASSERT_EQ(Recursive, Iterative);
+}
+
+TEST(Parser, Iterative_SameErrors) {
+  // Arrange
+  std::string Source = "def unary!(v) v;\n"
+                       "!!(1 + ;\n"
+                       "!(2 * 3 4;\n"
+                       "1 + ! ) ;\n"
+                       "(x +;\n"
+                       "1 + 2;";
+
+  // Act
+  auto Recursive = parseAll(Source, false);
+  auto Iterative = parseAll(Source, true);
+
+  // Assert
+  ASSERT_THAT(Recursive.back(), ::testing::HasSubstr("expected ')'"));
+  ASSERT_THAT(
+      Recursive.back(),
+      ::testing::HasSubstr("Failed to parse operand expression for unary op")
+  );
+  ASSERT_EQ(Recursive, Iterative);
+}
+
+TEST(Parser, Iterative_DeepParens) {
+  // Arrange
+  constexpr int Depth = 100000;
+  Lexer         Lex{makeGetCharWithString(
+      std::string(Depth, '(') + "1" + std::string(Depth, ')') + ";"
+  )};
+  Parser        Parse{Lex};
+  Parse.setIterativeExprs(true);
+
+  // Act
+  auto AST = Parse.parse();
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<NumberExprAST>(AST));
+  ASSERT_EQ(1, llvm::cast<NumberExprAST>(*AST).getVal());
+  ASSERT_EQ(';', Parse.getCurToken());
+}
+
+TEST(Parser, Iterative_DeepUnary) {
+  // Arrange
+  constexpr int Depth = 100000;
+  Lexer         Lex{makeGetCharWithString(
+      "def unary!(v) v;\n" + std::string(Depth, '!') + "x + 1;"
+  )};
+  Parser        Parse{Lex};
+  Parse.setIterativeExprs(true);
+
+  // Act
+  Parse.parse();
+  auto AST = Parse.parse();
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<ExprAST>(AST));
+  const auto* E = llvm::cast<ExprAST>(AST);
+  for (int I = 0; I < Depth; ++I) {
+    ASSERT_TRUE(llvm::isa<UnaryExprAST>(E));
+    ASSERT_EQ('!', llvm::cast<UnaryExprAST>(E)->getOpcode());
+    E = &llvm::cast<UnaryExprAST>(E)->getOperand();
+  }
+  ASSERT_TRUE(llvm::isa<BinaryExprAST>(E));
+  ASSERT_EQ('+', llvm::cast<BinaryExprAST>(E)->getOp());
+}
+
+TEST(Parser, Iterative_DeepBinary) {
+  // Arrange
+  constexpr int Depth = 100000;
+  std::string   Source;
+  for (int I = 0; I < Depth; ++I) Source += fmt::format("{} + (", I);
+  Source += "x" + std::string(Depth, ')') + ";";
+  Lexer  Lex{makeGetCharWithString(Source)};
+  Parser Parse{Lex};
+  Parse.setIterativeExprs(true);
+
+  // Act
+  auto AST = Parse.parse();
+
+  // Assert
+  ASSERT_TRUE(llvm::isa<ExprAST>(AST));
+  const auto* E = llvm::cast<ExprAST>(AST);
+  for (int I = 0; I < Depth; ++I) {
+    ASSERT_TRUE(llvm::isa<BinaryExprAST>(E));
+    const auto& B = llvm::cast<BinaryExprAST>(*E);
+    ASSERT_EQ('+', B.getOp());
+    ASSERT_EQ(I, llvm::cast<NumberExprAST>(B.getLHS()).getVal());
+    E = &B.getRHS();
+  }
+  ASSERT_TRUE(llvm::isa<VariableExprAST>(E));
+}
+
+/// parseParallel - Parses Source with Parser::parseParallel, printing like
+/// parseAll.
+auto parseParallel(const std::string& Source) -> std::vector<std::string> {
+  Lexer       Lex{SourceBuffer::getMemBufferCopy(Source)};
+  TokenStream Tokens = Lex.tokenize();
+  ParsedModule             M = Parser::parseParallel(Tokens, 4);
+  std::vector<std::string> Items;
+  for (const ASTNode* AST : M.Items) Items.push_back(printItem(AST));
+  testing::internal::CaptureStderr();
+  for (const Diagnostic& D : M.Diags) D.print();
+  Items.push_back(testing::internal::GetCapturedStderr());
+  return Items;
+}
+
+TEST(Parser, ParseParallel) {
+  // Arrange
+  std::string Source = "def binary| 5 (a b) a;\n";
+  for (int I = 0; I < 6000; ++I) {
+    Source += fmt::format("def f{0}(x y) x * {0} + y | f{0}(y - 1, x);\n", I);
+    if (I == 3000) Source += "def unary!(v) 0 - v;\n(1 + ;\n";
+    if (I > 3000) Source += "extern g(a);\n!x * 2;\n";
+  }
+
+  // Act
+  auto Sequential = parseAll(Source, false);
+  auto Parallel   = parseParallel(Source);
+
+  // Assert
+  ASSERT_EQ(12002U, Sequential.size());
+  ASSERT_EQ("error", Sequential[3003]);
+  ASSERT_THAT(Sequential[12000], ::testing::StartsWith("(!@"));
+  ASSERT_EQ(
+      "<memory>:3004:6: Error: Unknown unary expression.\n", Sequential[12001]
+  );
+  ASSERT_EQ(Sequential, Parallel);
+}
+
+TEST(Parser, ParseParallel_MissedDefinition) {
+  // Arrange
+  std::string Source = "1 2 def binary% 5 (a b) a;\n";
+  for (int I = 0; I < 10000; ++I) Source += "a % b - c;\n";
+
+  // Act
+  auto Sequential = parseAll(Source, false);
+  auto Parallel   = parseParallel(Source);
+
+  // Assert
+  ASSERT_EQ("(def binary% a@24)", Sequential[1]);
+  ASSERT_EQ("(%@29 a@27 (-@33 b@31 c@35))", Sequential[2]);
+  ASSERT_EQ(Sequential, Parallel);
+}
+
+TEST(Parser, Recovery_Semicolon) {
+  // Arrange
+  Lexer  Lex{makeGetCharWithString("1 + ) 2 3;\n4;")};
+  Parser Parse{Lex};
+
+  // Act
+  testing::internal::CaptureStderr();
+  auto Bad  = Parse.parse();
+  auto Next = Parse.parse();
+  auto Log  = testing::internal::GetCapturedStderr();
+
+  // Assert
+  ASSERT_EQ(nullptr, Bad);
+  ASSERT_TRUE(llvm::isa<NumberExprAST>(Next));
+  ASSERT_EQ(4, llvm::cast<NumberExprAST>(*Next).getVal());
+  ASSERT_EQ("<callback>:1:5: Error: Unknown unary expression.\n", Log);
+}
+
+TEST(Parser, Recovery_DefAndExtern) {
+  // Arrange
+  Lexer Lex{makeGetCharWithString("def f(x) x + ) 1 def g(y) y;\n"
+                                  "def h(x) x extern k(a);\n"
+                                  "extern (;")};
+  Parser                  Parse{Lex};
+  std::vector<Diagnostic> Diags;
+  Parse.setDiagnostics(&Diags);
+
+  // Act
+  testing::internal::CaptureStderr();
+  std::vector<const ASTNode*> Items;
+  for (int I = 0; I < 6; ++I) Items.push_back(Parse.parse());
+  auto Log = testing::internal::GetCapturedStderr();
+
+  // Assert
+  ASSERT_EQ("", Log);
+  ASSERT_EQ(nullptr, Items[0]);
+  ASSERT_TRUE(llvm::isa<FunctionAST>(Items[1]));
+  ASSERT_EQ("g", llvm::cast<FunctionAST>(Items[1])->getProto().getName());
+  ASSERT_EQ(nullptr, Items[2]);
+  ASSERT_TRUE(llvm::isa<PrototypeAST>(Items[3]));
+  ASSERT_EQ("k", llvm::cast<PrototypeAST>(Items[3])->getName());
+  ASSERT_EQ(nullptr, Items[4]);
+  ASSERT_TRUE(llvm::isa<EndOfFileAST>(Items[5]));
+  ASSERT_EQ(4U, Diags.size());
+  ASSERT_EQ("Unknown unary expression.", Diags[0].Message);
+  ASSERT_EQ("expected ; at end of definition", Diags[1].Message);
+  ASSERT_EQ(
+      "expected function name or operator in prototype", Diags[2].Message
+  );
+  ASSERT_EQ("failed to parse prototype for extern", Diags[3].Message);
+  testing::internal::CaptureStderr();
+  Diags[1].print();
+  ASSERT_EQ(
+      "<callback>:2:12: Error: expected ; at end of definition\n",
+      testing::internal::GetCapturedStderr()
+  );
+}
+
+TEST(Parser, Recovery_MalformedNumber) {
+  // Arrange
+  Lexer Lex{SourceBuffer::getMemBuffer("1.2.3;\n(x + 4.5.6);\n7;")};
+  Parser                  Parse{Lex};
+  std::vector<Diagnostic> Diags;
+  Parse.setDiagnostics(&Diags);
+
+  // Act
+  testing::internal::CaptureStderr();
+  std::vector<const ASTNode*> Items;
+  for (int I = 0; I < 3; ++I) Items.push_back(Parse.parse());
+  auto Log = testing::internal::GetCapturedStderr();
+
+  // Assert
+  ASSERT_EQ("", Log);
+  ASSERT_EQ(nullptr, Items[0]);
+  ASSERT_EQ(nullptr, Items[1]);
+  ASSERT_TRUE(llvm::isa<NumberExprAST>(Items[2]));
+  ASSERT_EQ(2U, Diags.size());
+  ASSERT_EQ(
+      "malformed number literal '1.2.3': unexpected '.'", Diags[0].Message
+  );
+  ASSERT_EQ(
+      "malformed number literal '4.5.6': unexpected '.'", Diags[1].Message
+  );
+}
+
+TEST(Parser, ParseParallel_MalformedNumber) {
+  // Arrange
+  Lexer       Lex{SourceBuffer::getMemBuffer("f(1);\n1.2.3;\nf(2);")};
+  TokenStream Tokens = Lex.tokenize();
+
+  // Act
+  testing::internal::CaptureStderr();
+  ParsedModule M   = Parser::parseParallel(Tokens);
+  auto         Log = testing::internal::GetCapturedStderr();
+
+  // Assert
+  ASSERT_EQ("", Log);
+  ASSERT_EQ(3U, M.Items.size());
+  ASSERT_EQ(nullptr, M.Items[1]);
+  ASSERT_EQ(1U, M.Diags.size());
+  ASSERT_EQ(
+      "malformed number literal '1.2.3': unexpected '.'", M.Diags[0].Message
+  );
+  PresumedLoc P = SourceManager::get().getPresumedLoc(M.Diags[0].Loc);
+  ASSERT_EQ(2U, P.Line);
+  ASSERT_EQ(4U, P.Column);
+}
+
+TEST(Parser, ParseParallel_Diagnostics) {
+  // Arrange
+  std::string Source;
+  for (int I = 0; I < 20000; ++I)
+    Source += I % 5000 == 7 ? "f(1 2);\n" : "f(1, 2);\n";
+
+  // Act
+  Lexer        Lex{SourceBuffer::getMemBufferCopy(Source)};
+  TokenStream  Tokens = Lex.tokenize();
+  ParsedModule M      = Parser::parseParallel(Tokens, 4);
+
+  // Assert
+  ASSERT_EQ(20000U, M.Items.size());
+  ASSERT_EQ(4U, M.Diags.size());
+  for (int I = 0; I < 4; ++I) {
+    ASSERT_EQ(nullptr, M.Items[I * 5000 + 7]);
+    PresumedLoc P = SourceManager::get().getPresumedLoc(M.Diags[I].Loc);
+    ASSERT_EQ(static_cast<unsigned>(I * 5000 + 8), P.Line);
+    ASSERT_EQ("Expected ')' or ',' in argument list", M.Diags[I].Message);
+  }
+}
+
+/// makeIncrementalSource - Defs function definitions after an operator
+/// definition, with Body in place of the body of definition Edited.
+auto makeIncrementalSource(
+    int Prec, int Defs, int Edited = -1, const std::string& Body = ""
+) -> std::string {
+  std::string S = fmt::format("def binary| {} (a b) a;\n", Prec);
+  for (int I = 0; I < Defs; ++I)
+    S += fmt::format(
+        "def f{}(x y) {};\n", I, I == Edited ? Body : "x * 2 | y + 1"
+    );
+  return S;
+}
+
+/// parseIncremental - Parses a new version of Source with Parse, printing the
+/// items like parseAll.
+auto parseIncremental(IncrementalParser& Parse, const std::string& Source)
+    -> std::pair<ParsedModule, std::vector<std::string>> {
+  Lexer        Lex{SourceBuffer::getMemBufferCopy(Source)};
+  TokenStream  Tokens = Lex.tokenize();
+  ParsedModule M      = Parse.parse(Tokens);
+  std::vector<std::string> Items;
+  for (const ASTNode* AST : M.Items) Items.push_back(printItem(AST));
+  return {std::move(M), std::move(Items)};
+}
+
+TEST(Parser, Incremental_Unchanged) {
+  // Arrange
+  IncrementalParser Parse;
+  std::string       Source = makeIncrementalSource(5, 100);
+
+  // Act
+  auto [First, FirstItems] = parseIncremental(Parse, Source);
+  auto [Second, _]         = parseIncremental(Parse, "# edited\n" + Source);
+
+  // Assert
+  ASSERT_EQ(101U, First.Items.size());
+  ASSERT_EQ(
+      "(def f3 (|@122 (*@118 x@116 2@120) (+@126 y@124 1@128)))", FirstItems[4]
+  );
+  ASSERT_EQ(102U, Parse.getNumReused());
+  ASSERT_EQ(0U, Parse.getNumParsed());
+  ASSERT_EQ(First.Items, Second.Items);
+}
+
+TEST(Parser, Incremental_Edit) {
+  // Arrange
+  IncrementalParser Parse;
+  std::string       Edited = makeIncrementalSource(5, 100, 50, "x - (y)");
+
+  // Act
+  auto [First, _] = parseIncremental(Parse, makeIncrementalSource(5, 100));
+  auto [Second, SecondItems] = parseIncremental(Parse, Edited);
+
+  // Assert
+  ASSERT_EQ(1U, Parse.getNumParsed());
+  ASSERT_EQ(101U, Parse.getNumReused());
+  for (std::size_t I = 0; I < First.Items.size(); ++I)
+    ASSERT_EQ(I != 51, First.Items[I] == Second.Items[I]);
+  auto Fresh = parseAll(Edited, false);
+  Fresh.pop_back();
+  ASSERT_EQ(Fresh[51], SecondItems[51]);
+}
+
+TEST(Parser, Incremental_OperatorChange) {
+  // Arrange
+  IncrementalParser Parse;
+
+  std::string Low  = makeIncrementalSource(5, 10);
+  std::string High = makeIncrementalSource(50, 10);
+
+  // Act
+  auto [First, FirstItems]   = parseIncremental(Parse, Low);
+  auto [Second, SecondItems] = parseIncremental(Parse, High);
+  auto [Third, ThirdItems]   = parseIncremental(Parse, Low);
+
+  // Assert
+  ASSERT_EQ(12U, Parse.getNumParsed());
+  ASSERT_EQ(0U, Parse.getNumReused());
+  auto Fresh = parseAll(High, false);
+  Fresh.pop_back();
+  ASSERT_EQ(Fresh, SecondItems);
+  ASSERT_NE(FirstItems, SecondItems);
+  ASSERT_EQ(FirstItems, ThirdItems);
+}
+
+TEST(Parser, Incremental_Errors) {
+  // Arrange
+  IncrementalParser Parse;
+  std::string       Source = makeIncrementalSource(5, 10, 3, "x +");
+
+  // Act
+  auto [First, FirstItems]   = parseIncremental(Parse, Source);
+  auto [Second, SecondItems] = parseIncremental(Parse, "\n" + Source);
+
+  // Assert
+  ASSERT_EQ(1U, Parse.getNumParsed());
+  ASSERT_EQ("error", SecondItems[4]);
+  ASSERT_EQ(FirstItems, SecondItems);
+  ASSERT_EQ(1U, First.Diags.size());
+  ASSERT_EQ(1U, Second.Diags.size());
+  ASSERT_EQ(5U, SourceManager::get().getPresumedLoc(First.Diags[0].Loc).Line);
+  ASSERT_EQ(6U, SourceManager::get().getPresumedLoc(Second.Diags[0].Loc).Line);
+}
+
+TEST(Parser, Incremental_ReusedLocations) {
+  // Arrange
+  IncrementalParser       Parse;
+  Resolver                R;
+  std::vector<Diagnostic> Diags;
+  R.setDiagnostics(&Diags);
+  std::string Source = "def f(x) x;\ndef g(x)\n  y;\n";
+
+  // Act
+  ParsedModule First  = parseIncremental(Parse, Source).first;
+  ParsedModule Second =
+      parseIncremental(Parse, "def h(x)\n  x;\n\n" + Source).first;
+  SlotTable Slots;
+  R.resolve(llvm::cast<FunctionAST>(*Second.Items[2]), Slots);
+
+  // Assert
+  ASSERT_EQ(3U, Parse.getNumReused());
+  ASSERT_EQ(First.Items[1], Second.Items[2]);
+  ASSERT_EQ(1U, Diags.size());
+  PresumedLoc P =
+      SourceManager::get().getPresumedLoc(Second.getLoc(2, Diags[0].Loc));
+  ASSERT_EQ(6U, P.Line);
+  ASSERT_EQ(3U, P.Column);
+}
+
+TEST(Parser, Incremental_Reformatted) {
+  // Arrange
+  IncrementalParser Parse;
+
+  // Act
+  auto [First, FirstItems]   = parseIncremental(Parse, "def f(x) x + 1;");
+  auto [Second, SecondItems] = parseIncremental(Parse, "def f(x) x+1;");
+
+  // Assert
+  // The locations inside the item moved relative to each other.
+  ASSERT_EQ(1U, Parse.getNumParsed());
+  ASSERT_NE(FirstItems[0], SecondItems[0]);
+}
+
+TEST(Parser, Incremental_ReleasePreviousVersion) {
+  // Arrange
+  IncrementalParser Parse;
+  std::string       Source = "def f(x) x;\ndef g(x)\n  x + 1;\n";
+  Lexer             OldLex{SourceBuffer::getMemBufferCopy(Source)};
+  Lexer             NewLex{SourceBuffer::getMemBufferCopy("\n" + Source)};
+  TokenStream       Old = OldLex.tokenize();
+  TokenStream       New = NewLex.tokenize();
+  Parse.parse(Old);
+  ParsedModule M = Parse.parse(New);
+
+  // Act
+  SourceManager::get().releaseBuffer(Old.getLoc(0));
+
+  // Assert
+  // Reused items are placed in the new version without the old text.
+  ASSERT_EQ(3U, Parse.getNumReused());
+  const ASTNode& G = *M.Items[1];
+  EXPECT_FALSE(SourceManager::get().getPresumedLoc(G.getLoc()).isValid());
+  EXPECT_EQ(
+      3U, SourceManager::get().getPresumedLoc(M.getLoc(1, G.getLoc())).Line
+  );
+}
+} // namespace
@@ -0,0 +1,217 @@
+#include "kaleidoscope/Sema/Resolver.h"
+
+#include "kaleidoscope/AST/ConstantFold.h"
+#include "kaleidoscope/AST/HashCons.h"
+
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace kaleidoscope;
+
+namespace {
+
+/// resolve - Resolves a function definition or top-level expression with R,
+/// recording its slots in Slots.
+auto resolve(Resolver& R, const ASTNode& AST, SlotTable& Slots) -> bool {
+  if (const auto* F = llvm::dyn_cast<FunctionAST>(&AST))
+    return R.resolve(*F, Slots);
+  return R.resolve(llvm::cast<ExprAST>(AST), Slots);
+}
+
+using SlotList = std::vector<std::pair<std::string, std::uint32_t>>;
+
+/// slotsOf - The references in Table and their slots, in the order they
+/// were resolved.
+auto slotsOf(const SlotTable& Table) -> SlotList {
+  SlotList Slots;
+  for (auto [Ref, Slot] : Table.entries())
+    Slots.emplace_back(Ref->getName().str(), Slot);
+  return Slots;
+}
+
+constexpr std::uint32_t NoSlot = SlotTable::NoSlot;
+
+} // namespace
+
+TEST(Resolver, ArgumentsThenLocals) {
+  // Arrange
+  ASTContext     Ctx;
+  Resolver       R;
+  SlotTable      Slots;
+  const ASTNode& AST = parseItem(
+      Ctx, "def f(x y) var a = x in for i = 0, i < y in a + i + x;"
+  );
+
+  // Act
+  bool Resolved = resolve(R, AST, Slots);
+
+  // Assert
+  EXPECT_TRUE(Resolved);
+  // A for's body comes before its end condition, as CodeGen emits them.
+  SlotList Expected{
+      {"x", 0}, {"a", 2}, {"i", 3}, {"x", 0}, {"i", 3}, {"y", 1}
+  };
+  EXPECT_EQ(Expected, slotsOf(Slots));
+}
+
+TEST(Resolver, Shadowing) {
+  // Arrange
+  ASTContext     Ctx;
+  Resolver       R;
+  SlotTable      Slots;
+  const ASTNode& AST = parseItem(
+      Ctx, "def f(x) (var x = x + 1 in x = x * 2) + x;"
+  );
+
+  // Act
+  bool Resolved = resolve(R, AST, Slots);
+
+  // Assert
+  EXPECT_TRUE(Resolved);
+  SlotList Expected{{"x", 0}, {"x", 1}, {"x", 1}, {"x", 0}};
+  EXPECT_EQ(Expected, slotsOf(Slots));
+}
+
+TEST(Resolver, BindingOrder) {
+  // Arrange
+  ASTContext     Ctx;
+  Resolver       R;
+  SlotTable      Slots;
+  const ASTNode& AST = parseItem(
+      Ctx,
+      "def f(x) (var a = x, b = a in a + b)\n"
+      "  + (for x = x, x < 3 in var c = x in c);"
+  );
+
+  // Act
+  bool Resolved = resolve(R, AST, Slots);
+
+  // Assert
+  EXPECT_TRUE(Resolved);
+  // A var initializer sees the ones before it, and a for's start is outside
+  // its variable's scope. Sibling scopes share slots.
+  SlotList Expected{
+      {"x", 0}, {"a", 1}, {"a", 1}, {"b", 2},
+      {"x", 0}, {"x", 1}, {"c", 2}, {"x", 1},
+  };
+  EXPECT_EQ(Expected, slotsOf(Slots));
+}
+
+TEST(Resolver, TopLevelExpression) {
+  // Arrange
+  ASTContext     Ctx;
+  Resolver       R;
+  SlotTable      Slots;
+  const ASTNode& AST = parseItem(Ctx, "var a = 1 in f(a, a);");
+
+  // Act
+  bool Resolved = resolve(R, AST, Slots);
+
+  // Assert
+  EXPECT_TRUE(Resolved);
+  SlotList Expected{{"a", 0}, {"a", 0}};
+  EXPECT_EQ(Expected, slotsOf(Slots));
+}
+
+TEST(Resolver, ReportsEveryUnknownVariable) {
+  // Arrange
+  ASTContext              Ctx;
+  Resolver                R;
+  SlotTable               Slots;
+  std::vector<Diagnostic> Diags;
+  R.setDiagnostics(&Diags);
+  const ASTNode& AST = parseItem(
+      Ctx, "def f(x) (var a = 1 in a) + y + x + (z = a);"
+  );
+
+  // Act
+  bool Resolved = resolve(R, AST, Slots);
+
+  // Assert
+  EXPECT_FALSE(Resolved);
+  ASSERT_EQ(3U, Diags.size());
+  EXPECT_EQ("unknown variable name 'y'", Diags[0].Message);
+  EXPECT_EQ("unknown variable name 'z'", Diags[1].Message);
+  EXPECT_EQ("unknown variable name 'a'", Diags[2].Message);
+  EXPECT_TRUE(Diags[0].Loc.isValid());
+  SlotList Expected{
+      {"a", 1}, {"y", NoSlot}, {"x", 0}, {"z", NoSlot}, {"a", NoSlot}
+  };
+  EXPECT_EQ(Expected, slotsOf(Slots));
+}
+
+TEST(Resolver, ResetsBetweenItems) {
+  // Arrange
+  ASTContext              Ctx;
+  Resolver                R;
+  SlotTable               Slots;
+  std::vector<Diagnostic> Diags;
+  R.setDiagnostics(&Diags);
+  const ASTNode& Bad  = parseItem(Ctx, "def f(x) y;");
+  const ASTNode& Good = parseItem(Ctx, "def g(y) y;");
+
+  // Act
+  bool BadResolved  = resolve(R, Bad, Slots);
+  bool GoodResolved = resolve(R, Good, Slots);
+
+  // Assert
+  EXPECT_FALSE(BadResolved);
+  EXPECT_TRUE(GoodResolved);
+  EXPECT_EQ(1U, Diags.size());
+  EXPECT_EQ((SlotList{{"y", 0}}), slotsOf(Slots));
+}
+
+TEST(Resolver, DeadBranch) {
+  // Arrange
+  ASTContext              Ctx;
+  ASTContext              FoldCtx;
+  ast::ConstantFold       Fold{FoldCtx};
+  Resolver                R;
+  SlotTable               Slots;
+  std::vector<Diagnostic> Diags;
+  R.setDiagnostics(&Diags);
+  const auto& F = llvm::cast<FunctionAST>(
+      parseItem(Ctx, "def f(x) if 1 then x else undefined_var;")
+  );
+
+  // Act
+  bool               Resolved       = resolve(R, F, Slots);
+  const FunctionAST* Folded         = Fold.fold(F);
+  bool               FoldedResolved = resolve(R, *Folded, Slots);
+
+  // Assert
+  // Folding drops the else branch, so the unknown variable is only found by
+  // resolving the item as it was written.
+  EXPECT_FALSE(Resolved);
+  ASSERT_EQ(1U, Diags.size());
+  EXPECT_EQ("unknown variable name 'undefined_var'", Diags[0].Message);
+  EXPECT_TRUE(FoldedResolved);
+  EXPECT_EQ((SlotList{{"x", 0}}), slotsOf(Slots));
+}
+
+TEST(Resolver, SharedNodes) {
+  // Arrange
+  ASTContext     Ctx;
+  ASTContext     ConsCtx;
+  ast::HashCons  Cons{ConsCtx};
+  Resolver       R;
+  SlotTable      Slots;
+  const auto&    F = llvm::cast<FunctionAST>(
+      parseItem(Ctx, "def f(x) (var x = 2 in x) + x;")
+  );
+  const FunctionAST* Interned = Cons.intern(F);
+
+  // Act
+  bool Resolved = resolve(R, *Interned, Slots);
+
+  // Assert
+  // Each reference gets its own slot, even where HashCons shares the nodes.
+  EXPECT_TRUE(Resolved);
+  EXPECT_EQ((SlotList{{"x", 1}, {"x", 0}}), slotsOf(Slots));
+}
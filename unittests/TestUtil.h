@@ -1,8 +1,16 @@
 #ifndef KALEIDOSCOPE_UNITTESTS_TESTUTIL_H
 #define KALEIDOSCOPE_UNITTESTS_TESTUTIL_H
 
+#include "kaleidoscope/AST/AST.h"
+#include "kaleidoscope/AST/ASTContext.h"
+#include "kaleidoscope/AST/Dump/XMLDump.h"
+#include "kaleidoscope/Lexer/Lexer.h"
+#include "kaleidoscope/Parser/Parser.h"
+
 #include <functional>
+#include <sstream>
 #include <string>
+#include <vector>
 
 inline auto makeGetCharWithString(std::string S) -> std::function<int()> {
   S += static_cast<char>(EOF);
@@ -11,4 +19,34 @@ inline auto makeGetCharWithString(std::string S) -> std::function<int()> {
   };
 }
 
+/// parseItems - Parses every item of Source into Ctx.
+inline auto parseItems(kaleidoscope::ASTContext& Ctx, const std::string& Source)
+    -> std::vector<const kaleidoscope::ASTNode*> {
+  using namespace kaleidoscope;
+  Lexer                       Lex{SourceBuffer::getMemBufferCopy(Source)};
+  Parser                      Parse{Lex};
+  std::vector<const ASTNode*> Items;
+  while (true) {
+    const ASTNode* AST = Parse.parse(Ctx);
+    if (llvm::isa<EndOfFileAST>(AST)) return Items;
+    Items.push_back(AST);
+  }
+}
+
+/// parseItem - Parses the first item of Source into Ctx.
+inline auto parseItem(kaleidoscope::ASTContext& Ctx, const std::string& Source)
+    -> const kaleidoscope::ASTNode& {
+  using namespace kaleidoscope;
+  Lexer  Lex{SourceBuffer::getMemBufferCopy(Source)};
+  Parser Parse{Lex};
+  return *Parse.parse(Ctx);
+}
+
+/// dump - AST as XML, for comparing trees.
+inline auto dump(const kaleidoscope::ASTNode& AST) -> std::string {
+  std::stringstream SS;
+  kaleidoscope::ast::XMLDump(SS).visit(AST);
+  return SS.str();
+}
+
 #endif // KALEIDOSCOPE_UNITTESTS_TESTUTIL_H